@@ -0,0 +1,300 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+/** KIM: allow list benchmark
+        random rule sets [/16 - /32 "from" and "to" networks, port-ranges,
+        rules without "to"] are compiled into classifier, every lookup is
+        checked against ipv4_allow_allowed_is and both are timed.
+
+        lookups are taken inside networks of rules mostly, so "to" lists are
+        walked and "continue" [from matched, no "to" matched] happens, count
+        of such lookups is reported and must not be zero.
+
+        build: make benchmarks, run: obj/bench-classifier [seed]
+        exits with 1 when results differ
+**/
+
+#include "../src/ipv4.h"
+#include "../src/log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#define BENCH_SETS              (64)
+#define BENCH_LOOKUPS           (32768)     //per set, ~2M in total
+#define BENCH_RULES_MAX         (256)
+#define BENCH_TO_MAX            (4)
+#define BENCH_PORT_BASE         (27000)
+
+typedef
+struct _bench_lookup {
+    ipv4_t                      from;
+    sipv4_destination           destination;
+} sbench_lookup;
+
+static uint64_t gseed = 0x9E3779B97F4A7C15ULL;
+
+static inline uint32_t
+bench_random (
+) {
+    gseed ^= gseed << 13;
+    gseed ^= gseed >> 7;
+    gseed ^= gseed << 17;
+    return (uint32_t)(gseed >> 16);
+}
+
+//host order in, network order out; 10.0.0.0/13 keeps /16 networks overlapping
+static inline void
+bench_network (
+    OUT sipv4_network*          network
+) {
+    uint32_t _bits    = 16 + (bench_random() % 17);
+    uint32_t _address = 0x0A000000 | (bench_random() & 0x0007FFFF);
+
+    network->mask    = IPV4_MASK(_bits);
+    network->address = htonl(_address) & network->mask;
+}
+
+static inline ipv4_t
+bench_inside (
+    IN  const sipv4_network*    network
+) { return network->address | (htonl(bench_random()) & ~(network->mask)); }
+
+static sipv4_allow*
+bench_rules (
+        size_t                  count
+) {
+    sipv4_allow*  _head = NULL;
+    sipv4_allow** _tail = &_head;
+
+    for (size_t _i = 0; _i < count; ++_i) {
+        sipv4_allow* _allow = (sipv4_allow*)calloc(1, sizeof(sipv4_allow));
+
+        if NULL_IS(_allow)
+            break;
+
+        bench_network(&(_allow->address));
+
+        //quarter has no "to" [broadcast of "from" network only]
+        size_t            _to_count = (0 == (bench_random() & 3))?0:(1 + (bench_random() % BENCH_TO_MAX));
+        sipv4_allow_to**  _to_tail  = &(_allow->allow_to);
+
+        for (size_t _j = 0; _j < _to_count; ++_j) {
+            sipv4_allow_to* _to = (sipv4_allow_to*)calloc(1, sizeof(sipv4_allow_to));
+
+            if NULL_IS(_to)
+                break;
+
+            bench_network(&(_to->address));
+
+            if (0 != (bench_random() & 1)) {
+                if NULL_IS(_to->portrange = (sipv4_portrange*)calloc(1, sizeof(sipv4_portrange)))
+                    break;
+
+                _to->portrange->first = (uint16_t)(BENCH_PORT_BASE + (bench_random() % 192));
+                _to->portrange->last  = (uint16_t)(_to->portrange->first + (bench_random() % 64));
+
+                ipv4_ports_compile(_to->portrange, &(_to->ports));
+            }
+
+            (*_to_tail) = _to;
+            _to_tail    = &(_to->next);
+        }
+
+        (*_tail) = _allow;
+        _tail    = &(_allow->next);
+    }
+
+    return _head;
+}
+
+static void
+bench_rules_free (
+    BTH sipv4_allow*            allow
+) {
+    while (NULL != allow) {
+        sipv4_allow* _allow = allow;
+        allow = allow->next;
+
+        while (NULL != _allow->allow_to) {
+            sipv4_allow_to* _to = _allow->allow_to;
+            _allow->allow_to = _to->next;
+
+            ipv4_ports_destroy(_to->ports);
+            free(_to->portrange);
+            free(_to);
+        }
+
+        free(_allow);
+    }
+}
+
+static void
+bench_lookups (
+    IN  const sipv4_allow*      allow,
+        size_t                  count,
+    OUT sbench_lookup*          lookups
+) {
+    const sipv4_allow* _rules[BENCH_RULES_MAX];
+    size_t             _rules_count = 0;
+
+    for (const sipv4_allow* _allow = allow; (NULL != _allow) && (_rules_count < BENCH_RULES_MAX); _allow = _allow->next)
+        _rules[_rules_count++] = _allow;
+
+    for (size_t _i = 0; _i < count; ++_i) {
+        const sipv4_allow* _rule = _rules[bench_random() % _rules_count];
+        sbench_lookup*     _l    = &(lookups[_i]);
+
+        _l->from                = (0 == (bench_random() & 7))?(htonl(0x0A000000 | (bench_random() & 0x0007FFFF))):bench_inside(&(_rule->address));
+        _l->destination.port    = htons((uint16_t)(BENCH_PORT_BASE + (bench_random() % 256)));
+
+        //"to" of picked rule, broadcast of its "from" or anything
+        uint32_t _kind = bench_random() % 4;
+
+        if ((_kind < 2) && (NULL != _rule->allow_to)) {
+            const sipv4_allow_to* _to = _rule->allow_to;
+
+            for (uint32_t _n = bench_random() % BENCH_TO_MAX; (0 < _n) && (NULL != _to->next); --_n)
+                _to = _to->next;
+
+            _l->destination.address = bench_inside(&(_to->address));
+        } else if (_kind < 3)
+            _l->destination.address = ipv4_network_broadcast(&(_rule->address));
+        else
+            _l->destination.address = htonl(0x0A000000 | (bench_random() & 0x0007FFFF));
+    }
+}
+
+//first matching "from" rule has "to" list, but none of it matched
+static int
+bench_continued (
+    IN  const sipv4_allow*      allow,
+        ipv4_t                  from,
+    IN  const sipv4_destination* destination
+) {
+    for (const sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next)
+        if (ripv4_ok == ipv4_address_in_network(from, &(_allow->address))) {
+            if NULL_IS(_allow->allow_to)
+                return 0;
+
+            for (const sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next)
+                if (ripv4_ok == ipv4_address_in_network(destination->address, &(_to->address)))
+                    return 0;
+
+            return 1;
+        }
+
+    return 0;
+}
+
+static inline uint64_t
+bench_now (
+) {
+    struct timespec _ts;
+    clock_gettime(CLOCK_MONOTONIC, &_ts);
+    return ((uint64_t)_ts.tv_sec * 1000000000ULL) + (uint64_t)_ts.tv_nsec;
+}
+
+int
+main (
+        int                     argc,
+        char**                  argv
+) {
+    if (1 < argc)
+        gseed ^= strtoull(argv[1], NULL, 0);
+
+    log_startup(LOGGING_DEFAULT_SUPPRESS);
+
+    sbench_lookup* _lookups = (sbench_lookup*)malloc(BENCH_LOOKUPS * sizeof(sbench_lookup));
+
+    if NULL_IS(_lookups) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    uint64_t _linear    = 0;
+    uint64_t _compiled  = 0;
+    size_t   _allowed   = 0;
+    size_t   _continued = 0;
+    size_t   _total     = 0;
+    size_t   _rules     = 0;
+    int      _result    = 0;
+
+    volatile size_t _sink = 0;
+
+    for (size_t _set = 0; (_set < BENCH_SETS) && (0 == _result); ++_set) {
+        size_t            _count      = 8 + (bench_random() % (BENCH_RULES_MAX - 8 + 1));
+        sipv4_allow*      _allow      = bench_rules(_count);
+        sipv4_classifier* _classifier = ipv4_classifier_create(_allow);
+
+        if NULL_IS(_classifier) {
+            printf("set %lu: classifier can't be compiled\n", (unsigned long)_set);
+
+            bench_rules_free(_allow);
+            _result = 1;
+            break;
+        }
+
+        bench_lookups(_allow, BENCH_LOOKUPS, _lookups);
+
+        for (size_t _i = 0; _i < BENCH_LOOKUPS; ++_i) {
+            sbench_lookup* _l = &(_lookups[_i]);
+
+            ripv4 _a = ipv4_allow_allowed_is(_allow, _l->from, &(_l->destination));
+            ripv4 _b = ipv4_classifier_allowed_is(_classifier, _l->from, &(_l->destination));
+
+            if (_a != _b) {
+                printf("set %lu: mismatch from " IPV4_PRIADDR " to " IPV4_PRIADDR ":%u, list %d, classifier %d\n",
+                    (unsigned long)_set, IPV4_DPRIADDR(_l->from), IPV4_DPRIADDR(_l->destination.address), ntohs(_l->destination.port), (int)_a, (int)_b);
+
+                _result = 1;
+                break;
+            }
+
+            _allowed   += (ripv4_ok == _a)?1:0;
+            _continued += (size_t)bench_continued(_allow, _l->from, &(_l->destination));
+        }
+
+        uint64_t _start = bench_now();
+
+        for (size_t _i = 0; _i < BENCH_LOOKUPS; ++_i)
+            _sink += (size_t)ipv4_allow_allowed_is(_allow, _lookups[_i].from, &(_lookups[_i].destination));
+
+        uint64_t _middle = bench_now();
+
+        for (size_t _i = 0; _i < BENCH_LOOKUPS; ++_i)
+            _sink += (size_t)ipv4_classifier_allowed_is(_classifier, _lookups[_i].from, &(_lookups[_i].destination));
+
+        uint64_t _end = bench_now();
+
+        _linear   += _middle - _start;
+        _compiled += _end - _middle;
+        _total    += BENCH_LOOKUPS;
+        _rules    += _count;
+
+        ipv4_classifier_destroy(_classifier);
+        bench_rules_free(_allow);
+    }
+
+    free(_lookups);
+
+    if (0 != _result)
+        return _result;
+
+    if (0 == _continued) {
+        printf("no lookup continued after unmatched \"to\", rule sets don't cover it\n");
+        return 1;
+    }
+
+    printf("%lu lookups over %lu rule sets [%lu rules on average], %lu allowed, %lu continued after unmatched \"to\"\n",
+        (unsigned long)_total, (unsigned long)BENCH_SETS, (unsigned long)(_rules / BENCH_SETS), (unsigned long)_allowed, (unsigned long)_continued);
+
+    printf("list        %8.2f ns/lookup\n", (double)_linear   / (double)_total);
+    printf("classifier  %8.2f ns/lookup\n", (double)_compiled / (double)_total);
+
+    return 0;
+}
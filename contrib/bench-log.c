@@ -0,0 +1,157 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+/** KIM: per-packet cost of suppressed debug logging
+        relay loop repeats debug & verbose sites of source.c [resolved
+        destination, options walk, fragment queueing, options dump] around
+        header checksum, built twice by "make benchmarks":
+
+            obj/bench-log-0     LOG_LEVEL_MINIMUM 0, sites are compiled in
+                                and suppressed by mask [default build]
+            obj/bench-log-2     LOG_LEVEL_MINIMUM 2, debug & verbose are
+                                compiled out [make LOG_LEVEL=2]
+
+        "bare" row is the same loop without logging, "unguarded" row calls
+        log_write directly, as every site did before mask was checked inline,
+        both are the same for either build and show machine's noise
+**/
+
+#include "../src/ipv4.h"
+#include "../src/log.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+
+LOG_MODULE("bench-log");
+
+#define BENCH_PACKETS           (1024)
+#define BENCH_ROUNDS            (10000)     //~10M packets per pass
+#define BENCH_PASSES            (5)
+
+typedef
+struct _bench_packet {
+    ubyte_t                     header[24];
+    ipv4_t                      destination;
+    uint16_t                    port;
+    uint16_t                    length;
+} sbench_packet;
+
+static sbench_packet gpackets[BENCH_PACKETS];
+
+static __attribute__((noinline)) uint32_t
+bench_relay (
+    IN  const sbench_packet*    packet
+) {
+    LOG(debug, "resolved "IPV4_PRIADDR":%"PRIu16, IPV4_DPRIADDR(packet->destination), ntohs(packet->port));
+    LOG(debug, "iterating over received options");
+
+    uint32_t _sum = ipv4_checksum(packet->header, sizeof(packet->header));
+
+    LOG(debug, "option %d found", (int)packet->header[20]);
+    LOG(verbose, "sink %p: mtu is %"PRIu32, (const void*)packet, (uint32_t)packet->length);
+    LOG(debug, "queue fragment %10"PRIu32" [%6"PRIu32" = data %6"PRIu32" + head %3"PRIu32"]", (uint32_t)0, (uint32_t)(packet->length + 24), (uint32_t)packet->length, (uint32_t)24);
+    LOG_BINARY(debug, packet->header + 20, 4, "options");
+
+    return _sum;
+}
+
+static __attribute__((noinline)) uint32_t
+bench_relay_unguarded (
+    IN  const sbench_packet*    packet
+) {
+    log_write(elog_debug, MODULE, "resolved "IPV4_PRIADDR":%"PRIu16, IPV4_DPRIADDR(packet->destination), ntohs(packet->port));
+    log_write(elog_debug, MODULE, "iterating over received options");
+
+    uint32_t _sum = ipv4_checksum(packet->header, sizeof(packet->header));
+
+    log_write(elog_debug, MODULE, "option %d found", (int)packet->header[20]);
+    log_write(elog_verbose, MODULE, "sink %p: mtu is %"PRIu32, (const void*)packet, (uint32_t)packet->length);
+    log_write(elog_debug, MODULE, "queue fragment %10"PRIu32" [%6"PRIu32" = data %6"PRIu32" + head %3"PRIu32"]", (uint32_t)0, (uint32_t)(packet->length + 24), (uint32_t)packet->length, (uint32_t)24);
+    log_binary(elog_debug, MODULE, packet->header + 20, 4, "options");
+
+    return _sum;
+}
+
+static __attribute__((noinline)) uint32_t
+bench_relay_bare (
+    IN  const sbench_packet*    packet
+) { return ipv4_checksum(packet->header, sizeof(packet->header)); }
+
+static inline uint64_t
+bench_now (
+) {
+    struct timespec _ts;
+    clock_gettime(CLOCK_MONOTONIC, &_ts);
+    return ((uint64_t)_ts.tv_sec * 1000000000ULL) + (uint64_t)_ts.tv_nsec;
+}
+
+int
+main (
+) {
+    log_startup(LOGGING_DEFAULT_SUPPRESS);
+
+    uint32_t _seed = 0x2545F491;
+
+    for (size_t _i = 0; _i < BENCH_PACKETS; ++_i) {
+        for (size_t _j = 0; _j < sizeof(gpackets[_i].header); ++_j) {
+            _seed = (_seed * 1103515245) + 12345;
+            gpackets[_i].header[_j] = (ubyte_t)(_seed >> 16);
+        }
+
+        gpackets[_i].destination = htonl(0x0A020000 | (_seed & 0xFFFF));
+        gpackets[_i].port        = htons((uint16_t)(27000 + (_i & 0xFF)));
+        gpackets[_i].length      = (uint16_t)(64 + (_seed % 1400));
+    }
+
+    volatile uint32_t _sink = 0;
+
+    //best of passes, machine noise only adds
+    uint64_t _relay     = ~((uint64_t)0);
+    uint64_t _unguarded = ~((uint64_t)0);
+    uint64_t _bare      = ~((uint64_t)0);
+
+    for (size_t _pass = 0; _pass < BENCH_PASSES; ++_pass) {
+        uint64_t _start = bench_now();
+
+        for (size_t _r = 0; _r < BENCH_ROUNDS; ++_r)
+            for (size_t _i = 0; _i < BENCH_PACKETS; ++_i)
+                _sink += bench_relay(&(gpackets[_i]));
+
+        uint64_t _middle = bench_now();
+
+        for (size_t _r = 0; _r < BENCH_ROUNDS; ++_r)
+            for (size_t _i = 0; _i < BENCH_PACKETS; ++_i)
+                _sink += bench_relay_unguarded(&(gpackets[_i]));
+
+        uint64_t _unguarded_end = bench_now();
+
+        for (size_t _r = 0; _r < BENCH_ROUNDS; ++_r)
+            for (size_t _i = 0; _i < BENCH_PACKETS; ++_i)
+                _sink += bench_relay_bare(&(gpackets[_i]));
+
+        uint64_t _end = bench_now();
+
+        if ((_middle - _start) < _relay)
+            _relay = _middle - _start;
+
+        if ((_unguarded_end - _middle) < _unguarded)
+            _unguarded = _unguarded_end - _middle;
+
+        if ((_end - _unguarded_end) < _bare)
+            _bare = _end - _unguarded_end;
+    }
+
+    double _packets = (double)BENCH_ROUNDS * (double)BENCH_PACKETS;
+
+    printf("LOG_LEVEL_MINIMUM %d, %.0f packets, best of %d passes, 6 debug & verbose sites per packet\n", (int)LOG_LEVEL_MINIMUM, _packets, BENCH_PASSES);
+    printf("bare        %8.2f ns/packet\n", (double)_bare      / _packets);
+    printf("relay       %8.2f ns/packet\n", (double)_relay     / _packets);
+    printf("unguarded   %8.2f ns/packet\n", (double)_unguarded / _packets);
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#!/bin/sh
+#
+#   fan-out cost to many sinks, over veth pairs
+#
+#       nsA [xa0 10.201.0.2] <-> xa1 10.201.0.1 [bproxy] xb1 10.202.0.1 <-> nsB [xb0 10.202.0.2]
+#
+#   one source with SINKS join sinks, all but first are rejected by port-range,
+#   so every datagram walks whole sink list [more than SOURCE_FLOW_SINKS sinks
+#   aren't cached] and sends once. bproxy is measured by "perf stat" while
+#   datagrams are sent, cache misses per datagram are reported. without perf
+#   or hardware counters [virtual machines] cpu time per datagram is reported
+#
+#   usage [as root]: contrib/perf-sinks.sh [path to bproxy] [datagrams] [sinks]
+#
+
+BPROXY=${1:-./bproxy}
+COUNT=${2:-100000}
+SINKS=${3:-256}
+PORT=27036
+
+NSA=bpx-perf-a
+NSB=bpx-perf-b
+WORK=
+
+cleanup() {
+    [ -n "$PID" ] && kill -INT "$PID" 2>/dev/null
+    ip netns del $NSA 2>/dev/null
+    ip netns del $NSB 2>/dev/null
+    ip link del xa1 2>/dev/null
+    ip link del xb1 2>/dev/null
+    [ -n "$WORK" ] && rm -rf "$WORK"
+}
+
+fail() {
+    echo "FAILED: $*"
+    [ -f "$WORK/bproxy.log" ] && tail -n 20 "$WORK/bproxy.log"
+    cleanup
+    exit 1
+}
+
+#utime + stime of process, clock ticks
+cputime() {
+    sed 's/.*) //' "/proc/$1/stat" | awk '{ print $12 + $13 }'
+}
+
+[ "$(id -u)" = "0" ] || { echo "must be run as root"; exit 1; }
+[ -x "$BPROXY" ]     || { echo "bproxy binary not found [$BPROXY]"; exit 1; }
+command -v python3 >/dev/null || { echo "python3 is required"; exit 1; }
+
+trap cleanup INT TERM
+
+cleanup
+WORK=$(mktemp -d)
+
+ip netns add $NSA && ip netns add $NSB                          || fail "can't create namespaces"
+ip link add xa1 type veth peer name xa0 && ip link set xa0 netns $NSA   || fail "can't create veth"
+ip link add xb1 type veth peer name xb0 && ip link set xb0 netns $NSB   || fail "can't create veth"
+
+ip addr add 10.201.0.1/24 brd + dev xa1 && ip link set xa1 up
+ip addr add 10.202.0.1/24 brd + dev xb1 && ip link set xb1 up
+
+ip netns exec $NSA sh -c "ip addr add 10.201.0.2/24 brd + dev xa0 && ip link set xa0 up && ip link set lo up"
+ip netns exec $NSB sh -c "ip addr add 10.202.0.2/24 brd + dev xb0 && ip link set xb0 up && ip link set lo up"
+
+{
+    echo "source $PORT"
+    echo "    device xa1"
+    echo "    join xb1 no route"
+
+    i=1
+    while [ $i -lt "$SINKS" ]; do
+        echo "    join xb1 no route"
+        echo "        port-range 1000"
+        i=$((i + 1))
+    done
+} > "$WORK/perf-sinks.cfg"
+
+"$BPROXY" -c "$WORK/perf-sinks.cfg" > "$WORK/bproxy.log" 2>&1 &
+PID=$!
+sleep 1
+
+kill -0 $PID 2>/dev/null || fail "bproxy isn't running"
+
+PERF=
+if command -v perf >/dev/null; then
+    perf stat -x, -e cache-misses,cache-references,instructions -p $PID -o "$WORK/perf" &
+    PERF=$!
+    sleep 0.5
+fi
+
+BEFORE=$(cputime $PID)
+
+ip netns exec $NSA python3 - $COUNT $PORT <<'EOF'
+import socket, sys
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+for i in range(int(sys.argv[1])):
+    s.sendto(b'%06d' % i + b'x' * 58, ('10.201.0.255', int(sys.argv[2])))
+EOF
+
+sleep 0.5
+AFTER=$(cputime $PID)
+
+if [ -n "$PERF" ]; then
+    kill -INT $PERF; wait $PERF
+fi
+
+kill -INT $PID; wait $PID; PID=
+
+RECEIVED=$(sed -n 's/.*source: .* received \([0-9]*\) .*/\1/p' "$WORK/bproxy.log" | tail -n 1)
+REJECTED=$(sed -n 's/.*sink: .* relayed [0-9]* .*rejected by port-range \([0-9]*\),.*/\1/p' "$WORK/bproxy.log" | awk '{ s += $1 } END { print s + 0 }')
+
+[ -n "$RECEIVED" ] && [ "$RECEIVED" -gt 0 ] || fail "nothing was received"
+
+echo "$SINKS sinks, $RECEIVED datagrams received, $REJECTED sink rejections by port-range"
+
+TICKS=$(getconf CLK_TCK)
+awk -v t=$((AFTER - BEFORE)) -v hz="$TICKS" -v n="$RECEIVED" \
+    'BEGIN { printf "cpu time     %10.0f ns/datagram\n", t * 1e9 / hz / n }'
+
+if [ -n "$PERF" ]; then
+    for EVENT in cache-misses cache-references instructions; do
+        VALUE=$(grep ",$EVENT" "$WORK/perf" | cut -d, -f1)
+
+        case "$VALUE" in
+            ''|'<not supported>'|'<not counted>')
+                echo "$EVENT is not available [no hardware counters]" ;;
+            *)
+                awk -v v="$VALUE" -v n="$RECEIVED" -v e="$EVENT" \
+                    'BEGIN { printf "%-16s %10.1f per datagram\n", e, v / n }' ;;
+        esac
+    done
+else
+    echo "perf isn't found, cache misses aren't measured"
+fi
+
+cleanup
+exit 0
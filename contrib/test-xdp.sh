@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+#   af-xdp source relaying to packet transport sink, over veth pairs
+#
+#       nsA [xa0 10.201.0.2] <-> xa1 10.201.0.1 [bproxy] xb1 10.202.0.1 <-> nsB [xb0 10.202.0.2]
+#
+#   broadcasts sent to 10.201.0.255 in nsA must reach nsB, veth has no zero copy,
+#   so copy mode and in place sending by shared umem are exercised
+#
+#   usage [as root]: contrib/test-xdp.sh [path to bproxy] [datagrams]
+#
+
+BPROXY=${1:-./bproxy}
+COUNT=${2:-200}
+PORT=27036
+
+NSA=bpx-test-a
+NSB=bpx-test-b
+WORK=
+
+cleanup() {
+    [ -n "$PID" ] && kill -INT "$PID" 2>/dev/null
+    ip netns del $NSA 2>/dev/null
+    ip netns del $NSB 2>/dev/null
+    ip link del xa1 2>/dev/null
+    ip link del xb1 2>/dev/null
+    [ -n "$WORK" ] && rm -rf "$WORK"
+}
+
+fail() {
+    echo "FAILED: $*"
+    [ -f "$WORK/bproxy.log" ] && tail -n 20 "$WORK/bproxy.log"
+    cleanup
+    exit 1
+}
+
+[ "$(id -u)" = "0" ] || { echo "must be run as root"; exit 1; }
+[ -x "$BPROXY" ]     || { echo "bproxy binary not found [$BPROXY]"; exit 1; }
+command -v python3 >/dev/null || { echo "python3 is required"; exit 1; }
+
+trap cleanup INT TERM
+
+cleanup
+WORK=$(mktemp -d)
+
+ip netns add $NSA && ip netns add $NSB                          || fail "can't create namespaces"
+ip link add xa1 type veth peer name xa0 && ip link set xa0 netns $NSA   || fail "can't create veth"
+ip link add xb1 type veth peer name xb0 && ip link set xb0 netns $NSB   || fail "can't create veth"
+
+ip addr add 10.201.0.1/24 brd + dev xa1 && ip link set xa1 up
+ip addr add 10.202.0.1/24 brd + dev xb1 && ip link set xb1 up
+
+ip netns exec $NSA sh -c "ip addr add 10.201.0.2/24 brd + dev xa0 && ip link set xa0 up && ip link set lo up"
+ip netns exec $NSB sh -c "ip addr add 10.202.0.2/24 brd + dev xb0 && ip link set xb0 up && ip link set lo up"
+
+cat > "$WORK/test-xdp.cfg" <<EOF
+source raw
+    device xa1
+    port-range $PORT
+    xdp default
+
+    join xb1 no route
+        transport packet
+EOF
+
+"$BPROXY" -c "$WORK/test-xdp.cfg" --verbose > "$WORK/bproxy.log" 2>&1 &
+PID=$!
+sleep 1
+
+kill -0 $PID 2>/dev/null || fail "bproxy isn't running"
+ip -d link show xa1 | grep -q "prog/xdp" || fail "xdp program isn't attached to xa1"
+
+ip netns exec $NSB python3 - $PORT > "$WORK/received" <<'EOF' &
+import socket, sys
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 << 20)
+s.bind(('', int(sys.argv[1])))
+s.settimeout(2)
+n = 0
+try:
+    while True:
+        s.recv(65536)
+        n += 1
+except socket.timeout:
+    pass
+print(n)
+EOF
+RECEIVER=$!
+sleep 0.5
+
+ip netns exec $NSA python3 - $COUNT $PORT <<'EOF'
+import socket, sys, time
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+for i in range(int(sys.argv[1])):
+    s.sendto(b'%06d' % i + b'x' * 94, ('10.201.0.255', int(sys.argv[2])))
+    if 0 == (i % 16):
+        time.sleep(0.001)
+EOF
+
+wait $RECEIVER
+
+kill -INT $PID; wait $PID; PID=
+
+RECEIVED=$(cat "$WORK/received")
+POSTED=$(sed -n 's/.*sink: .* framed, \([0-9]*\) posted.*/\1/p' "$WORK/bproxy.log" | tail -n 1)
+
+grep -q "af-xdp queue 0 .*copy\]"   "$WORK/bproxy.log" || fail "af-xdp socket isn't bound in copy mode"
+grep -q "sends in place by af-xdp"   "$WORK/bproxy.log" || fail "sink doesn't share umem"
+ip -d link show xa1 | grep -q "prog/xdp"   && fail "xdp program is left attached"
+
+[ "$RECEIVED" = "$COUNT" ] || fail "received $RECEIVED of $COUNT datagrams"
+[ -n "$POSTED" ] && [ "$POSTED" -gt 0 ] || fail "nothing was sent in place [posted ${POSTED:-?}]"
+
+echo "OK: $RECEIVED of $COUNT datagrams relayed, $POSTED sent in place"
+cleanup
+exit 0
@@ -4,15 +4,6 @@
 **/
 
 /** TODO(ideas, but i too lazy for it):
-        track statistics
-
-        reload (SIGHUP)
-            change @gcfg to pointer
-            reload request, try:
-                - load configuration to new sconfiguration structure (memory usage at this step?)
-                - replace current @gcfg with new
-                - cleanup old @gcfg
-
         allow to set limits to sources recvmsg loop (max packets per tick):
             some "fair play" for sources, cuz' we can "block" in recv loop
             ... if some source receive packets faster that relay
@@ -37,6 +28,9 @@
 #include "poll.h"
 #include "rtlink.h"
 #include "timer.h"
+#include "worker.h"
+#include "control.h"
+#include "socket-pool.h"
 
 #include <string.h>
 
@@ -52,9 +46,33 @@ LOG_MODULE("bproxy");
 
 #define FWORKING                (1)
 #define FRELOAD_CONFIGURATION   (2)
+#define FREOPEN_LOG             (4)
+#define FRESTART_SOURCES        (8)
+
+#define FSIGNALED               (FRELOAD_CONFIGURATION | FREOPEN_LOG | FRESTART_SOURCES)
+
+static volatile sig_atomic_t    gworking = FWORKING;
+static sconfiguration           gcfg;
+static sconfiguration           gretired;   //sources retired by last reload, released by next one
+static sworkers                 gworkers = { 0, NULL };
+
+//main's runtime which reload touches
+typedef
+struct _main_runtime {
+    srtlink*                    rtlink;
+    spoll**                     polls;
+    size_t                      polls_count;
+
+    stimer_simple*              timer_reload;
+    stimer*                     timer_sources;
+    stimer_simple*              timer_statistics;
 
-static int              gworking = FWORKING;
-static sconfiguration   gcfg;
+    scontrol*                   control;    //NULL - disabled
+} smain_runtime;
+
+static rsysctl
+main_sysctl_warmup(
+);
 
 static void
 main_sighandler (
@@ -67,27 +85,138 @@ main_sighandler (
                 exit(4);
             }
 
-            gworking &= ~(FWORKING | FRELOAD_CONFIGURATION);
+            __atomic_fetch_and(&gworking, ~(FWORKING | FRELOAD_CONFIGURATION), __ATOMIC_SEQ_CST);
             break;
 
         case SIGHUP:
-            if (0 == (FRELOAD_CONFIGURATION & gworking))
-                gworking |= FRELOAD_CONFIGURATION;
-
+            __atomic_fetch_or(&gworking, FRELOAD_CONFIGURATION, __ATOMIC_SEQ_CST);
             break;
 
+        //applied by main loop, cuz' workers may relay right now
         case SIGUSR1:
-            if (rlog_ok != log_reopen(gcfg.log))
-                LOG(critical, "can't reopen log file");
-
+            __atomic_fetch_or(&gworking, FREOPEN_LOG, __ATOMIC_SEQ_CST);
             break;
 
         case SIGUSR2:
-            sources_restart(gcfg.sources);
+            __atomic_fetch_or(&gworking, FRESTART_SOURCES, __ATOMIC_SEQ_CST);
             break;
     }
 }
 
+//clears request [never bits owned by handler], 1 - it was set
+static inline int
+main_signal_take (
+        int                 flag
+) { return (0 != (__atomic_fetch_and(&gworking, ~flag, __ATOMIC_SEQ_CST) & flag)); }
+
+static void
+main_retired_release (
+) {
+    sources_release(gretired.sources);
+    configuration_cleanup(&gretired);
+}
+
+//interval timers follow reloaded values, 0 - disabled
+static void
+main_timer_rearm (
+    BTH stimer_simple*      timer,
+        unsigned long       current,
+        unsigned long       next
+) {
+    if (current == next)
+        return;
+
+    if (0 == next) {
+        timer_simple_disarm(timer);
+        return;
+    }
+
+    if (rtimer_ok != timer_simple_arm(timer, next * TIMER_SHIFT_SEC))
+        LOG(error, "can't arm timer");
+}
+
+/** KIM: reload
+        called between poll_wait iterations of main thread, with workers locked,
+        so sources are swapped while nobody relays. new configuration is parsed
+        aside, running one is kept untouched if parsing or new sources' bootup
+        failed
+**/
+static void
+main_reload (
+    BTH smain_runtime*      runtime
+) {
+    sconfiguration _next;
+
+    //"be" tokens of new file are applied by parsing, kept only with configuration
+    uint32_t _suppression = glog_suppression;
+
+    if (rconfiguration_ok != configuration_reload(&gcfg, &_next)) {
+        LOG(error, "can't reload configuration, running one is kept");
+        return;
+    }
+
+    ssource* _retired = gcfg.sources;
+
+    if (rsource_ok != sources_reload(&_retired, &(_next.sources), runtime->rtlink, runtime->polls, runtime->polls_count, gcfg.buffer_size)) {
+        configuration_cleanup(&_next);
+        log_suppression(_suppression);
+
+        LOG(error, "can't apply configuration, running one is kept");
+        return;
+    }
+
+    //previous retired sources had whole poll iteration to drop their stale events
+    main_retired_release();
+
+    main_timer_rearm(runtime->timer_reload,     gcfg.reload,     _next.reload);
+    main_timer_rearm(runtime->timer_statistics, gcfg.statistics, _next.statistics);
+
+    if (gcfg.restore != _next.restore) {
+        if (0 == _next.restore)
+            timer_disarm(runtime->timer_sources);
+        else if (rtimer_ok != timer_arm(runtime->timer_sources, _next.restore * TIMER_SHIFT_SEC))
+            LOG(error, "can't arm restore timer");
+    }
+
+    gcfg.sources = NULL;
+    configuration_cleanup(&gcfg);
+
+    gcfg = _next;
+
+    configuration_initialize(&gretired);
+    gretired.sources = _retired;
+
+    if NOT_NULL_IS(runtime->control)
+        runtime->control->sources = gcfg.sources;
+
+    LOG(information, "configuration reloaded");
+}
+
+static void
+main_signaled (
+    BTH smain_runtime*      runtime
+) {
+    workers_lock(&gworkers);
+
+    if (0 != main_signal_take(FREOPEN_LOG))
+        if (rlog_ok != log_reopen(gcfg.log))
+            LOG(critical, "can't reopen log file");
+
+    if (0 != main_signal_take(FRESTART_SOURCES))
+        sources_restart(gcfg.sources);
+
+    if (0 != main_signal_take(FRELOAD_CONFIGURATION)) {
+        LOG(verbose, "reload requested");
+
+        if (rsysctl_ok != main_sysctl_warmup())
+            LOG(warning, "sysctl warmup failed");
+
+        main_reload(runtime);
+    }
+
+    workers_unlock(&gworkers);
+}
+
 static rtimer
 main_timer_reload (
         stimer_simple*      timer,
@@ -96,14 +225,38 @@ main_timer_reload (
     if (rnetlink_ok != rtlink_reload((srtlink*)passthrou))
         LOG(warning, "netlink reload failed");
 
+    if (0 == gcfg.reload)
+        return rtimer_ok;
+
     return timer_simple_arm(timer, gcfg.reload * TIMER_SHIFT_SEC);
 }
 
+static rtimer
+main_timer_statistics (
+        stimer_simple*      timer,
+        void*               passthrou
+) {
+    (void)passthrou;
+
+    //sources are replaced by reload
+    sources_statistics(gcfg.sources);
+    socket_pool_statistics();
+
+    if (0 == gcfg.statistics)
+        return rtimer_ok;
+
+    return timer_simple_arm(timer, gcfg.statistics * TIMER_SHIFT_SEC);
+}
+
 static rtimer
 main_timer_restore (
         stimer*             timer
 ) {
     sources_start(gcfg.sources);
+
+    if (0 == gcfg.restore)
+        return rtimer_ok;
+
     return timer_arm(timer, gcfg.restore * TIMER_SHIFT_SEC);
 }
 
@@ -142,6 +295,9 @@ main (
 
     stimer_simple   _timer_rtlink_reload;
     stimer          _timer_sources;
+    stimer_simple   _timer_statistics;
+
+    scontrol        _control;
 
     signal(SIGINT,  main_sighandler);
     signal(SIGTERM, main_sighandler);
@@ -154,6 +310,7 @@ main (
     int _exit_code = EXIT_FAILURE;
 
     configuration_initialize(&gcfg);
+    configuration_initialize(&gretired);
     if (rconfiguration_ok != configuration(argc, argv, &gcfg))
         goto _failure_configure;
 
@@ -188,6 +345,24 @@ main (
         goto _failure_poll_thread;
     }
 
+    spoll* _polls[WORKERS_MAXIMUM] = { &_poll };
+    size_t _polls_count            = 1;
+
+    if (0 < gcfg.threads) {
+        if (rworker_ok != workers_create(&gworkers, gcfg.threads, gcfg.buffer_size, gcfg.events)) {
+            LOG(critical, "can't create worker threads");
+            goto _failure_workers;
+        }
+
+        for (size_t _i = 0; _i < gworkers.count; ++_i)
+            _polls[_i] = workers_poll(&gworkers, _i);
+
+        _polls_count = gworkers.count;
+
+        //control plane [rtlink, timers] touches sources, so workers must be stopped while it dispatching
+        poll_guard_set(&_poll, workers_lock, workers_unlock, &gworkers);
+    }
+
     if (rnetlink_ok != rtlink_create(&_rtlink, &_poll, gcfg.rtlink_hash)) {
         LOG(critical, "can't work without netlink:rtlink");
         goto _failure_rtlink;
@@ -198,7 +373,7 @@ main (
         goto _failure_rtlink_poll;
     }
 
-    if (rsource_ok != sources_bootup(gcfg.sources, &_rtlink, &_poll)) {
+    if (rsource_ok != sources_bootup(gcfg.sources, &_rtlink, _polls, _polls_count, gcfg.buffer_size)) {
         LOG(critical, "bootup failed");
         goto _failure_sources_bootup;
     }
@@ -218,6 +393,17 @@ main (
         goto _failure_timer_sources_attach;
     }
 
+    if (rtimer_ok != timer_simple_startup(&_timer_statistics, &_poll, main_timer_statistics, NULL)) {
+        LOG(critical, "can't startup statistics timer");
+        goto _failure_timer_statistics;
+    }
+
+    if (NULL != gcfg.control)
+        if (rcontrol_ok != control_create(&_control, &_poll, gcfg.control, gcfg.sources, &_rtlink)) {
+            LOG(critical, "can't create control socket");
+            goto _failure_control;
+        }
+
     if (rnetlink_ok != rtlink_reload(&_rtlink)) {
         LOG(critical, "can't reload rtlink");
         goto _failure_rtlink_reload;
@@ -240,6 +426,31 @@ main (
             goto _failure_timer_arm;
         }
 
+    if (0 != gcfg.statistics)
+        if (rtimer_ok != timer_simple_arm(&_timer_statistics, gcfg.statistics * TIMER_SHIFT_SEC)) {
+            LOG(critical, "can't arm statistics timer");
+            goto _failure_timer_arm;
+        }
+
+    //file i/o leaves relay threads from here
+    if (rlog_ok != log_async_start())
+        LOG(warning, "log is written synchronously");
+
+    if (rworker_ok != workers_start(&gworkers)) {
+        LOG(critical, "can't start worker threads");
+        goto _failure_workers_start;
+    }
+
+    smain_runtime _runtime = {
+            &_rtlink
+        ,   _polls
+        ,   _polls_count
+        ,   &_timer_rtlink_reload
+        ,   &_timer_sources
+        ,   &_timer_statistics
+        ,   (NULL != gcfg.control)?&_control:NULL
+    };
+
     LOG(information, "ready...");
 
     _exit_code = EXIT_SUCCESS;
@@ -252,16 +463,8 @@ main (
             break;
 
         case rpoll_interrupted:
-            if (0 != (gworking & FRELOAD_CONFIGURATION)) {
-                gworking &= ~(FRELOAD_CONFIGURATION);
-
-                LOG(verbose, "reload requested");
-
-                if (rsysctl_ok != main_sysctl_warmup())
-                    LOG(warning, "sysctl warmup failed");
-
-                //TODO(iybego#9): reload configuration
-            }
+            if (0 != (gworking & FSIGNALED))
+                main_signaled(&_runtime);
 
             break;
 
@@ -273,6 +476,8 @@ main (
     LOG(information, "stoping...");
 
     _failure_loop:
+    _failure_workers_start:
+        workers_stop(&gworkers);
 
     _failure_timer_arm:
 
@@ -280,6 +485,13 @@ main (
 
     _failure_rtlink_reload:
 
+        if (NULL != gcfg.control)
+            control_destroy(&_control);
+    _failure_control:
+
+        timer_simple_cleanup(&_timer_statistics);
+    _failure_timer_statistics:
+
         timer_detach(&_timer_sources);
     _failure_timer_sources_attach:
 
@@ -290,6 +502,7 @@ main (
     _failure_timer_reload:
 
         sources_cleanup(gcfg.sources, NULL);
+        main_retired_release();
     _failure_sources_bootup:
 
         rtlink_detach(&_rtlink);
@@ -298,6 +511,9 @@ main (
         rtlink_destroy(&_rtlink);
     _failure_rtlink:
 
+        workers_destroy(&gworkers);
+    _failure_workers:
+
         poll_thread_detach(&_poll_thread, &_poll);
     _failure_poll_thread:
 
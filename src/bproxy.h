@@ -9,9 +9,47 @@
 #include <linux/netlink.h>
 #include <netinet/in.h>
 
-#define VERSION                         "0.16.11.13"
+#define VERSION                         "0.26.10.17"
 
 /** CHANGELOG:
+        0.26.10.17 - batched receiving [recvmmsg]
+                   - queued transmitting [sendmmsg]
+                   - fixed fragmentation: udp header only in first fragment
+                   - prebuilt sink headers and cached ip options rewrite
+                   - worker threads
+                   - source lanes [reuseport sockets per source]
+                   - kernel side prefilter [classic bpf socket filter]
+                   - compiled allow lists [multibit trie]
+                   - compiled port-ranges [two level bitmap]
+                   - flow decision cache
+                   - statistics [per source & sink counters]
+                   - control socket [prometheus text format]
+                   - latency histograms [socket queue, processing & sending]
+                   - compiled sources [sinks, allow lists & m-groups in one arena]
+                   - sinks split into hot [one cache line] & cold parts
+                   - udp transport for sinks [payloads coalesced by UDP_SEGMENT]
+                   - coalesced receiving for simple sources [UDP_GRO]
+                   - af-packet rx ring for raw sources [TPACKET_V3]
+                   - af-packet tx ring for sinks' broadcasts [TPACKET_V2, prebuilt ethernet header]
+                   - af-xdp receiving for raw sources [filter translated to xdp program], relayed in place by shared umem
+
+            [+] "batch" option
+            [+] "threads" option
+            [+] "workers" option
+            [+] "statistics" option [was parsed, but ignored]
+            [+] "control" option
+            [+] "latency" option
+            [+] build time minimum log level [make LOG_LEVEL=n]
+            [*] log lines are written by own thread through ring, when proxy is ready
+            [+] configuration reload [SIGHUP], unchanged sources keep their sockets
+            [*] sinks share raw sockets [per device, flags & mark], which discard received datagrams
+            [+] raw sockets receive memory [SO_MEMINFO] in statistics & control
+            [*] "fwmark" is applied whenever it was specified [was checked against mark value]
+            [+] "transport" option
+            [+] "gro" option
+            [+] "ring" option
+            [+] "xdp" option
+
         0.16.11.13 - Bug Fix
 
             [+] "sink original" option
@@ -63,8 +101,37 @@
 #define DEFAULT_BUFFER_SIZE             (64*1024)
 #define LOG_BUFFER_SIZE                 (256)
 
+#define LOG_RING_SIZE                   (1024)  //lines, power of 2
+#define LOG_RING_IDLE                   (10)    //ms, writer's sleep while ring is empty
+
+#if !defined(LOG_LEVEL_MINIMUM)
+#define LOG_LEVEL_MINIMUM               (0)     //elog level, lower ones are compiled out [make LOG_LEVEL=2 - no debug & verbose]
+#endif
+
 #define RTLINK_MAX_EVENTS_PER_TICK      (512)
 #define SOURCE_MAX_PACKETS_PER_TICK     (64)
+#define SOURCE_MAX_BATCH                (SOURCE_MAX_PACKETS_PER_TICK)
+#define SOURCE_TX_QUEUE_LENGTH          (256)
+#define SINK_OPTIONS_CACHE_SIZE         (4)
+#define ALLOW_CLASSIFIER_MINIMUM        (8)     //allow rules, shorter lists are walked
+#define SOURCE_FLOW_CACHE_SIZE          (256)   //entries per source [lane], power of 2
+#define SOURCE_FLOW_SINKS               (8)     //sinks per cached flow, otherwise flow isn't cached
+#define SOURCE_RING_RETIRE              (2)     //ms, af-packet ring block is handed to userspace after, even if it isn't full
+#define SOURCE_RING_MAXIMUM_BLOCKS      (4096)
+#define SINK_RING_FRAMES                (256)   //af-packet tx ring of sink [lane], frame fits device's mtu
+#define SOURCE_XDP_FRAMES               (4096)  //af-xdp umem frames of source [lane] by default, power of 2
+#define SOURCE_XDP_MINIMUM_FRAMES       (1024)  //above sink's tx & completion rings [2 * SINK_XDP_ENTRIES] and rx budget
+#define SOURCE_XDP_MAXIMUM_FRAMES       (256 * 1024)
+#define SOURCE_XDP_RECLAIM              (1)     //ms, frames held by sinks are reclaimed after, even if nothing is received
+#define SINK_XDP_ENTRIES                (256)   //af-xdp tx & completion rings of sink [lane], power of 2
+
+#define WORKERS_MAXIMUM                 (64)
+#define CACHE_LINE_SIZE                 (64)
+
+#define METRICS_BUFFER_SIZE             (4*1024)
+#define CONTROL_BACKLOG                 (8)
+#define CONTROL_CLIENTS_MAXIMUM         (8)
+#define CONTROL_CLIENT_TIMEOUT          (5)     //seconds, slow client is dropped after
 
 #define LOGGING_DEFAULT_SUPPRESS        (LOG_LEVEL_MASK(debug) | LOG_LEVEL_MASK(verbose))
 #define LOGGING_SILENT_SUPPRESS         (LOGGING_DEFAULT_SUPPRESS | LOG_LEVEL_MASK(information))
@@ -96,6 +163,12 @@
         +   _CMSG_NEED_SPACE(struct sockaddr_in)    \
         +   _CMSG_NEED_SPACE(uint8_t /* ttl */)     \
         +   _CMSG_NEED_SPACE(uint8_t /* tos */)     \
+        +   _CMSG_NEED_SPACE(struct timespec)       \
+        +   _CMSG_NEED_SPACE(int /* gro segment */) \
+    )
+
+#define SOURCE_RAW_CONTROL_LENGTH                   \
+    (       _CMSG_NEED_SPACE(struct timespec)       \
     )
 
 #include <stdlib.h>
@@ -29,6 +29,19 @@ struct _configuration_opts {
     sconfiguration_opts*    next;
 };
 
+static void
+_configuration_opts_free (
+    BTH sconfiguration_opts*    opts
+) {
+    while (NULL != opts) {
+        sconfiguration_opts* _c = opts;
+        opts = opts->next;
+
+        free(_c->name);
+        free(_c);
+    }
+}
+
 static void
 configuration_help (
         const char*                   self
@@ -70,11 +83,15 @@ configuration_help (
     LOG(information, "");
     LOG(information, "   restore     [second]                  - try to restore sources every X seconds");
     LOG(information, "   reload      [second]                  - reload devices list every X seconds");
+    LOG(information, "   statistics  [second]                  - log sources & sinks counters every X seconds");
+    LOG(information, "   control     [path]                    - unix socket, serves counters in prometheus text format");
     LOG(information, "");
     LOG(information, "   buffer      [bytes]                   - packet buffer size");
     LOG(information, "   rtlink-hash [factor]                  - rtlink hash size factor");
     LOG(information, "   events      [count]                   - epoll events buffer");
     LOG(information, "               automatic                 - determinate events size by sources count");    
+    LOG(information, "   threads     [count]                   - relay in worker threads, sources spread among them");
+    LOG(information, "               none                      - relay in main thread [default]");
     LOG(information, "");
     LOG(information, "   source      [port]                   *- start source at port");
     LOG(information, "               raw                      *- start raw source [you must specify port-range]");
@@ -91,6 +108,18 @@ configuration_help (
     LOG(information, "                  ip-ttl                 - disable ip ttl receiving");
     LOG(information, "");
     LOG(information, "       rate-limit [rate:window]          - drop packets if rate-limit exceeded [window in ms]");
+    LOG(information, "       batch      [count]                - receive up to count datagrams per syscall [recvmmsg, default 1]");
+    LOG(information, "       workers    [count]                - receive by count reuseport sockets, spread among threads");
+    LOG(information, "                  [count]:cpu            - ... steered by receiving cpu [nic rss queue]");
+    LOG(information, "       latency    [none|process|kernel]  - latency histograms: processing & sending, kernel - socket queueing too");
+    LOG(information, "       gro        [on|off]               - receive same flow datagrams coalesced [UDP_GRO], simple source only");
+    LOG(information, "       ring       [blocks:kbytes]        - receive by af-packet mmap ring [TPACKET_V3], raw source only,");
+    LOG(information, "                                           ... ip fragments aren't relayed, cuz' they are never reassembled");
+    LOG(information, "       xdp        [frames]               - receive by af-xdp socket per worker [device's queue], raw source only,");
+    LOG(information, "                                           ... workers must match device's rx queues [ethtool -l],");
+    LOG(information, "                                           ... filter runs as xdp program [fragments go to kernel],");
+    LOG(information, "                                           ... packet transport sinks on other devices send in place [copy mode]");
+    LOG(information, "                  default                - ... of %u frames", (unsigned int)SOURCE_XDP_FRAMES);
     LOG(information, "       port-range [from:to]             *- allow receiving to port range");
     LOG(information, "                  any                    - synonim for 0:65535");
     LOG(information, "");
@@ -121,6 +150,12 @@ configuration_help (
     LOG(information, "           security [level:categories]   - set ip security");
     LOG(information, "                    drop                 - remove security mark");
     LOG(information, "");
+    LOG(information, "           transport raw                 - send prebuilt ip datagrams [default]");
+    LOG(information, "                    udp                  - send by udp socket bound to \"from\" [port other than source's required],");
+    LOG(information, "                                           ... batch is coalesced by UDP_SEGMENT, ip options & ids are kernel's");
+    LOG(information, "                    packet               - broadcasts are framed into af-packet tx ring of ethernet device,");
+    LOG(information, "                                           ... bypassing routing & netfilter, others are sent as raw");
+    LOG(information, "");
     LOG(information, "           no       route                - send only to directly connected hosts");
     LOG(information, "                    broadcast            - disable sending to broadcast addresses");
     LOG(information, "                    fragment             - disable messages fragmentation");
@@ -178,7 +213,7 @@ configuration_help (
     LOG(information, "  finally: source's binding port");
     LOG(information, "");
     LOG(information, "Signals:");
-    LOG(information, "  HUP     - reload configuration");
+    LOG(information, "  HUP     - reload configuration [threads, buffer, rtlink-hash, log & control need restart]");
     LOG(information, "  USR1    - reopen log file");
     LOG(information, "  USR2    - restart sources");
     LOG(information, "");
@@ -186,6 +221,209 @@ configuration_help (
     LOG(information, "");
 }
 
+static rconfiguration
+configuration_token_batch (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"batch\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    unsigned long _count;
+
+    if (1 > sscanf(value, "%lu", &_count)) {
+        LOG(error, "wrong \"batch\" value specified, try to read --help");
+        return rconfiguration_failed;
+    }
+
+    if ((1 > _count) || (SOURCE_MAX_BATCH < _count)) {
+        LOG(error, "wrong \"batch\" value, should be in [1, %u]", (unsigned int)SOURCE_MAX_BATCH);
+        return rconfiguration_failed;
+    }
+
+    cfg->sources->batch = _count;
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_token_latency (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"latency\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    if (0 == strcasecmp("none", value)) {
+        cfg->sources->latency = esource_latency_none;
+
+    } else if (0 == strcasecmp("process", value)) {
+        cfg->sources->latency = esource_latency_process;
+
+    } else if (0 == strcasecmp("kernel", value)) {
+        cfg->sources->latency = esource_latency_kernel;
+
+    } else {
+        LOG(error, "wrong \"latency\" value %s, try to read --help", value);
+        return rconfiguration_failed;
+    }
+
+    if (esource_latency_kernel == cfg->sources->latency)
+        cfg->sources->flg_socket |=   FSOCKET_TIMESTAMP;
+    else
+        cfg->sources->flg_socket &= (~FSOCKET_TIMESTAMP);
+
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_token_gro (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"gro\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    if (esource_type_raw == cfg->sources->type) {
+        LOG(error, "\"gro\" have no sence for raw source, it receives ip datagrams");
+        return rconfiguration_failed;
+    }
+
+    if (0 == strcasecmp("on", value)) {
+        cfg->sources->flg_socket |=   FSOCKET_GRO;
+
+    } else if (0 == strcasecmp("off", value)) {
+        cfg->sources->flg_socket &= (~FSOCKET_GRO);
+
+    } else {
+        LOG(error, "wrong \"gro\" value %s, try to read --help", value);
+        return rconfiguration_failed;
+    }
+
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_token_ring (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"ring\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    if (esource_type_raw != cfg->sources->type) {
+        LOG(error, "\"ring\" is avalible for raw source only");
+        return rconfiguration_failed;
+    }
+
+    unsigned long _blocks;
+    unsigned long _kbytes;
+
+    if (2 > sscanf(value, "%lu:%lu", &_blocks, &_kbytes)) {
+        LOG(error, "wrong \"ring\" value specified, try to read --help");
+        return rconfiguration_failed;
+    }
+
+    if ((2 > _blocks) || (SOURCE_RING_MAXIMUM_BLOCKS < _blocks)) {
+        LOG(error, "wrong \"ring\" blocks, should be in [2, %u]", (unsigned int)SOURCE_RING_MAXIMUM_BLOCKS);
+        return rconfiguration_failed;
+    }
+
+    //block is page multiple
+    if ((4 > _kbytes) || (0 != (_kbytes % 4)) || ((64 * 1024) < _kbytes)) {
+        LOG(error, "wrong \"ring\" block size, should be multiple of 4 kbytes, upto 64 mbytes");
+        return rconfiguration_failed;
+    }
+
+    cfg->sources->ring_blocks     = _blocks;
+    cfg->sources->ring_block_size = (_kbytes * 1024);
+
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_token_xdp (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"xdp\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    if (esource_type_raw != cfg->sources->type) {
+        LOG(error, "\"xdp\" is avalible for raw source only");
+        return rconfiguration_failed;
+    }
+
+    unsigned long _frames = SOURCE_XDP_FRAMES;
+
+    if ((0 != strcasecmp("default", value)) && (1 != sscanf(value, "%lu", &_frames))) {
+        LOG(error, "wrong \"xdp\" value specified, try to read --help");
+        return rconfiguration_failed;
+    }
+
+    //rings are indexed by mask, sinks may hold frames upto their rings
+    if ((SOURCE_XDP_MINIMUM_FRAMES > _frames) || (SOURCE_XDP_MAXIMUM_FRAMES < _frames) || (0 != (_frames & (_frames - 1)))) {
+        LOG(error, "wrong \"xdp\" frames, should be power of 2 in [%u, %u]", (unsigned int)SOURCE_XDP_MINIMUM_FRAMES, (unsigned int)SOURCE_XDP_MAXIMUM_FRAMES);
+        return rconfiguration_failed;
+    }
+
+    cfg->sources->xdp_frames = _frames;
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_token_workers (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if ( NULL_IS(cfg->sources) || (NULL != cfg->sources->sinks)) {
+        LOG(error, "\"workers\" only avalible if source specified before");
+        return rconfiguration_failed;
+    }
+
+    unsigned long _count;
+    char          _steering[8] = "";
+
+    if (1 > sscanf(value, "%lu:%7s", &_count, _steering)) {
+        LOG(error, "wrong \"workers\" value specified, try to read --help");
+        return rconfiguration_failed;
+    }
+
+    if ((1 > _count) || (WORKERS_MAXIMUM < _count)) {
+        LOG(error, "wrong \"workers\" value, should be in [1, %u]", (unsigned int)WORKERS_MAXIMUM);
+        return rconfiguration_failed;
+    }
+
+    if ('\0' == _steering[0]) {
+        cfg->sources->steering = esocket_steering_flow;
+
+    } else if (0 == strcasecmp("cpu", _steering)) {
+        cfg->sources->steering = esocket_steering_cpu;
+
+    } else {
+        LOG(error, "wrong \"workers\" steering %s", _steering);
+        return rconfiguration_failed;
+    }
+
+    cfg->sources->workers = _count;
+
+    if (1 < _count)
+        cfg->sources->flg_socket |=   FSOCKET_REUSEPORT;
+    else
+        cfg->sources->flg_socket &= (~FSOCKET_REUSEPORT);
+
+    return rconfiguration_ok;
+}
+
 static rconfiguration
 _configuration_token_network (
     OUT sipv4_network*          network,
@@ -281,6 +519,32 @@ configuration_token_events (
     return rconfiguration_ok;
 }
 
+static rconfiguration
+configuration_token_threads (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if (0 == strcasecmp(value, "none")) {
+        cfg->threads = 0;
+        return rconfiguration_ok;
+    }
+
+    unsigned long _threads;
+
+    if (1 > sscanf(value, "%lu", &_threads)) {
+        LOG(error, "wrong \"threads\" count %s", value);
+        return rconfiguration_failed;
+    }
+
+    if (WORKERS_MAXIMUM < _threads) {
+        LOG(error, "wrong \"threads\" count, should be at most %u", (unsigned int)WORKERS_MAXIMUM);
+        return rconfiguration_failed;
+    }
+
+    cfg->threads = _threads;
+    return rconfiguration_ok;
+}
+
 static rconfiguration
 configuration_token_rtlink_hash (
         char*                   value,
@@ -417,9 +681,33 @@ configuration_token_source (
 
     _source->sinks      = NULL;
     _source->allow      = NULL;
+    _source->classifier = NULL;
     _source->ratelimit  = NULL;
+    _source->batch      = 1;
+    _source->workers    = 1;
+    _source->latency    = esource_latency_none;
+    _source->timing     = NULL;
+    _source->steering   = esocket_steering_flow;
+    _source->lane       = 0;
+    _source->lanes      = NULL;
+    _source->ratelimit_guard = NULL;
+    _source->rx         = NULL;
+    _source->tx         = NULL;
+    _source->ring_blocks     = 0;
+    _source->ring_block_size = 0;
+    _source->xdp_frames      = 0;
+    _source->xdp             = NULL;
+    _source->xdp_program     = NULL;
+    pollable_clear(&(_source->xdp_timer.pollable));
+    _source->flows      = NULL;
     _source->portrange  = NULL;
+    _source->ports      = NULL;
     _source->mgroups    = NULL;
+    _source->signature  = NULL;
+    _source->signature_length = 0;
+    _source->arena      = NULL;
+
+    memset(&(_source->ring), 0, sizeof(_source->ring));
 
     _source->binding.address = IPV4_ADDRESS(0, 0, 0, 0);
     _source->binding.mask    = IPV4_ADDRESS(0, 0, 0, 0);
@@ -636,7 +924,7 @@ configuration_token_no (
         }
 
     } else {
-        _flags = &(cfg->sources->sinks->flg_socket);
+        _flags = &(cfg->sources->sinks->cold->flg_socket);
 
         if (0 == strcasecmp("route", value)) {
             (*_flags) |= FSOCKET_DONTROUTE;
@@ -697,6 +985,43 @@ configuration_token_binding (
     return rconfiguration_ok;
 }
 
+//hot part is cache line aligned, cold one is separate [see KIM: sink]
+static ssink*
+_configuration_sink_allocate (
+        esink_type              type,
+    BTH sconfiguration*         cfg
+) {
+    ssink*      _sink = NULL;
+    ssink_cold* _cold = (ssink_cold*)calloc(1, sizeof(ssink_cold));
+
+    if (NULL_IS(_cold) || (0 != posix_memalign((void**)&_sink, CACHE_LINE_SIZE, sizeof(ssink)))) {
+        LOG(critical, "out of memory: sink [%lu]", (unsigned long)(sizeof(ssink) + sizeof(ssink_cold)));
+
+        free(_cold);
+        return NULL;
+    }
+
+    memset(_sink, 0, sizeof(ssink));
+
+    _sink->type         = (uint8_t)type;
+    _sink->cold         = _cold;
+    _cold->sink         = _sink;
+    _cold->flg_socket   = FSOCKET_DEFAULT_SINK_RAW;
+
+    _sink->socket       = SOCKET_INVALID;
+    _sink->port         = 0;    //use fallback
+
+    _cold->packet.socket     = SOCKET_INVALID;
+    _cold->packet.xsk.socket = SOCKET_INVALID;
+
+    _sink->last_ip_id   = 1;
+    _sink->ip_id_step   = 1;
+
+    _sink->next = cfg->sources->sinks;
+    cfg->sources->sinks = _sink;
+    return _sink;
+}
+
 static rconfiguration
 configuration_token_sink (
         char*                   value,
@@ -723,42 +1048,14 @@ configuration_token_sink (
 
     }
 
-    ssink* _sink = (ssink*)malloc(sizeof(ssink));
-    if NULL_IS(_sink) {
-        LOG(critical, "out of memory: sink [%lu]", (unsigned long)(sizeof(ssink)));
-        return rconfiguration_failed;
-    }
-
-    _sink->type         = esink_type_simple;
-    _sink->flg_socket   = FSOCKET_DEFAULT_SINK_RAW;
-
-    _sink->socket       = SOCKET_INVALID;
-
-    memcpy(&(_sink->ts.simple.target), &_network, sizeof(_network));
-
-    memset(_sink->ts.simple.device.configuration, 0, IFNAMSIZ);
-
-    memset(&(_sink->from), 0, sizeof(sipv4_destination));
-    _sink->port         = 0;    //use fallback
-
-    _sink->allow        = NULL;
-    _sink->portrange    = NULL;
-
-    _sink->last_ip_id   = 1;
-    _sink->rewrite      = _rewrite;
-    _sink->ttl          = 0;
-    _sink->tos          = 0;
-    _sink->fwmark       = 0;
-    _sink->mtu          = 0;
+    ssink* _sink = _configuration_sink_allocate(esink_type_simple, cfg);
 
-    _sink->security_level       = 0;
-    _sink->security_categories  = 0;
+    if NULL_IS(_sink)
+        return rconfiguration_failed;
 
-    _sink->allow        = NULL;
-    _sink->portrange    = NULL;
+    _sink->rewrite = _rewrite;
 
-    _sink->next = cfg->sources->sinks;
-    cfg->sources->sinks = _sink;
+    memcpy(&(_sink->cold->ts.simple.target), &_network, sizeof(_network));
     return rconfiguration_ok;
 }
 
@@ -772,38 +1069,12 @@ configuration_token_join (
         return rconfiguration_failed;
     }
 
-    ssink* _sink = (ssink*)malloc(sizeof(ssink));
+    ssink* _sink = _configuration_sink_allocate(esink_type_join, cfg);
 
-    if NULL_IS(_sink) {
-        LOG(critical, "out of memory: join [%lu]", (unsigned long)(sizeof(ssink)));
+    if NULL_IS(_sink)
         return rconfiguration_failed;
-    }
-
-    _sink->type         = esink_type_join;
-    _sink->flg_socket   = FSOCKET_DEFAULT_SINK_RAW;
 
-    _sink->socket       = SOCKET_INVALID;
-
-    strcpy_l(_sink->ts.join.configuration.device, value, IFNAMSIZ);   
-
-    memset(&(_sink->from), 0, sizeof(sipv4_destination));
-    _sink->port         = 0;    //use fallback
-
-    _sink->last_ip_id   = 1;
-    _sink->rewrite      = 0;
-    _sink->ttl          = 0;
-    _sink->tos          = 0;
-    _sink->fwmark       = 0;
-    _sink->mtu          = 0;
-
-    _sink->security_level       = 0;
-    _sink->security_categories  = 0;
-
-    _sink->allow        = NULL;
-    _sink->portrange    = NULL;
-
-    _sink->next = cfg->sources->sinks;
-    cfg->sources->sinks = _sink;
+    strcpy_l(_sink->cold->ts.join.configuration.device, value, IFNAMSIZ);
     return rconfiguration_ok;
 }
 
@@ -820,7 +1091,7 @@ configuration_token_allow (
     sipv4_allow** _p = NULL;
 
     if (NULL != cfg->sources->sinks) {
-        _p = &(cfg->sources->sinks->allow);
+        _p = &(cfg->sources->sinks->cold->allow);
     } else {
         _p = &(cfg->sources->allow);
     }
@@ -855,7 +1126,7 @@ _configuration_last_allow (
         return NULL;
 
     if (NULL != cfg->sources->sinks) {
-        return cfg->sources->sinks->allow;
+        return cfg->sources->sinks->cold->allow;
     }
 
     return cfg->sources->allow;
@@ -889,6 +1160,7 @@ configuration_token_to (
     memcpy(&(_to->address), &_network, sizeof(_network));
 
     _to->portrange = NULL;
+    _to->ports     = NULL;
 
     _to->next = _p->allow_to;
     _p->allow_to = _to;
@@ -908,11 +1180,11 @@ _configuration_last_portrange (
         return NULL;
 
     if (NULL != cfg->sources->sinks) {
-        if NULL_IS(cfg->sources->sinks->allow)
-            return &(cfg->sources->sinks->portrange);
+        if NULL_IS(cfg->sources->sinks->cold->allow)
+            return &(cfg->sources->sinks->cold->portrange);
 
-        if (NULL != cfg->sources->sinks->allow->allow_to)
-            return &(cfg->sources->sinks->allow->allow_to->portrange);
+        if (NULL != cfg->sources->sinks->cold->allow->allow_to)
+            return &(cfg->sources->sinks->cold->allow->allow_to->portrange);
 
         return NULL; //cuz allow defined, but not to
     }
@@ -1001,7 +1273,7 @@ configuration_token_device (
             return rconfiguration_failed;
         }
 
-        strcpy_l(cfg->sources->sinks->ts.simple.device.configuration, value, IFNAMSIZ);
+        strcpy_l(cfg->sources->sinks->cold->ts.simple.device.configuration, value, IFNAMSIZ);
         return rconfiguration_ok;
     }
 
@@ -1048,14 +1320,14 @@ configuration_token_from (
     }
 
     if (0 == strcasecmp("inherit", value)) {
-        memcpy(&(cfg->sources->sinks->from.address), &(cfg->sources->binding.address), sizeof(ipv4_t));
-        cfg->sources->sinks->from.port = cfg->sources->port;
+        memcpy(&(cfg->sources->sinks->cold->from.address), &(cfg->sources->binding.address), sizeof(ipv4_t));
+        cfg->sources->sinks->cold->from.port = cfg->sources->port;
 
         cfg->sources->sinks->rewrite |= FSINK_REWRITE_FROM;
         return rconfiguration_ok;
     }
 
-    if (rconfiguration_ok != _configuration_token_destination(&(cfg->sources->sinks->from), value)) {
+    if (rconfiguration_ok != _configuration_token_destination(&(cfg->sources->sinks->cold->from), value)) {
         LOG(error, "wrong \"from\" \"address\" value %s", value);
         return rconfiguration_failed;
     }
@@ -1079,7 +1351,7 @@ configuration_token_fwmark (
         return rconfiguration_failed;
     }
 
-    if (1 > sscanf(value, "%"SCNu32, &(cfg->sources->sinks->fwmark))) {
+    if (1 > sscanf(value, "%"SCNu32, &(cfg->sources->sinks->cold->fwmark))) {
         LOG(error, "wrong \"sink\" \"fwmark\" value %s", value);
         return rconfiguration_failed;
     }
@@ -1108,9 +1380,9 @@ configuration_token_security (
         return rconfiguration_ok;
     }
 
-    switch (sscanf(value, "%"SCNu8":%"SCNu64, &(cfg->sources->sinks->security_level), &(cfg->sources->sinks->security_categories))) {
+    switch (sscanf(value, "%"SCNu8":%"SCNu64, &(cfg->sources->sinks->cold->security_level), &(cfg->sources->sinks->cold->security_categories))) {
         case 1:
-            cfg->sources->sinks->security_categories = 0;
+            cfg->sources->sinks->cold->security_categories = 0;
             break;
 
         case 2:
@@ -1125,6 +1397,35 @@ configuration_token_security (
     return rconfiguration_ok;
 }
 
+static rconfiguration
+configuration_token_transport (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if (NULL_IS(cfg->sources) || NULL_IS(cfg->sources->sinks)) {
+        LOG(error, "\"transport\" only avalible if \"sink\" specified before");
+        return rconfiguration_failed;
+    }
+
+    cfg->sources->sinks->rewrite &= ~(FSINK_REWRITE_TRANSPORT_UDP | FSINK_REWRITE_TRANSPORT_PACKET);
+
+    if (0 == strcasecmp("raw", value))
+        return rconfiguration_ok;
+
+    if (0 == strcasecmp("udp", value)) {
+        cfg->sources->sinks->rewrite |= FSINK_REWRITE_TRANSPORT_UDP;
+        return rconfiguration_ok;
+    }
+
+    if (0 == strcasecmp("packet", value)) {
+        cfg->sources->sinks->rewrite |= FSINK_REWRITE_TRANSPORT_PACKET;
+        return rconfiguration_ok;
+    }
+
+    LOG(error, "wrong \"sink\" \"transport\" value %s", value);
+    return rconfiguration_failed;
+}
+
 static rconfiguration
 configuration_token_mtu (
         char*                   value,
@@ -1140,17 +1441,17 @@ configuration_token_mtu (
         return rconfiguration_failed;
     }
 
-    if (1 > sscanf(value, "%"SCNu32, &(cfg->sources->sinks->mtu))) {
+    if (1 > sscanf(value, "%"SCNu32, &(cfg->sources->sinks->cold->mtu))) {
         LOG(error, "wrong \"sink\" \"mtu\" value %s", value);
         return rconfiguration_failed;
     }
 
-    if (28 > cfg->sources->sinks->mtu) {
+    if (28 > cfg->sources->sinks->cold->mtu) {
         LOG(error, "mtu must be greater that 28 [udp header + ip header]");
         return rconfiguration_failed;
     }
 
-    if (576 > cfg->sources->sinks->mtu) {
+    if (576 > cfg->sources->sinks->cold->mtu) {
         LOG(warning, "mtu should be at least 576, as say RFC 791");
     }
 
@@ -1173,7 +1474,7 @@ configuration_token_tos (
         return rconfiguration_failed;
     }
 
-    if (1 > sscanf(value, "%"SCNu8, &(cfg->sources->sinks->tos))) {
+    if (1 > sscanf(value, "%"SCNu8, &(cfg->sources->sinks->cold->tos))) {
         static const struct _tos_class {
             const char*     name;
             uint8_t         value;
@@ -1203,7 +1504,7 @@ configuration_token_tos (
 
         for (const struct _tos_class* _c = _classes; NULL != _c->name; ++_c)
             if (0 == strcasecmp(_c->name, value)) {
-                cfg->sources->sinks->tos      = (_c->value << 2);
+                cfg->sources->sinks->cold->tos      = (_c->value << 2);
                 cfg->sources->sinks->rewrite |= FSINK_REWRITE_TOS;
                 return rconfiguration_ok;
             }
@@ -1232,12 +1533,12 @@ configuration_token_ttl (
     }
 
     if (0 == strcasecmp(value, "default")) {
-        cfg->sources->sinks->ttl      = 0;
+        cfg->sources->sinks->cold->ttl      = 0;
         cfg->sources->sinks->rewrite |= FSINK_REWRITE_TTL;
         return rconfiguration_ok;
     }
 
-    if ((1 > sscanf(value, "%"SCNu8, &(cfg->sources->sinks->ttl))) || (1 > cfg->sources->sinks->ttl)) {
+    if ((1 > sscanf(value, "%"SCNu8, &(cfg->sources->sinks->cold->ttl))) || (1 > cfg->sources->sinks->cold->ttl)) {
         LOG(error, "wrong \"sink\" \"ttl\" value %s", value);
         return rconfiguration_failed;
     }
@@ -1260,6 +1561,22 @@ configuration_token_log (
     return rconfiguration_ok;
 }
 
+static rconfiguration
+configuration_token_control (
+        char*                   value,
+    BTH sconfiguration*         cfg
+) {
+    if (NULL != cfg->control) {
+        LOG(error, "\"control\" already specified");
+        return rconfiguration_failed;
+    }
+
+    if NULL_IS(cfg->control = strdup(value))
+        return rconfiguration_out_of_memory;
+
+    return rconfiguration_ok;
+}
+
 static rconfiguration
 configuration_token_directory (
         char*                   value,
@@ -1614,6 +1931,32 @@ configuration_prepaire_unescape (
 }
 
 
+//"name value\n" lines, variables are already expanded, so equal signatures mean equal sources
+static rconfiguration
+_configuration_signature_append (
+    BTH ssource*                source,
+    IN  const char*             name,
+    IN  const char*             value
+) {
+    size_t _name   = strlen(name);
+    size_t _value  = strlen(value);
+    size_t _length = source->signature_length + _name + 1 + _value + 1;
+
+    char* _signature = (char*)realloc(source->signature, _length + 1);
+
+    if NULL_IS(_signature) {
+        LOG(critical, "out of memory: source signature [%lu]", (unsigned long)(_length + 1));
+        return rconfiguration_out_of_memory;
+    }
+
+    sprintf(_signature + source->signature_length, "%s %s\n", name, value);
+
+    source->signature        = _signature;
+    source->signature_length = _length;
+
+    return rconfiguration_ok;
+}
+
 static rconfiguration
 configuration_line (
     BTH char**                  token,
@@ -1628,37 +1971,48 @@ configuration_line (
             sconfiguration*     cfg
         );
 
+        int             source; //option of last source [or its sink], it's part of source's signature
+
     }  _tokens[] = {
-            { "be",             configuration_token_be              }
-        ,   { "statistics",     configuration_token_statistics      }
-        ,   { "rtlink-hash",    configuration_token_rtlink_hash     }
-        ,   { "reload",         configuration_token_reload          }
-        ,   { "restore",        configuration_token_restore         }
-        ,   { "buffer",         configuration_token_buffer          }
-        ,   { "events",         configuration_token_events          }
-        ,   { "source",         configuration_token_source          }
-        ,   { "rate-limit",     configuration_token_ratelimit       }
-        ,   { "m-group",        configuration_token_mgroup          }
-        ,   { "no",             configuration_token_no              }
-        ,   { "binding",        configuration_token_binding         }
-        ,   { "sink",           configuration_token_sink            }
-        ,   { "join",           configuration_token_join            }
-        ,   { "allow",          configuration_token_allow           }
-        ,   { "to",             configuration_token_to              }
-        ,   { "port-range",     configuration_token_portrange       }
-        ,   { "device",         configuration_token_device          }
-        ,   { "port",           configuration_token_port            }
-        ,   { "from",           configuration_token_from            }
-        ,   { "ttl",            configuration_token_ttl             }
-        ,   { "fwmark",         configuration_token_fwmark          }
-        ,   { "tos",            configuration_token_tos             }
-        ,   { "mtu",            configuration_token_mtu             }
-        ,   { "security",       configuration_token_security        }
-        ,   { "log",            configuration_token_log             }
-        ,   { "directory",      configuration_token_directory       }
-        ,   { "echo",           configuration_token_echo            }
-        ,   { "noop",           configuration_token_noop            }
-        ,   { NULL,             NULL                                }
+            { "be",              configuration_token_be,              0 }
+        ,   { "statistics",      configuration_token_statistics,      0 }
+        ,   { "rtlink-hash",     configuration_token_rtlink_hash,     0 }
+        ,   { "reload",          configuration_token_reload,          0 }
+        ,   { "restore",         configuration_token_restore,         0 }
+        ,   { "buffer",          configuration_token_buffer,          0 }
+        ,   { "events",          configuration_token_events,          0 }
+        ,   { "threads",         configuration_token_threads,         0 }
+        ,   { "source",          configuration_token_source,          1 }
+        ,   { "rate-limit",      configuration_token_ratelimit,       1 }
+        ,   { "batch",           configuration_token_batch,           1 }
+        ,   { "workers",         configuration_token_workers,         1 }
+        ,   { "latency",         configuration_token_latency,         1 }
+        ,   { "gro",             configuration_token_gro,             1 }
+        ,   { "ring",            configuration_token_ring,            1 }
+        ,   { "xdp",             configuration_token_xdp,             1 }
+        ,   { "m-group",         configuration_token_mgroup,          1 }
+        ,   { "no",              configuration_token_no,              1 }
+        ,   { "binding",         configuration_token_binding,         1 }
+        ,   { "sink",            configuration_token_sink,            1 }
+        ,   { "join",            configuration_token_join,            1 }
+        ,   { "allow",           configuration_token_allow,           1 }
+        ,   { "to",              configuration_token_to,              1 }
+        ,   { "port-range",      configuration_token_portrange,       1 }
+        ,   { "device",          configuration_token_device,          1 }
+        ,   { "port",            configuration_token_port,            1 }
+        ,   { "from",            configuration_token_from,            1 }
+        ,   { "ttl",             configuration_token_ttl,             1 }
+        ,   { "fwmark",          configuration_token_fwmark,          1 }
+        ,   { "tos",             configuration_token_tos,             1 }
+        ,   { "mtu",             configuration_token_mtu,             1 }
+        ,   { "security",        configuration_token_security,        1 }
+        ,   { "transport",       configuration_token_transport,       1 }
+        ,   { "log",             configuration_token_log,             0 }
+        ,   { "directory",       configuration_token_directory,       0 }
+        ,   { "control",         configuration_token_control,         0 }
+        ,   { "echo",            configuration_token_echo,            0 }
+        ,   { "noop",            configuration_token_noop,            0 }
+        ,   { NULL,              NULL,                                0 }
     };
 
     char* _value = _configuration_token_value(token[1], opts);
@@ -1677,8 +2031,14 @@ configuration_line (
         return configuration_token_let(_value, opts);
 
     for (const struct _token* _token = _tokens; (NULL != _token->name) && (NULL != _token->fnc); ++_token)
-        if (0 == strcasecmp(_token->name, token[0]))
-            return _token->fnc(_value, cfg);
+        if (0 == strcasecmp(_token->name, token[0])) {
+            rconfiguration _r = _token->fnc(_value, cfg);
+
+            if ((rconfiguration_ok != _r) || (0 == _token->source) || NULL_IS(cfg->sources))
+                return _r;
+
+            return _configuration_signature_append(cfg->sources, _token->name, _value);
+        }
 
     LOG(error, "unknown configuration token %s", token[0]);
     return rconfiguration_failed;
@@ -1870,17 +2230,299 @@ configuration_file (
         return rconfiguration_failed;
 }
 
+//port-ranges are compiled into bitmaps, lists are kept for parser [and socket filter]
 static rconfiguration
-configuration_check (
-    BTH sconfiguration*         cfg
+_configuration_check_ports (
+    IN  const sipv4_portrange*  portrange,
+    BTH sipv4_allow*            allow,
+    OUT sipv4_ports**           ports
 ) {
-    if (1 > cfg->buffer_size) {
-        LOG(error, "buffer value too small!");
+    if (ripv4_ok != ipv4_ports_compile(portrange, ports))
         return rconfiguration_failed;
-    }
 
-    if NULL_IS(cfg->sources) {
-        LOG(error, "configuration file doesn't containe any sources");
+    for (sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next)
+        for (sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next)
+            if (ripv4_ok != ipv4_ports_compile(_to->portrange, &(_to->ports)))
+                return rconfiguration_failed;
+
+    return rconfiguration_ok;
+}
+
+//long allow lists are compiled, failure isn't fatal - list is walked as before
+static void
+_configuration_check_classifier (
+    IN  const sipv4_allow*      allow,
+    OUT sipv4_classifier**      classifier
+) {
+    size_t _count = 0;
+
+    for (const sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next)
+        ++_count;
+
+    if (ALLOW_CLASSIFIER_MINIMUM > _count)
+        return;
+
+    if NULL_IS((*classifier) = ipv4_classifier_create(allow)) {
+        LOG(verbose, "allow list [%lu rules] can't be compiled, walking it", (unsigned long)_count);
+        return;
+    }
+
+    LOG(verbose, "allow list [%lu rules] compiled into %lu nodes", (unsigned long)_count, (unsigned long)(*classifier)->from.count);
+}
+
+static void
+_configuration_cleanup_portrange (
+    BTH sipv4_portrange*        range,
+        int                     owned
+) {
+    if (!owned)
+        return;
+
+    for (sipv4_portrange* _range = range; NULL != _range; ) {
+        sipv4_portrange* _c_range = _range;
+        _range = _range->next;
+        free(_c_range);
+    }
+}
+
+static void
+configuration_cleanup_allow (
+    BTH sipv4_allow*            allow,
+        int                     owned
+) {
+    for (sipv4_allow* _allow = allow; NULL != _allow; ) {
+        for (sipv4_allow_to* _to = _allow->allow_to; NULL != _to; ) {
+            sipv4_allow_to* _c_to = _to;
+            _to = _to->next;
+
+            _configuration_cleanup_portrange(_c_to->portrange, owned);
+            ipv4_ports_destroy(_c_to->ports);
+
+            if (owned)
+                free(_c_to);
+        }
+
+        sipv4_allow* _c_allow = _allow;
+        _allow = _allow->next;
+
+        if (owned)
+            free(_c_allow);
+    }
+}
+
+//nodes hanging off the source, the source itself stays
+static void
+_configuration_cleanup_nodes (
+    BTH ssource*                source
+) {
+    int _owned = NULL_IS(source->arena);
+
+    for (ssink* _sink = source->sinks; NULL != _sink; ) {
+        configuration_cleanup_allow(_sink->cold->allow, _owned);
+        ipv4_classifier_destroy(_sink->cold->classifier);
+
+        ssink* _c_sink = _sink;
+        _sink = _sink->next;
+
+        _configuration_cleanup_portrange(_c_sink->cold->portrange, _owned);
+        ipv4_ports_destroy(_c_sink->ports);
+
+        if (_owned) {
+            free(_c_sink->cold);
+            free(_c_sink);
+        }
+    }
+
+    if (_owned) {
+        for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; ) {
+            smgroup* _c_mgroup = _mgroup;
+            _mgroup = _mgroup->next;
+
+            free(_c_mgroup);
+        }
+
+        if (NULL != source->ratelimit)
+            free(source->ratelimit);
+    }
+
+    configuration_cleanup_allow(source->allow, _owned);
+    ipv4_classifier_destroy(source->classifier);
+
+    _configuration_cleanup_portrange(source->portrange, _owned);
+    ipv4_ports_destroy(source->ports);
+
+    free(source->arena);
+    source->arena = NULL;
+}
+
+/** KIM: arena
+        parser allocates every node on its own, so relay would chase pointers
+        over the heap. compile moves source's nodes into one block: hot ones
+        first [sinks as contiguous array, rate-limit, allow rules in walk
+        order], cold ones after [sinks' cold parts with their allow rules,
+        m-groups, port-ranges - they're compiled into bitmaps]. lists are kept linked, so walkers
+        don't change.
+
+        layout is done twice by the same code: first pass only measures
+        [arena's base is NULL], second one copies nodes and relinks copies
+**/
+typedef
+struct __configuration_arena {
+    ubyte_t*                    base;
+    size_t                      offset;
+} _sconfiguration_arena;
+
+static void*
+_configuration_arena_place (
+    BTH _sconfiguration_arena*  arena,
+    IN  const void*             node,
+        size_t                  size,
+        size_t                  align
+) {
+    arena->offset = (arena->offset + (align - 1)) & ~(align - 1);
+
+    void* _place = NULL;
+
+    if NOT_NULL_IS(arena->base) {
+        _place = arena->base + arena->offset;
+        memcpy(_place, node, size);
+    }
+
+    arena->offset += size;
+    return _place;
+}
+
+//list at head is placed, head is switched to copies at second pass
+#define __ARENA_LIST(_type, _arena, _head, _align)                                                  \
+    do {                                                                                            \
+        _type*  __copies = NULL;                                                                    \
+        _type** __tail   = &__copies;                                                               \
+                                                                                                    \
+        for (_type* __node = (*(_head)); NULL != __node; __node = __node->next) {                  \
+            _type* __copy = (_type*)_configuration_arena_place(_arena, __node, sizeof(_type), (__node == (*(_head)))?(_align):__alignof__(_type)); \
+                                                                                                    \
+            if NULL_IS(__copy)                                                                      \
+                continue;                                                                           \
+                                                                                                    \
+            __copy->next = NULL;                                                                    \
+            (*__tail)    = __copy;                                                                  \
+            __tail       = &(__copy->next);                                                         \
+        }                                                                                           \
+                                                                                                    \
+        if NOT_NULL_IS((_arena)->base)                                                              \
+            (*(_head)) = __copies;                                                                  \
+    } while (0)
+
+static void
+_configuration_arena_allow (
+    BTH _sconfiguration_arena*  arena,
+    BTH sipv4_allow**           allow
+) {
+    __ARENA_LIST(sipv4_allow, arena, allow, __alignof__(sipv4_allow));
+
+    for (sipv4_allow* _allow = (*allow); NULL != _allow; _allow = _allow->next)
+        __ARENA_LIST(sipv4_allow_to, arena, &(_allow->allow_to), __alignof__(sipv4_allow_to));
+}
+
+static void
+_configuration_arena_allow_portranges (
+    BTH _sconfiguration_arena*  arena,
+    BTH sipv4_allow*            allow
+) {
+    for (sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next)
+        for (sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next)
+            __ARENA_LIST(sipv4_portrange, arena, &(_to->portrange), __alignof__(sipv4_portrange));
+}
+
+static void
+_configuration_arena_layout (
+    BTH _sconfiguration_arena*  arena,
+    BTH ssource*                source
+) {
+    //hot: walked or touched per packet
+    __ARENA_LIST(ssink, arena, &(source->sinks), CACHE_LINE_SIZE);
+
+    if NOT_NULL_IS(source->ratelimit) {
+        sratelimit* _ratelimit = (sratelimit*)_configuration_arena_place(arena, source->ratelimit, sizeof(sratelimit), CACHE_LINE_SIZE);
+
+        if NOT_NULL_IS(arena->base)
+            source->ratelimit = _ratelimit;
+    }
+
+    _configuration_arena_allow(arena, &(source->allow));
+
+    //cold, sink's allow is walked only if it's filtered
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        ssink_cold* _cold = (ssink_cold*)_configuration_arena_place(arena, _sink->cold, sizeof(ssink_cold), __alignof__(ssink_cold));
+
+        if NOT_NULL_IS(_cold) {
+            _cold->sink = _sink;
+            _sink->cold = _cold;
+        }
+
+        _configuration_arena_allow(arena, &(_sink->cold->allow));
+    }
+
+    __ARENA_LIST(smgroup,         arena, &(source->mgroups),   CACHE_LINE_SIZE);
+    __ARENA_LIST(sipv4_portrange, arena, &(source->portrange), __alignof__(sipv4_portrange));
+
+    _configuration_arena_allow_portranges(arena, source->allow);
+
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        __ARENA_LIST(sipv4_portrange, arena, &(_sink->cold->portrange), __alignof__(sipv4_portrange));
+        _configuration_arena_allow_portranges(arena, _sink->cold->allow);
+    }
+}
+
+#undef __ARENA_LIST
+
+static rconfiguration
+_configuration_compile (
+    BTH ssource*                source
+) {
+    if NOT_NULL_IS(source->arena)
+        return rconfiguration_ok;
+
+    _sconfiguration_arena _arena = { NULL, 0 };
+
+    _configuration_arena_layout(&_arena, source);
+
+    size_t _size = (_arena.offset + (CACHE_LINE_SIZE - 1)) & ~((size_t)CACHE_LINE_SIZE - 1);
+    void*  _base = NULL;
+
+    if (0 != posix_memalign(&_base, CACHE_LINE_SIZE, _size)) {
+        LOG(critical, "out of memory: source arena [%lu]", (unsigned long)_size);
+        return rconfiguration_out_of_memory;
+    }
+
+    //original nodes are still linked from it
+    ssource _parsed = (*source);
+
+    _arena.base   = (ubyte_t*)_base;
+    _arena.offset = 0;
+
+    _configuration_arena_layout(&_arena, source);
+
+    source->arena = _base;
+
+    _parsed.arena = NULL;
+    _configuration_cleanup_nodes(&_parsed);
+
+    LOG(debug, "source %p compiled into %lu bytes arena", source, (unsigned long)_size);
+    return rconfiguration_ok;
+}
+
+static rconfiguration
+configuration_check (
+    BTH sconfiguration*         cfg
+) {
+    if (1 > cfg->buffer_size) {
+        LOG(error, "buffer value too small!");
+        return rconfiguration_failed;
+    }
+
+    if NULL_IS(cfg->sources) {
+        LOG(error, "configuration file doesn't containe any sources");
         return rconfiguration_failed;
     }
 
@@ -1915,7 +2557,113 @@ configuration_check (
                 return rconfiguration_failed;
             }
 
-        ++_sources;
+        //classifier refers allow rules, so they're moved before it's built
+        if (rconfiguration_ok != _configuration_compile(_source))
+            return rconfiguration_failed;
+
+        if (rconfiguration_ok != _configuration_check_ports(_source->portrange, _source->allow, &(_source->ports)))
+            return rconfiguration_failed;
+
+        _configuration_check_classifier(_source->allow, &(_source->classifier));
+
+        for (ssink* _sink = _source->sinks; NULL != _sink; _sink = _sink->next) {
+            if (rconfiguration_ok != _configuration_check_ports(_sink->cold->portrange, _sink->cold->allow, &(_sink->ports)))
+                return rconfiguration_failed;
+
+            _configuration_check_classifier(_sink->cold->allow, &(_sink->cold->classifier));
+
+            _sink->filtered = (uint8_t)NOT_NULL_IS(_sink->cold->allow);
+
+            //frames are queued to device directly
+            if (0 != (FSINK_REWRITE_TRANSPORT_PACKET & _sink->rewrite)) {
+                if ((esink_type_simple == _sink->type) && ('\0' == _sink->cold->ts.simple.device.configuration[0])) {
+                    LOG(error, "sink with packet transport requires \"device\"");
+                    return rconfiguration_failed;
+                }
+
+                if (0 != (FSINK_REWRITE_FWMARK & _sink->rewrite))
+                    LOG(warning, "sink with packet transport, \"fwmark\" applies to routed datagrams only");
+
+                if (0 == (FSOCKET_BROADCAST & _sink->cold->flg_socket))
+                    LOG(warning, "sink with packet transport and \"no broadcast\", only multicast is framed");
+            }
+
+            if (0 == (FSINK_REWRITE_TRANSPORT_UDP & _sink->rewrite))
+                continue;
+
+            //udp socket is bound once, so received source port can't be kept
+            if ((0 == (FSINK_REWRITE_FROM & _sink->rewrite)) || (0 == _sink->cold->from.port)) {
+                LOG(error, "sink with udp transport requires \"from\" with port");
+                return rconfiguration_failed;
+            }
+
+            if (0 != (FSINK_REWRITE_SECURITY & _sink->rewrite)) {
+                LOG(error, "sink with udp transport can't set ip security");
+                return rconfiguration_failed;
+            }
+
+            //socket bound with reuse to source's own binding would take unicast datagrams of source and discard them
+            if ((esource_type_simple == _source->type) && (_source->port == _sink->cold->from.port))
+                if ((INADDR_ANY == _source->binding.address) || (INADDR_ANY == _sink->cold->from.address) || (_source->binding.address == _sink->cold->from.address)) {
+                    LOG(error, "sink with udp transport can't use source's binding as \"from\", use other port");
+                    return rconfiguration_failed;
+                }
+        }
+
+        //packet socket can't join groups by ip membership
+        if ((0 < _source->ring_blocks) && NOT_NULL_IS(_source->mgroups)) {
+            LOG(error, "source with ring can't join m-group, use raw socket");
+            return rconfiguration_failed;
+        }
+
+        if ((0 < _source->ring_blocks) && (1 < _source->batch))
+            LOG(warning, "source with ring, \"batch\" is ignored, whole ring block is processed at once");
+
+        //lanes of xdp source are device's queues, "xdp" may follow "workers"
+        if ((esource_type_raw == _source->type) && (1 < _source->workers) && (0 == _source->xdp_frames)) {
+            LOG(error, "\"workers\" have no sence for raw source without xdp, each raw socket receives all datagrams");
+            return rconfiguration_failed;
+        }
+
+        if (0 < _source->xdp_frames) {
+            if ((0 < _source->ring_blocks) || NOT_NULL_IS(_source->mgroups)) {
+                LOG(error, "source with xdp can't have \"ring\" or join m-group");
+                return rconfiguration_failed;
+            }
+
+            //program is attached to device, lanes are its queues
+            if ('\0' == _source->ss.configuration.device[0]) {
+                LOG(error, "source with xdp requires \"device\"");
+                return rconfiguration_failed;
+            }
+
+            //datagrams of queue without lane would go to kernel, device which doesn't exist yet is checked on start
+            size_t _queues = 0;
+
+            if ((rxdp_ok == xdp_device_queues(_source->ss.configuration.device, &_queues)) && (_queues != _source->workers)) {
+                LOG(error, "device [%s] has %lu rx queues, source with xdp needs \"workers %lu\"", _source->ss.configuration.device, (unsigned long)_queues, (unsigned long)_queues);
+                return rconfiguration_failed;
+            }
+
+            if (1 < _source->batch)
+                LOG(warning, "source with xdp, \"batch\" is ignored, rx ring is processed at once");
+
+            //device has one program and queue has one socket
+            for (ssource* _other = _source->next; NULL != _other; _other = _other->next)
+                if ((0 < _other->xdp_frames) && (0 == strcmp(_source->ss.configuration.device, _other->ss.configuration.device))) {
+                    LOG(error, "only one source with xdp per device [%s]", _source->ss.configuration.device);
+                    return rconfiguration_failed;
+                }
+        }
+
+        //coalesced datagrams are up to 64k, truncated ones are dropped
+        if ((0 != (FSOCKET_GRO & _source->flg_socket)) && (UINT16_MAX > cfg->buffer_size))
+            LOG(warning, "source with gro, but buffer is less than 64k, coalesced datagrams may be dropped");
+
+        if ((1 < _source->workers) && (0 == cfg->threads))
+            LOG(warning, "source with workers but without threads, all lanes share main thread");
+
+        _sources += _source->workers;
     }
 
     if (0 == cfg->events) {//if events automatic - calculate it from sources count
@@ -1927,13 +2675,21 @@ configuration_check (
 
         if (0 < cfg->restore)
             cfg->events += 1;
+
+        if (0 < cfg->statistics)
+            cfg->events += 1;
+
+        if (NULL != cfg->control)
+            cfg->events += 1 + CONTROL_CLIENTS_MAXIMUM;
     }
 
     LOG(verbose, "sources count            %10u", (unsigned int)_sources);
     LOG(verbose, "events count             %10u events", (unsigned int)cfg->events);
     LOG(verbose, "buffer size              %10u bytes", (unsigned int)cfg->buffer_size);
+    LOG(verbose, "worker threads           %10u", (unsigned int)cfg->threads);
     LOG(verbose, "rtlink reload inverval   %10u seconds", (unsigned int)cfg->reload);
     LOG(verbose, "sources restore inverval %10u seconds", (unsigned int)cfg->restore);
+    LOG(verbose, "statistics inverval      %10u seconds", (unsigned int)cfg->statistics);
 
     return rconfiguration_ok;
 }
@@ -2059,102 +2815,201 @@ configuration (
         goto _failure;
     }
 
-    rconfiguration _r = configuration_file(_cfg_file, cfg, &_cfg_opts);
+    //reload reads it again, when directory may be changed already
+    cfg->file    = realpath(_cfg_file, NULL);
+    cfg->defines = _cfg_opts;
 
-    while (NULL != _cfg_opts) {
-        sconfiguration_opts* _c = _cfg_opts;
-        _cfg_opts = _cfg_opts->next;
+    if NULL_IS(cfg->file) {
+        LOG(error, "can't resolve configuration file path [%s]", _cfg_file);
 
-        free(_c->name);
-        free(_c);
+        free(_cfg_file);
+        return rconfiguration_failed;
     }
 
     free(_cfg_file);
 
-    if (rconfiguration_ok != _r)
+    //"be" tokens apply over it, reload starts from it again
+    cfg->suppression = glog_suppression;
+
+    if (rconfiguration_ok != configuration_file(cfg->file, cfg, &(cfg->defines)))
         return rconfiguration_failed;
 
     return configuration_check(cfg);
 
     _failure:
-        while (NULL != _cfg_opts) {
-            sconfiguration_opts* _c = _cfg_opts;
-            _cfg_opts = _cfg_opts->next;
+        free(_cfg_file);
+
+        _configuration_opts_free(_cfg_opts);
+        return rconfiguration_failed;
+}
+
+//--define values, name & value are one allocation
+static sconfiguration_opts*
+_configuration_opts_copy (
+    IN  const sconfiguration_opts*  opts
+) {
+    sconfiguration_opts*  _copy = NULL;
+    sconfiguration_opts** _tail = &_copy;
+
+    for (const sconfiguration_opts* _opt = opts; NULL != _opt; _opt = _opt->next) {
+        sconfiguration_opts* _c   = (sconfiguration_opts*)malloc(sizeof(sconfiguration_opts));
+        char*                _buf = (char*)malloc(_opt->name_length + 1 + _opt->value_length + 1);
+
+        if (NULL_IS(_c) || NULL_IS(_buf)) {
+            LOG(critical, "out of memory: defines copy");
 
-            free(_c->name);
             free(_c);
+            free(_buf);
+
+            _configuration_opts_free(_copy);
+            return NULL;
         }
 
-        return rconfiguration_failed;
+        memcpy(_buf,                          _opt->name,  _opt->name_length  + 1);
+        memcpy(_buf + _opt->name_length + 1,  _opt->value, _opt->value_length + 1);
+
+        _c->name         = _buf;
+        _c->name_length  = _opt->name_length;
+        _c->value        = _buf + _opt->name_length + 1;
+        _c->value_length = _opt->value_length;
+        _c->next         = NULL;
+
+        (*_tail) = _c;
+        _tail    = &(_c->next);
+    }
+
+    return _copy;
 }
 
-static void
-_configuration_cleanup_portrange (
-    BTH sipv4_portrange*        range
+static int
+_configuration_string_differs (
+    IN  const char*             a,
+    IN  const char*             b
 ) {
-    for (sipv4_portrange* _range = range; NULL != _range; ) {
-        sipv4_portrange* _c_range = _range;
-        _range = _range->next;
-        free(_c_range);
+    if (NULL_IS(a) || NULL_IS(b))
+        return (a != b);
+
+    return (0 != strcmp(a, b));
+}
+
+static rconfiguration
+_configuration_string_keep (
+    BTH char**                  next,
+    IN  const char*             current,
+    IN  const char*             name
+) {
+    if (_configuration_string_differs(*next, current))
+        LOG(warning, "\"%s\" can't be changed by reload, restart required", name);
+
+    free(*next);
+    (*next) = NULL;
+
+    if NULL_IS(current)
+        return rconfiguration_ok;
+
+    if NULL_IS((*next) = strdup(current)) {
+        LOG(critical, "out of memory: %s", name);
+        return rconfiguration_out_of_memory;
     }
+
+    return rconfiguration_ok;
 }
 
-static void
-configuration_cleanup_allow (
-    BTH sipv4_allow*            allow
+rconfiguration
+configuration_reload (
+    BTH sconfiguration*         current,
+    OUT sconfiguration*         next
 ) {
-    for (sipv4_allow* _allow = allow; NULL != _allow; ) {
-        for (sipv4_allow_to* _to = _allow->allow_to; NULL != _to; ) {
-            sipv4_allow_to* _c_to = _to;
-            _to = _to->next;
+    configuration_initialize(next);
 
-            _configuration_cleanup_portrange(_c_to->portrange);
-            free(_c_to);
-        }
+    LOG(verbose, "reloading configuration [%s]", current->file);
 
-        sipv4_allow* _c_allow = _allow;
-        _allow = _allow->next;
-        free(_c_allow);
+    /** KIM: "be" tokens change log mask while file is parsed, so parsing starts
+        from command line mask [removed "be verbose" turns verbose off], running
+        mask is restored if new configuration isn't taken
+    **/
+    uint32_t _suppression = log_suppression(current->suppression);
+    next->suppression     = current->suppression;
+
+    if NULL_IS(next->file = strdup(current->file)) {
+        LOG(critical, "out of memory: configuration file");
+
+        log_suppression(_suppression);
+        return rconfiguration_failed;
     }
+
+    if ((NULL != current->defines) && NULL_IS(next->defines = _configuration_opts_copy(current->defines)))
+        goto _failure;
+
+    if (rconfiguration_ok != configuration_file(next->file, next, &(next->defines)))
+        goto _failure;
+
+    //directory is changed once at startup
+    free(next->directory);
+    next->directory = NULL;
+
+    if (rconfiguration_ok != _configuration_string_keep(&(next->log),     current->log,     "log"))
+        goto _failure;
+
+    if (rconfiguration_ok != _configuration_string_keep(&(next->control), current->control, "control"))
+        goto _failure;
+
+    #define __KEEP(_field, _name)                                                               \
+        do {                                                                                    \
+            if (next->_field != current->_field)                                                \
+                LOG(warning, "\"%s\" can't be changed by reload, restart required", _name);    \
+                                                                                                \
+            next->_field = current->_field;                                                     \
+        } while (0)
+
+    __KEEP(threads,     "threads");
+    __KEEP(buffer_size, "buffer");
+    __KEEP(rtlink_hash, "rtlink-hash");
+
+    #undef __KEEP
+
+    //poll buffers are allocated already
+    next->events = current->events;
+
+    if (rconfiguration_ok != configuration_check(next))
+        goto _failure;
+
+    return rconfiguration_ok;
+
+    _failure:
+        configuration_cleanup(next);
+
+        log_suppression(_suppression);
+        return rconfiguration_failed;
 }
 
 void
 configuration_cleanup (
     BTH sconfiguration*         cfg
 ) {
+    free(cfg->file);
+    cfg->file = NULL;
+
+    _configuration_opts_free(cfg->defines);
+    cfg->defines = NULL;
+
     if (NULL != cfg->log)
         free(cfg->log);
 
     if (NULL != cfg->directory)
         free(cfg->directory);
 
-    for (ssource* _source = cfg->sources; NULL != _source; ) {
-        for (ssink* _sink = _source->sinks; NULL != _sink; ) {
-            configuration_cleanup_allow(_sink->allow);
-
-            ssink* _c_sink = _sink;
-            _sink = _sink->next;
-
-            _configuration_cleanup_portrange(_c_sink->portrange);
-            free(_c_sink);
-        }
-
-        for (smgroup* _mgroup = _source->mgroups; NULL != _mgroup; ) {
-            smgroup* _c_mgroup = _mgroup;
-            _mgroup = _mgroup->next;
-
-            free(_c_mgroup);
-        }
-
-        configuration_cleanup_allow(_source->allow);
+    if (NULL != cfg->control)
+        free(cfg->control);
 
+    for (ssource* _source = cfg->sources; NULL != _source; ) {
         ssource* _c_source = _source;
         _source = _source->next;
 
-        if (NULL != _c_source->ratelimit)
-            free(_c_source->ratelimit);
-
-        _configuration_cleanup_portrange(_c_source->portrange);
+        _configuration_cleanup_nodes(_c_source);
+        free(_c_source->signature);
         free(_c_source);
     }
+
+    cfg->sources = NULL;
 }
@@ -9,16 +9,27 @@
 #include "bproxy.h"
 #include "source.h"
 
+struct _configuration_opts;
+
 typedef
 struct _configuration {
+    char*               file;       //absolute, reload reads it again
+    struct _configuration_opts*
+                        defines;    //--define values, kept for reload
+
     char*               log;
     char*               directory;
 
+    uint32_t            suppression;    //log mask by command line, "be" of file applies over it
+    char*               control;    //control socket path, NULL - disabled
+
     size_t              events;
     size_t              buffer_size;
 
     size_t              rtlink_hash;
 
+    size_t              threads;    //0 - single threaded
+
     unsigned long       reload;
     unsigned long       restore;
     unsigned long       statistics;
@@ -30,8 +41,14 @@ static inline void
 configuration_initialize (
     OUT sconfiguration*     cfg
 ) {
+    cfg->file           = NULL;
+    cfg->defines        = NULL;
+
     cfg->log            = NULL;
     cfg->directory      = NULL;
+    cfg->control        = NULL;
+
+    cfg->suppression    = 0; //taken from command line or running configuration
 
     cfg->events         = 0; //calculate automatically
     cfg->buffer_size    = DEFAULT_BUFFER_SIZE;
@@ -40,6 +57,8 @@ configuration_initialize (
 
     cfg->rtlink_hash    = 5;
 
+    cfg->threads        = 0;
+
     cfg->reload         = 120;
     cfg->restore        =   5;
 
@@ -60,6 +79,13 @@ configuration (
     OUT sconfiguration*         cfg
 );
 
+//parses configuration file of current again, options which need restart are taken from current
+rconfiguration
+configuration_reload (
+    BTH sconfiguration*         current,
+    OUT sconfiguration*         next
+);
+
 void
 configuration_cleanup (
     BTH sconfiguration*         cfg
@@ -0,0 +1,291 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#define _GNU_SOURCE     //accept4
+
+#include "control.h"
+#include "log.h"
+#include "errno.h"
+#include "socket-pool.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+
+LOG_MODULE("control");
+
+static void
+_control_client_free (
+    BTH scontrol_client*        client
+) {
+    scontrol* _control = client->control;
+
+    for (scontrol_client** _c = &(_control->clients); NULL != (*_c); _c = &((*_c)->next))
+        if (client == (*_c)) {
+            (*_c) = client->next;
+            break;
+        }
+
+    _control->count--;
+
+    if (rpoll_ok != poll_detach(&(client->pollable)))
+        LOG(error, "can't detach control client %p", client);
+
+    socket_close(pollable_socket(&(client->pollable)));
+    pollable_clear(&(client->pollable));
+
+    metrics_cleanup(&(client->snapshot));
+    free(client);
+}
+
+//writes as much as socket accepts: ok - wait for socket, failed - done or client is broken
+static rcontrol
+_control_client_write (
+    BTH scontrol_client*        client
+) {
+    while (client->sent < client->snapshot.length) {
+        ssize_t _r_send = send(pollable_socket(&(client->pollable))
+            ,   client->snapshot.buffer + client->sent
+            ,   client->snapshot.length - client->sent
+            ,   MSG_DONTWAIT | MSG_NOSIGNAL
+        );
+
+        if (0 > _r_send) {
+            if EINTR_IS      (errno) continue;
+            if EAGAIN_IS     (errno) return rcontrol_ok;
+            if EWOULDBLOCK_IS(errno) return rcontrol_ok;
+
+            LOG(verbose, "control client %p send failed, "PRIerrno, client, DPRIerrno);
+            return rcontrol_failed;
+        }
+
+        client->sent += (size_t)_r_send;
+    }
+
+    return rcontrol_failed; //done
+}
+
+static rpoll_handler
+_control_client_handler (
+        spollable*              pollable,
+        uint32_t                flags,
+        spoll_passthrou*        passthrou
+) {
+    (void)passthrou;
+
+    scontrol_client* _client = CONTAINEROF(pollable, scontrol_client, pollable);
+
+    if (0 != (flags & (FPOLLABLE_ERR | FPOLLABLE_HUP))) {
+        LOG(verbose, "control client %p gone", _client);
+
+        _control_client_free(_client);
+        return rpoll_handler_ok;
+    }
+
+    if (rcontrol_ok != _control_client_write(_client)) {
+        LOG(debug, "control client %p served [%lu bytes]", _client, (unsigned long)_client->sent);
+        _control_client_free(_client);
+    }
+
+    return rpoll_handler_ok;
+}
+
+static void
+_control_snapshot (
+    IN  scontrol*               control,
+    BTH smetrics*               metrics
+) {
+    metrics_family(metrics, "bproxy_info", "gauge", "Broadcast proxy version");
+    metrics_printf(metrics, "bproxy_info{version=\"%s\"} 1\n", VERSION);
+
+    sources_metrics(control->sources, metrics);
+    socket_pool_metrics(metrics);
+    rtlink_metrics (control->rtlink,  metrics);
+}
+
+//drops clients which didn't read their snapshot in time
+// client is shut down only, it's freed by own handler [its event may be pending in current dispatch]
+static void
+_control_expire (
+    BTH scontrol*               control,
+        time_t                  now
+) {
+    for (scontrol_client* _client = control->clients; NULL != _client; _client = _client->next) {
+        if ((now - _client->accepted) < CONTROL_CLIENT_TIMEOUT)
+            continue;
+
+        LOG(verbose, "control client %p is too slow, dropped [%lu of %lu bytes sent]", _client, (unsigned long)_client->sent, (unsigned long)_client->snapshot.length);
+        shutdown(pollable_socket(&(_client->pollable)), SHUT_RDWR);
+    }
+}
+
+static void
+_control_accept (
+    BTH scontrol*               control,
+        socket_t                socket,
+        time_t                  now
+) {
+    if (CONTROL_CLIENTS_MAXIMUM <= control->count) {
+        LOG(warning, "control clients limit exceeded, connection dropped");
+        goto _failed;
+    }
+
+    scontrol_client* _client = (scontrol_client*)malloc(sizeof(scontrol_client));
+
+    if NULL_IS(_client) {
+        LOG(critical, "out of memory: control client [%lu]", (unsigned long)sizeof(scontrol_client));
+        goto _failed;
+    }
+
+    _client->control  = control;
+    _client->sent     = 0;
+    _client->accepted = now;
+
+    metrics_initialize(&(_client->snapshot));
+    _control_snapshot(control, &(_client->snapshot));
+
+    if (rmetrics_ok != metrics_state(&(_client->snapshot)))
+        goto _done;
+
+    pollable_initialize(&(_client->pollable), pollable_poll(&(control->pollable)), _control_client_handler, socket, FPOLLABLE_OUT);
+
+    //most of snapshots fit into socket buffer, so client is done without poll
+    if (rcontrol_ok != _control_client_write(_client)) {
+        LOG(debug, "control client %p served [%lu bytes]", _client, (unsigned long)_client->sent);
+        goto _done;
+    }
+
+    if (rpoll_ok != poll_attach(&(_client->pollable)))
+        goto _done;
+
+    _client->next    = control->clients;
+    control->clients = _client;
+    control->count++;
+
+    LOG(verbose, "control client %p waits for %lu bytes", _client, (unsigned long)(_client->snapshot.length - _client->sent));
+    return;
+
+    _done:
+        metrics_cleanup(&(_client->snapshot));
+        free(_client);
+
+    _failed:
+        socket_close(socket);
+}
+
+static rpoll_handler
+_control_handler (
+        spollable*              pollable,
+        uint32_t                flags,
+        spoll_passthrou*        passthrou
+) {
+    scontrol* _control = CONTAINEROF(pollable, scontrol, pollable);
+
+    if (0 != (flags & (FPOLLABLE_ERR | FPOLLABLE_HUP))) {
+        LOG(error, "control socket failed");
+        return rpoll_handler_failed;
+    }
+
+    _control_expire(_control, passthrou->time.tv_sec);
+
+    FOREVER {
+        socket_t _socket = accept4(pollable_socket(pollable), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if SOCKET_INVALID_IS(_socket) {
+            if EINTR_IS      (errno) continue;
+            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
+
+            //client may reset connection before it's accepted, it isn't our failure
+            LOG(verbose, "accept failed, "PRIerrno, DPRIerrno);
+            return rpoll_handler_ok;
+        }
+
+        _control_accept(_control, _socket, passthrou->time.tv_sec);
+    }
+}
+
+rcontrol
+control_create (
+    OUT scontrol*               control,
+    BTH spoll*                  poll,
+    IN  const char*             path,
+    IN  ssource*                sources,
+    IN  srtlink*                rtlink
+) {
+    struct sockaddr_un _address;
+
+    memset(&_address, 0, sizeof(_address));
+    _address.sun_family = AF_UNIX;
+
+    if (sizeof(_address.sun_path) <= strlen(path)) {
+        LOG(error, "control socket path is too long [%lu characters at most]", (unsigned long)(sizeof(_address.sun_path) - 1));
+        return rcontrol_failed;
+    }
+
+    strcpy(_address.sun_path, path);
+    strcpy(control->path,     path);
+
+    control->sources = sources;
+    control->rtlink  = rtlink;
+    control->count   = 0;
+    control->clients = NULL;
+
+    socket_t _socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(error, "can't create control socket, "PRIerrno, DPRIerrno);
+        return rcontrol_failed;
+    }
+
+    //stale socket of previous run
+    if ((0 > unlink(path)) && (ENOENT != errno))
+        LOG(warning, "can't remove %s, "PRIerrno, path, DPRIerrno);
+
+    if (0 > bind(_socket, (struct sockaddr*)&_address, sizeof(_address))) {
+        LOG(error, "can't bind control socket to %s, "PRIerrno, path, DPRIerrno);
+        goto _failed;
+    }
+
+    if (0 > listen(_socket, CONTROL_BACKLOG)) {
+        LOG(error, "can't listen control socket, "PRIerrno, DPRIerrno);
+        goto _failed_listen;
+    }
+
+    pollable_initialize(&(control->pollable), poll, _control_handler, _socket, FPOLLABLE_IN);
+
+    if (rpoll_ok != poll_attach(&(control->pollable)))
+        goto _failed_listen;
+
+    LOG(verbose, "control socket %s", path);
+    return rcontrol_ok;
+
+    _failed_listen:
+        unlink(path);
+
+    _failed:
+        socket_close(_socket);
+        pollable_clear(&(control->pollable));
+
+        return rcontrol_failed;
+}
+
+void
+control_destroy (
+    BTH scontrol*               control
+) {
+    while (NULL != control->clients)
+        _control_client_free(control->clients);
+
+    if SOCKET_INVALID_IS(pollable_socket(&(control->pollable)))
+        return;
+
+    poll_detach(&(control->pollable));
+    socket_close(pollable_socket(&(control->pollable)));
+    pollable_clear(&(control->pollable));
+
+    unlink(control->path);
+}
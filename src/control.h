@@ -0,0 +1,77 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_CONTROL)
+#define BPROXY_CONTROL
+
+#include "bproxy.h"
+#include "poll.h"
+#include "source.h"
+#include "rtlink.h"
+#include "metrics.h"
+
+#include <sys/un.h>
+
+/** KIM: control socket
+        unix stream socket at main poll. every accepted client gets snapshot of
+        counters in prometheus text format and connection is closed after it
+        was written, so "socat - UNIX-CONNECT:path" is enough to scrape.
+
+        snapshot is built once at accept [workers are locked by poll guard only
+        for it], then it's written from client's own buffer when socket becomes
+        writable, so slow client never holds workers. clients are limited, the
+        ones which didn't read snapshot in CONTROL_CLIENT_TIMEOUT are dropped
+**/
+
+typedef
+enum {
+        rcontrol_ok             = 0
+    ,   rcontrol_failed
+} rcontrol;
+
+typedef
+struct _control         scontrol;
+
+typedef
+struct _control_client  scontrol_client;
+
+struct _control_client {
+    spollable               pollable;
+    scontrol*               control;
+
+    smetrics                snapshot;
+    size_t                  sent;
+
+    time_t                  accepted;   //monotonic seconds
+
+    scontrol_client*        next;
+};
+
+struct _control {
+    spollable               pollable;
+    char                    path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+    ssource*                sources;
+    srtlink*                rtlink;
+
+    size_t                  count;
+    scontrol_client*        clients;
+};
+
+rcontrol
+control_create (
+    OUT scontrol*           control,
+    BTH spoll*              poll,
+    IN  const char*         path,
+    IN  ssource*            sources,
+    IN  srtlink*            rtlink
+);
+
+void
+control_destroy (
+    BTH scontrol*           control
+);
+
+#endif
@@ -0,0 +1,259 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "filter.h"
+
+#include "log.h"
+
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/if_packet.h>
+
+LOG_MODULE("filter");
+
+#define FILTER_LABEL_UNBOUND    (0xFFFF)
+
+#define FILTER_ACCEPT           (0xFFFFFFFF)
+#define FILTER_DROP             (0)
+
+static void
+_filter_emit (
+    BTH sfilter*            filter,
+        uint16_t            code,
+        uint8_t             jt,
+        uint8_t             jf,
+        uint32_t            k
+) {
+    if (FILTER_MAXIMUM <= filter->length) {
+        filter->overflow = 1;
+        return;
+    }
+
+    struct sock_filter* _instruction = &(filter->code[filter->length++]);
+
+    _instruction->code = code;
+    _instruction->jt   = jt;
+    _instruction->jf   = jf;
+    _instruction->k    = k;
+}
+
+sfilter*
+filter_create (
+) {
+    sfilter* _filter = (sfilter*)malloc(sizeof(sfilter));
+
+    if NULL_IS(_filter) {
+        LOG(critical, "out of memory: filter [%lu]", (unsigned long)sizeof(sfilter));
+        return NULL;
+    }
+
+    filter_reset(_filter);
+    return _filter;
+}
+
+void
+filter_destroy (
+    BTH sfilter*            filter
+) { free(filter); }
+
+void
+filter_reset (
+    BTH sfilter*            filter
+) {
+    filter->length   = 0;
+    filter->labels   = 0;
+    filter->overflow = 0;
+}
+
+filter_label_t
+filter_label (
+    BTH sfilter*            filter
+) {
+    if (FILTER_MAXIMUM <= filter->labels) {
+        filter->overflow = 1;
+        return 0;
+    }
+
+    filter->label[filter->labels] = FILTER_LABEL_UNBOUND;
+    return (filter_label_t)(filter->labels++);
+}
+
+void
+filter_bind (
+    BTH sfilter*            filter,
+        filter_label_t      label
+) {
+    if (filter->labels <= label)
+        return;
+
+    filter->label[label] = (uint16_t)filter->length;
+}
+
+void
+filter_lane (
+    BTH sfilter*            filter,
+        size_t              lane,
+        size_t              lanes,
+        esocket_steering    steering
+) {
+    _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_PKTTYPE);
+
+    switch (steering) {
+        case esocket_steering_flow:
+            _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,   8, 0, PACKET_HOST);
+            _filter_emit(filter, BPF_LDX | BPF_B   | BPF_MSH, 0, 0, SKF_NET_OFF);
+            _filter_emit(filter, BPF_LD  | BPF_H   | BPF_IND, 0, 0, SKF_NET_OFF);          //source port
+            _filter_emit(filter, BPF_MISC| BPF_TAX,           0, 0, 0);
+            _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_NET_OFF + 12);     //source address
+            _filter_emit(filter, BPF_ALU | BPF_ADD | BPF_X,   0, 0, 0);
+            break;
+
+        case esocket_steering_cpu:
+            _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,   4, 0, PACKET_HOST);
+            _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU);
+            break;
+    }
+
+    _filter_emit(filter, BPF_ALU | BPF_MOD | BPF_K,   0, 0, (uint32_t)lanes);
+    _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,   1, 0, (uint32_t)lane);
+    _filter_emit(filter, BPF_RET | BPF_K,             0, 0, FILTER_DROP);
+}
+
+void
+filter_packet (
+    BTH sfilter*            filter
+) {
+    _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_PKTTYPE);
+    _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,   0, 1, PACKET_OUTGOING);
+    _filter_emit(filter, BPF_RET | BPF_K,             0, 0, FILTER_DROP);
+
+    _filter_emit(filter, BPF_LD  | BPF_B   | BPF_ABS, 0, 0, SKF_NET_OFF + 9);      //protocol
+    _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K,   1, 0, IPPROTO_UDP);
+    _filter_emit(filter, BPF_RET | BPF_K,             0, 0, FILTER_DROP);
+
+    _filter_emit(filter, BPF_LD  | BPF_H   | BPF_ABS, 0, 0, SKF_NET_OFF + 6);      //more fragments & offset
+    _filter_emit(filter, BPF_JMP | BPF_JSET| BPF_K,   0, 1, 0x3FFF);
+    _filter_emit(filter, BPF_RET | BPF_K,             0, 0, FILTER_DROP);
+}
+
+void
+filter_prologue (
+    BTH sfilter*            filter
+) {
+    _filter_emit(filter, BPF_LDX | BPF_B   | BPF_MSH, 0, 0, SKF_NET_OFF);
+    _filter_emit(filter, BPF_LD  | BPF_H   | BPF_IND, 0, 0, SKF_NET_OFF + 2);
+    _filter_emit(filter, BPF_ST,                      0, 0, FILTER_MEM_PORT);
+
+    _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_NET_OFF + 12);
+    _filter_emit(filter, BPF_ST,                      0, 0, FILTER_MEM_FROM);
+
+    _filter_emit(filter, BPF_LD  | BPF_W   | BPF_ABS, 0, 0, SKF_NET_OFF + 16);
+    _filter_emit(filter, BPF_ST,                      0, 0, FILTER_MEM_DESTINATION);
+}
+
+void
+filter_goto (
+    BTH sfilter*            filter,
+        filter_label_t      label
+) { _filter_emit(filter, BPF_JMP | BPF_JA, 0, 0, label); }
+
+void
+filter_goto_equal (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+        ipv4_t              value,
+        filter_label_t      label
+) {
+    _filter_emit(filter, BPF_LD  | BPF_MEM,         0, 0, memory);
+    _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, 0, 1, ntohl(value));
+    filter_goto(filter, label);
+}
+
+static void
+_filter_network (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+    IN  const sipv4_network*    network,
+        uint8_t             jt,
+        uint8_t             jf
+) {
+    _filter_emit(filter, BPF_LD  | BPF_MEM,         0,  0,  memory);
+    _filter_emit(filter, BPF_ALU | BPF_AND | BPF_K, 0,  0,  ntohl(network->mask));
+    _filter_emit(filter, BPF_JMP | BPF_JEQ | BPF_K, jt, jf, ntohl(network->address & network->mask));
+}
+
+void
+filter_goto_in_network (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+    IN  const sipv4_network*    network,
+        filter_label_t      label
+) {
+    _filter_network(filter, memory, network, 0, 1);
+    filter_goto(filter, label);
+}
+
+void
+filter_goto_not_in_network (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+    IN  const sipv4_network*    network,
+        filter_label_t      label
+) {
+    _filter_network(filter, memory, network, 1, 0);
+    filter_goto(filter, label);
+}
+
+void
+filter_goto_in_portrange (
+    BTH sfilter*            filter,
+    IN  const sipv4_portrange*  portrange,
+        filter_label_t      label
+) {
+    for (const sipv4_portrange* _range = portrange; NULL != _range; _range = _range->next) {
+        _filter_emit(filter, BPF_LD  | BPF_MEM,         0, 0, FILTER_MEM_PORT);
+        _filter_emit(filter, BPF_JMP | BPF_JGE | BPF_K, 0, 2, _range->first);
+        _filter_emit(filter, BPF_JMP | BPF_JGT | BPF_K, 1, 0, _range->last);
+        filter_goto(filter, label);
+    }
+}
+
+void
+filter_return (
+    BTH sfilter*            filter,
+        int                 accept
+) { _filter_emit(filter, BPF_RET | BPF_K, 0, 0, accept?FILTER_ACCEPT:FILTER_DROP); }
+
+rfilter
+filter_finalize (
+    BTH sfilter*            filter
+) {
+    if (0 != filter->overflow) {
+        LOG(verbose, "filter is too long, limit is %u instructions", (unsigned int)FILTER_MAXIMUM);
+        return rfilter_failed;
+    }
+
+    for (size_t _i = 0; _i < filter->length; ++_i) {
+        struct sock_filter* _instruction = &(filter->code[_i]);
+
+        if ((BPF_JMP | BPF_JA) != _instruction->code)
+            continue;
+
+        if ((filter->labels <= _instruction->k) || (FILTER_LABEL_UNBOUND == filter->label[_instruction->k])) {
+            LOG(error, "filter jumps to unbound label %u", (unsigned int)_instruction->k);
+            return rfilter_failed;
+        }
+
+        //only forward jumps are allowed
+        if (filter->label[_instruction->k] <= _i) {
+            LOG(error, "filter jumps backward to label %u", (unsigned int)_instruction->k);
+            return rfilter_failed;
+        }
+
+        _instruction->k = filter->label[_instruction->k] - (_i + 1);
+    }
+
+    return rfilter_ok;
+}
@@ -0,0 +1,147 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_FILTER)
+#define BPROXY_FILTER
+
+#include "bproxy.h"
+#include "ipv4.h"
+#include "socket.h"
+
+#include <linux/filter.h>
+
+/** KIM: classic bpf socket filter builder
+        program works on udp and raw sockets both: all loads are relative to
+        network header [SKF_NET_OFF]. prologue stores fields into scratch memory,
+        so every check is "load, compare, jump"
+
+        all conditional jumps are short [over next instruction only], far jumps
+        are "ja" to label which is resolved at finalize, so program size isn't
+        limited by 8 bit jt/jf offsets
+**/
+
+#define FILTER_MAXIMUM          (BPF_MAXINSNS)
+
+#define FILTER_MEM_FROM         (0)     //source address
+#define FILTER_MEM_DESTINATION  (1)     //destination address
+#define FILTER_MEM_PORT         (2)     //destination port
+
+typedef
+enum {
+        rfilter_ok          = 0
+    ,   rfilter_failed
+} rfilter;
+
+typedef
+uint16_t                filter_label_t;
+
+typedef
+struct _filter          sfilter;
+
+struct _filter {
+    size_t                  length;
+    size_t                  labels;
+
+    int                     overflow;
+
+    struct sock_filter      code[FILTER_MAXIMUM];
+    uint16_t                label[FILTER_MAXIMUM];  //label -> instruction
+};
+
+sfilter*
+filter_create (
+);
+
+void
+filter_destroy (
+    BTH sfilter*            filter
+);
+
+void
+filter_reset (
+    BTH sfilter*            filter
+);
+
+filter_label_t
+filter_label (
+    BTH sfilter*            filter
+);
+
+void
+filter_bind (
+    BTH sfilter*            filter,
+        filter_label_t      label
+);
+
+//lanes: drops broadcasts & multicasts of other lanes, unicast is spread by reuseport
+void
+filter_lane (
+    BTH sfilter*            filter,
+        size_t              lane,
+        size_t              lanes,
+        esocket_steering    steering
+);
+
+//packet sockets see every ip datagram: drops own outgoing ones, non udp & fragments [never reassembled]
+void
+filter_packet (
+    BTH sfilter*            filter
+);
+
+//loads FILTER_MEM_xxx
+void
+filter_prologue (
+    BTH sfilter*            filter
+);
+
+void
+filter_goto (
+    BTH sfilter*            filter,
+        filter_label_t      label
+);
+
+void
+filter_goto_equal (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+        ipv4_t              value,      //network order
+        filter_label_t      label
+);
+
+void
+filter_goto_in_network (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+    IN  const sipv4_network*    network,
+        filter_label_t      label
+);
+
+void
+filter_goto_not_in_network (
+    BTH sfilter*            filter,
+        uint32_t            memory,
+    IN  const sipv4_network*    network,
+        filter_label_t      label
+);
+
+void
+filter_goto_in_portrange (
+    BTH sfilter*            filter,
+    IN  const sipv4_portrange*  portrange,
+        filter_label_t      label
+);
+
+void
+filter_return (
+    BTH sfilter*            filter,
+        int                 accept
+);
+
+rfilter
+filter_finalize (
+    BTH sfilter*            filter
+);
+
+#endif
@@ -0,0 +1,94 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "histogram.h"
+
+#include <inttypes.h>
+
+#define HISTOGRAM_METRICS_FIRST     (10)    //2^10 ns ~ 1us
+#define HISTOGRAM_METRICS_LAST      (30)    //2^30 ns ~ 1s
+
+//exclusive
+static inline uint64_t
+_histogram_upper (
+        size_t              index
+) {
+    if (index < HISTOGRAM_SUB)
+        return (uint64_t)(index + 1);
+
+    unsigned int _shift = (unsigned int)(index >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t     _lower = ((uint64_t)(HISTOGRAM_SUB + (index & (HISTOGRAM_SUB - 1)))) << _shift;
+
+    return _lower + (((uint64_t)1) << _shift);
+}
+
+void
+histogram_merge (
+    BTH shistogram*         target,
+    IN  const shistogram*   histogram
+) {
+    target->count += histogram->count;
+    target->sum   += histogram->sum;
+
+    if (target->max < histogram->max)
+        target->max = histogram->max;
+
+    for (size_t _i = 0; _i < HISTOGRAM_BUCKETS; ++_i)
+        target->buckets[_i] += histogram->buckets[_i];
+}
+
+uint64_t
+histogram_percentile (
+    IN  const shistogram*   histogram,
+        double              percentile
+) {
+    if (0 == histogram->count)
+        return 0;
+
+    uint64_t _rank = (uint64_t)((percentile / 100.0) * (double)histogram->count + 0.5);
+
+    if (1 > _rank)
+        _rank = 1;
+
+    uint64_t _seen = 0;
+
+    for (size_t _i = 0; _i < HISTOGRAM_BUCKETS; ++_i) {
+        _seen += histogram->buckets[_i];
+
+        if (_seen < _rank)
+            continue;
+
+        uint64_t _value = _histogram_upper(_i) - 1;
+        return (_value < histogram->max)?_value:histogram->max;
+    }
+
+    return histogram->max;
+}
+
+void
+histogram_metrics (
+    IN  const shistogram*   histogram,
+    BTH smetrics*           metrics,
+    IN  const char*         name,
+    IN  const char*         labels
+) {
+    uint64_t _cumulative = 0;
+    size_t   _bucket     = 0;
+
+    for (unsigned int _k = HISTOGRAM_METRICS_FIRST; _k <= HISTOGRAM_METRICS_LAST; ++_k) {
+        //bucket of 2^k starts at (k - SUB_BITS + 1) << SUB_BITS, so powers of two are bucket bounds
+        size_t _until = ((size_t)(_k - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS);
+
+        for (; _bucket < _until; ++_bucket)
+            _cumulative += histogram->buckets[_bucket];
+
+        //bound is exclusive, values are whole nanoseconds, le is inclusive
+        metrics_printf(metrics, "%s_bucket{%s,le=\"%.10g\"} %"PRIu64"\n", name, labels, (double)((((uint64_t)1) << _k) - 1) * 1e-9, _cumulative);
+    }
+
+    metrics_printf(metrics, "%s_bucket{%s,le=\"+Inf\"} %"PRIu64"\n", name, labels, histogram->count);
+    metrics_printf(metrics, "%s_sum{%s} %.9f\n",                       name, labels, (double)histogram->sum * 1e-9);
+    metrics_printf(metrics, "%s_count{%s} %"PRIu64"\n",                name, labels, histogram->count);
+}
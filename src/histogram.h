@@ -0,0 +1,88 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_HISTOGRAM)
+#define BPROXY_HISTOGRAM
+
+#include "bproxy.h"
+#include "metrics.h"
+
+/** KIM: log-linear [hdr style] histogram of nanoseconds
+        values below HISTOGRAM_SUB are exact, above every power of two is split
+        to HISTOGRAM_SUB buckets, so relative error is below 1/HISTOGRAM_SUB.
+        values above last bucket are clamped into it [max is kept exact].
+
+        histogram has single writer [lane's worker], so record is plain adds,
+        readers merge lanes while workers are locked, same as counters
+**/
+
+#define HISTOGRAM_SUB_BITS      (3)
+#define HISTOGRAM_SUB           (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAGNITUDE     (40)    //2^40 ns, ~18 minutes
+#define HISTOGRAM_BUCKETS       ((HISTOGRAM_MAGNITUDE - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+typedef
+struct _histogram       shistogram;
+
+struct _histogram {
+    uint64_t                count;
+    uint64_t                sum;
+    uint64_t                max;
+
+    uint64_t                buckets[HISTOGRAM_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+static inline size_t
+histogram_index (
+        uint64_t            value
+) {
+    if (value < HISTOGRAM_SUB)
+        return (size_t)value;
+
+    unsigned int _shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BITS;
+    size_t       _index = ((size_t)(_shift + 1) << HISTOGRAM_SUB_BITS) + (size_t)((value >> _shift) & (HISTOGRAM_SUB - 1));
+
+    return (_index < HISTOGRAM_BUCKETS)?_index:(HISTOGRAM_BUCKETS - 1);
+}
+
+//records same value count times [whole batch]
+static inline void
+histogram_record (
+    BTH shistogram*         histogram,
+        uint64_t            value,
+        uint64_t            count
+) {
+    histogram->buckets[histogram_index(value)] += count;
+
+    histogram->count += count;
+    histogram->sum   += value * count;
+
+    if (histogram->max < value)
+        histogram->max = value;
+}
+
+void
+histogram_merge (
+    BTH shistogram*         target,
+    IN  const shistogram*   histogram
+);
+
+//upper bound of bucket holding percentile [0, 100]
+uint64_t
+histogram_percentile (
+    IN  const shistogram*   histogram,
+        double              percentile
+);
+
+//"name{labels,le=...}" series in seconds, le are powers of two from 1us less 1ns [family header isn't printed]
+void
+histogram_metrics (
+    IN  const shistogram*   histogram,
+    BTH smetrics*           metrics,
+    IN  const char*         name,
+    IN  const char*         labels
+);
+
+#endif
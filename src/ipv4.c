@@ -13,6 +13,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <netinet/in.h>
 
 LOG_MODULE("ipv4");
 
@@ -20,6 +21,72 @@ const sipv4_network IPV4_NETWORK_ALL_MULTICAST = IPV4_NETWORK(224,  0,  0,  0,
 const sipv4_network IPV4_NETWORK_ANY           = IPV4_NETWORK(0,    0,  0,  0,  0);
 const sipv4_network IPV4_NETWORK_BROADCAST     = IPV4_NETWORK(255,255,255,255, 32);
 
+ripv4
+ipv4_ports_compile (
+    IN  const sipv4_portrange*      portrange,
+    OUT sipv4_ports**               ports
+) {
+    (*ports) = NULL;
+
+    if NULL_IS(portrange)
+        return ripv4_ok;
+
+    uint64_t* _bitmap = (uint64_t*)calloc(1024, sizeof(uint64_t));
+
+    if NULL_IS(_bitmap) {
+        LOG(critical, "out of memory: ports bitmap");
+        return ripv4_failed;
+    }
+
+    for (const sipv4_portrange* _range = portrange; NULL != _range; _range = _range->next)
+        for (uint32_t _port = _range->first; _port <= _range->last; ++_port)
+            _bitmap[_port >> 6] |= (((uint64_t)1) << (_port & 63));
+
+    uint16_t _index[256];
+    size_t   _leaves = 2;
+
+    for (size_t _i = 0; _i < 256; ++_i) {
+        uint64_t* _leaf = &(_bitmap[_i * 4]);
+
+        if ((0 == _leaf[0]) && (0 == _leaf[1]) && (0 == _leaf[2]) && (0 == _leaf[3]))
+            _index[_i] = IPV4_PORTS_LEAF_EMPTY;
+
+        else if ((~((uint64_t)0) == (_leaf[0] & _leaf[1] & _leaf[2] & _leaf[3])))
+            _index[_i] = IPV4_PORTS_LEAF_FULL;
+
+        else
+            _index[_i] = (uint16_t)(_leaves++);
+    }
+
+    sipv4_ports* _ports = (sipv4_ports*)malloc(sizeof(sipv4_ports) + _leaves * sizeof(_ports->leaves[0]));
+
+    if NULL_IS(_ports) {
+        LOG(critical, "out of memory: ports [%lu]", (unsigned long)(sizeof(sipv4_ports) + _leaves * 4 * sizeof(uint64_t)));
+
+        free(_bitmap);
+        return ripv4_failed;
+    }
+
+    memcpy(_ports->index, _index, sizeof(_index));
+
+    memset(_ports->leaves[IPV4_PORTS_LEAF_EMPTY], 0x00, sizeof(_ports->leaves[0]));
+    memset(_ports->leaves[IPV4_PORTS_LEAF_FULL],  0xFF, sizeof(_ports->leaves[0]));
+
+    for (size_t _i = 0; _i < 256; ++_i)
+        if (IPV4_PORTS_LEAF_FULL < _index[_i])
+            memcpy(_ports->leaves[_index[_i]], &(_bitmap[_i * 4]), sizeof(_ports->leaves[0]));
+
+    free(_bitmap);
+
+    (*ports) = _ports;
+    return ripv4_ok;
+}
+
+void
+ipv4_ports_destroy (
+    BTH sipv4_ports*                ports
+) { free(ports); }
+
 ripv4
 ipv4_allow_allowed_is (
     IN  const sipv4_allow*          allow,
@@ -33,7 +100,7 @@ ipv4_allow_allowed_is (
             if (NULL != _current->allow_to) {
                 for (const sipv4_allow_to* _to = _current->allow_to; NULL != _to; _to = _to->next)
                     if (ripv4_ok == ipv4_address_in_network(destination->address, &(_to->address)))
-                        return ipv4_portrange_check(_to->portrange, _port);
+                        return ipv4_ports_check(_to->ports, _port);
 
                 continue;
             }
@@ -48,6 +115,293 @@ ipv4_allow_allowed_is (
     return ripv4_failed;
 }
 
+typedef
+struct _ipv4_lpm_match {
+    size_t                      count;
+
+    const sipv4_lpm_entry*      entries[IPV4_LPM_LEVELS + 1];
+    uint32_t                    cursors[IPV4_LPM_LEVELS + 1];
+} _sipv4_lpm_match;
+
+static ripv4
+_ipv4_lpm_node_allocate (
+    BTH sipv4_lpm*                  lpm,
+    OUT uint32_t*                   index
+) {
+    if (lpm->count == lpm->capacity) {
+        size_t          _capacity = (0 == lpm->capacity)?4:(lpm->capacity * 2);
+        sipv4_lpm_node* _nodes    = (sipv4_lpm_node*)realloc(lpm->nodes, _capacity * sizeof(sipv4_lpm_node));
+
+        if NULL_IS(_nodes) {
+            LOG(critical, "out of memory: classifier nodes [%lu]", (unsigned long)(_capacity * sizeof(sipv4_lpm_node)));
+            return ripv4_failed;
+        }
+
+        lpm->nodes    = _nodes;
+        lpm->capacity = _capacity;
+    }
+
+    memset(&(lpm->nodes[lpm->count]), 0, sizeof(sipv4_lpm_node));
+
+    (*index) = (uint32_t)(lpm->count++);
+    return ripv4_ok;
+}
+
+static ripv4
+_ipv4_lpm_initialize (
+    OUT sipv4_lpm*                  lpm
+) {
+    memset(lpm, 0, sizeof(sipv4_lpm));
+
+    uint32_t _root;
+    return _ipv4_lpm_node_allocate(lpm, &_root);
+}
+
+static void
+_ipv4_lpm_cleanup (
+    BTH sipv4_lpm*                  lpm
+) {
+    for (size_t _i = 0; _i < lpm->count; ++_i)
+        for (size_t _e = 0; _e < IPV4_LPM_FANOUT; ++_e)
+            free(lpm->nodes[_i].entry[_e].rules);
+
+    free(lpm->nodes);
+    free(lpm->any.rules);
+
+    memset(lpm, 0, sizeof(sipv4_lpm));
+}
+
+static ripv4
+_ipv4_lpm_entry_append (
+    BTH sipv4_lpm_entry*            entry,
+        uint32_t                    rule
+) {
+    uint32_t* _rules = (uint32_t*)realloc(entry->rules, (entry->count + 1) * sizeof(uint32_t));
+
+    if NULL_IS(_rules) {
+        LOG(critical, "out of memory: classifier rules");
+        return ripv4_failed;
+    }
+
+    _rules[entry->count++] = rule;
+    entry->rules = _rules;
+
+    return ripv4_ok;
+}
+
+//rules are inserted in list order, so entries stay sorted
+static ripv4
+_ipv4_lpm_insert (
+    BTH sipv4_lpm*                  lpm,
+    IN  const sipv4_network*        network,
+        uint32_t                    rule
+) {
+    uint32_t _mask   = ntohl(network->mask);
+    uint32_t _length = (uint32_t)__builtin_popcount(_mask);
+
+    if ((0 < _length) && (_mask != (((uint32_t)~0) << (32 - _length)))) {
+        LOG(verbose, "classifier: non-contiguous mask "IPV4_PRIADDR, IPV4_DPRIADDR(network->mask));
+        return ripv4_failed;
+    }
+
+    if (0 == _length)
+        return _ipv4_lpm_entry_append(&(lpm->any), rule);
+
+    uint32_t _prefix = ntohl(network->address) & _mask;
+    uint32_t _node   = 0;
+
+    for (uint32_t _level = 1; ; ++_level) {
+        uint32_t _entry = (_prefix >> (32 - IPV4_LPM_STRIDE * _level)) & (IPV4_LPM_FANOUT - 1);
+
+        if (_length <= IPV4_LPM_STRIDE * _level) {
+            //controlled prefix expansion
+            for (uint32_t _span = (1u << (IPV4_LPM_STRIDE * _level - _length)); _span--; ++_entry)
+                if (ripv4_ok != _ipv4_lpm_entry_append(&(lpm->nodes[_node].entry[_entry]), rule))
+                    return ripv4_failed;
+
+            return ripv4_ok;
+        }
+
+        if (0 == lpm->nodes[_node].entry[_entry].child) {
+            uint32_t _child;
+
+            if (ripv4_ok != _ipv4_lpm_node_allocate(lpm, &_child))
+                return ripv4_failed;
+
+            lpm->nodes[_node].entry[_entry].child = _child;
+        }
+
+        _node = lpm->nodes[_node].entry[_entry].child;
+    }
+}
+
+static inline void
+_ipv4_lpm_match (
+    IN  const sipv4_lpm*            lpm,
+        ipv4_t                      address,
+    OUT _sipv4_lpm_match*           match
+) {
+    uint32_t _address = ntohl(address);
+    uint32_t _node    = 0;
+
+    match->count = 0;
+
+    if (0 < lpm->any.count) {
+        match->entries[match->count] = &(lpm->any);
+        match->cursors[match->count] = 0;
+        match->count++;
+    }
+
+    for (uint32_t _level = 1; _level <= IPV4_LPM_LEVELS; ++_level) {
+        const sipv4_lpm_entry* _entry = &(lpm->nodes[_node].entry[(_address >> (32 - IPV4_LPM_STRIDE * _level)) & (IPV4_LPM_FANOUT - 1)]);
+
+        if (0 < _entry->count) {
+            match->entries[match->count] = _entry;
+            match->cursors[match->count] = 0;
+            match->count++;
+        }
+
+        if (0 == (_node = _entry->child))
+            break;
+    }
+}
+
+//next matched rule in list order
+static inline uint32_t
+_ipv4_lpm_next (
+    BTH _sipv4_lpm_match*           match
+) {
+    size_t   _best = match->count;
+    uint32_t _rule = IPV4_LPM_NONE;
+
+    for (size_t _i = 0; _i < match->count; ++_i)
+        if (match->cursors[_i] < match->entries[_i]->count)
+            if (match->entries[_i]->rules[match->cursors[_i]] < _rule) {
+                _rule = match->entries[_i]->rules[match->cursors[_i]];
+                _best = _i;
+            }
+
+    if (_best < match->count)
+        match->cursors[_best]++;
+
+    return _rule;
+}
+
+void
+ipv4_classifier_destroy (
+    BTH sipv4_classifier*           classifier
+) {
+    if NULL_IS(classifier)
+        return;
+
+    for (size_t _i = 0; _i < classifier->count; ++_i) {
+        _ipv4_lpm_cleanup(&(classifier->rules[_i].to));
+        free(classifier->rules[_i].to_rules);
+    }
+
+    _ipv4_lpm_cleanup(&(classifier->from));
+
+    free(classifier->rules);
+    free(classifier);
+}
+
+sipv4_classifier*
+ipv4_classifier_create (
+    IN  const sipv4_allow*          allow
+) {
+    sipv4_classifier* _classifier = (sipv4_classifier*)calloc(1, sizeof(sipv4_classifier));
+
+    if NULL_IS(_classifier) {
+        LOG(critical, "out of memory: classifier [%lu]", (unsigned long)sizeof(sipv4_classifier));
+        return NULL;
+    }
+
+    size_t _count = 0;
+
+    for (const sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next)
+        ++_count;
+
+    if NULL_IS(_classifier->rules = (sipv4_classifier_rule*)calloc(_count, sizeof(sipv4_classifier_rule))) {
+        LOG(critical, "out of memory: classifier rules [%lu]", (unsigned long)(_count * sizeof(sipv4_classifier_rule)));
+        goto _failed;
+    }
+
+    if (ripv4_ok != _ipv4_lpm_initialize(&(_classifier->from)))
+        goto _failed;
+
+    for (const sipv4_allow* _allow = allow; NULL != _allow; _allow = _allow->next) {
+        sipv4_classifier_rule* _rule = &(_classifier->rules[_classifier->count]);
+
+        _rule->allow = _allow;
+
+        if (ripv4_ok != _ipv4_lpm_insert(&(_classifier->from), &(_allow->address), (uint32_t)(_classifier->count++)))
+            goto _failed;
+
+        if NULL_IS(_allow->allow_to)
+            continue;
+
+        size_t _to_count = 0;
+
+        for (const sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next)
+            ++_to_count;
+
+        if NULL_IS(_rule->to_rules = (const sipv4_allow_to**)calloc(_to_count, sizeof(sipv4_allow_to*))) {
+            LOG(critical, "out of memory: classifier rules [%lu]", (unsigned long)(_to_count * sizeof(sipv4_allow_to*)));
+            goto _failed;
+        }
+
+        if (ripv4_ok != _ipv4_lpm_initialize(&(_rule->to)))
+            goto _failed;
+
+        size_t _j = 0;
+
+        for (const sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next, ++_j) {
+            _rule->to_rules[_j] = _to;
+
+            if (ripv4_ok != _ipv4_lpm_insert(&(_rule->to), &(_to->address), (uint32_t)_j))
+                goto _failed;
+        }
+    }
+
+    return _classifier;
+
+    _failed:
+        ipv4_classifier_destroy(_classifier);
+        return NULL;
+}
+
+ripv4
+ipv4_classifier_allowed_is (
+    IN  const sipv4_classifier*     classifier,
+        ipv4_t                      from,
+        sipv4_destination*          destination
+) {
+    _sipv4_lpm_match _from;
+    _ipv4_lpm_match(&(classifier->from), from, &_from);
+
+    for (uint32_t _i; IPV4_LPM_NONE != (_i = _ipv4_lpm_next(&_from)); ) {
+        const sipv4_classifier_rule* _rule = &(classifier->rules[_i]);
+
+        if NULL_IS(_rule->allow->allow_to) {
+            //recalculate broadcast from network
+            if (destination->address == ipv4_network_broadcast(&(_rule->allow->address)))
+                return ripv4_ok;
+
+            return ripv4_failed;
+        }
+
+        _sipv4_lpm_match _to;
+        _ipv4_lpm_match(&(_rule->to), destination->address, &_to);
+
+        uint32_t _j = _ipv4_lpm_next(&_to);
+
+        if (IPV4_LPM_NONE != _j)
+            return ipv4_ports_check(_rule->to_rules[_j]->ports, ntohs(destination->port));
+    }
+
+    return ripv4_failed;
+}
+
 SYSCTL_WRAPPER_IMPLEMENT(ipv4_default_ttl,      u8,     "net.ipv4.ip_default_ttl"     );
 SYSCTL_WRAPPER_IMPLEMENT(ipv4_minimum_pmtu,     u32,    "net.ipv4.route.min_pmtu"     );
 
@@ -56,6 +56,9 @@ struct _ipv4_allow_to           sipv4_allow_to;
 typedef
 struct _ipv4_portrange          sipv4_portrange;
 
+typedef
+struct _ipv4_ports              sipv4_ports;
+
 typedef
 struct _ipv4_network {
     ipv4_t                      address;
@@ -77,6 +80,7 @@ struct _ipv4_allow_to {
     sipv4_network               address;
 
     sipv4_portrange*            portrange;
+    sipv4_ports*                ports;      //compiled portrange
 
     sipv4_allow_to*             next;
 };
@@ -113,19 +117,59 @@ ipv4_network_broadcast (
     IN  const sipv4_network*        network
 ) { return ipv4_broadcast(network->address, network->mask); }
 
-static inline ripv4
-ipv4_portrange_check (
+//internet checksum of header [even length], host order
+static inline uint16_t
+ipv4_checksum (
+    IN  const void*                 header,
+        size_t                      length
+) {
+    const ubyte_t* _bytes = (const ubyte_t*)header;
+    uint32_t       _sum   = 0;
+
+    for (size_t _i = 0; _i < length; _i += 2)
+        _sum += (((uint32_t)_bytes[_i] << 8) | _bytes[_i + 1]);
+
+    while (0 != (_sum >> 16))
+        _sum = ((_sum & 0xFFFF) + (_sum >> 16));
+
+    return (uint16_t)(~_sum);
+}
+
+/** KIM: compiled port-range
+        lists are for parser only, hot path checks two level bitmap: high byte
+        selects 256 bit leaf, empty and full leaves are shared, so any range
+        costs 512 bytes + 32 bytes per partially covered leaf
+**/
+
+#define IPV4_PORTS_LEAF_EMPTY       (0)
+#define IPV4_PORTS_LEAF_FULL        (1)
+
+struct _ipv4_ports {
+    uint16_t                    index[256];
+    uint64_t                    leaves[][4];
+};
+
+//NULL portrange [any port] is compiled into NULL
+ripv4
+ipv4_ports_compile (
     IN  const sipv4_portrange*      portrange,
+    OUT sipv4_ports**               ports
+);
+
+void
+ipv4_ports_destroy (
+    BTH sipv4_ports*                ports
+);
+
+static inline ripv4
+ipv4_ports_check (
+    IN  const sipv4_ports*          ports,
         uint16_t                    port
 ) {
-    if NULL_IS(portrange)
+    if NULL_IS(ports)
         return ripv4_ok;
 
-    for (const sipv4_portrange* _range = portrange; NULL != _range; _range = _range->next)
-        if ((port >= _range->first) && (port <= _range->last))
-            return ripv4_ok;
-
-    return ripv4_failed;
+    return (0 != ((ports->leaves[ports->index[port >> 8]][(port >> 6) & 3] >> (port & 63)) & 1))?ripv4_ok:ripv4_failed;
 }
 
 ripv4
@@ -135,6 +179,76 @@ ipv4_allow_allowed_is (
         sipv4_destination*          destination
 );
 
+/** KIM: compiled allow list
+        multibit trie [stride 8, 4 levels] with controlled prefix expansion,
+        entry keeps sorted indexes of all rules expanded into it, so lookup
+        collects at most 5 short lists [/0 + one per level] and walks them
+        in list order - first-match semantics of ipv4_allow_allowed_is kept,
+        including "continue" when no "to" matched.
+
+        built at configuration time, read-only after that
+**/
+
+#define IPV4_LPM_STRIDE             (8)
+#define IPV4_LPM_FANOUT             (1 << IPV4_LPM_STRIDE)
+#define IPV4_LPM_LEVELS             (32 / IPV4_LPM_STRIDE)
+#define IPV4_LPM_NONE               ((uint32_t)~0)
+
+typedef
+struct _ipv4_lpm_entry {
+    uint32_t                    child;      //node index, 0 - none [root is never a child]
+    uint32_t                    count;
+    uint32_t*                   rules;      //ascending
+} sipv4_lpm_entry;
+
+typedef
+struct _ipv4_lpm_node {
+    sipv4_lpm_entry             entry[IPV4_LPM_FANOUT];
+} sipv4_lpm_node;
+
+typedef
+struct _ipv4_lpm {
+    size_t                      count;
+    size_t                      capacity;
+    sipv4_lpm_node*             nodes;
+
+    sipv4_lpm_entry             any;        //zero length prefixes
+} sipv4_lpm;
+
+typedef
+struct _ipv4_classifier_rule {
+    const sipv4_allow*          allow;
+
+    sipv4_lpm                   to;
+    const sipv4_allow_to**      to_rules;
+} sipv4_classifier_rule;
+
+typedef
+struct _ipv4_classifier {
+    sipv4_lpm                   from;
+
+    size_t                      count;
+    sipv4_classifier_rule*      rules;
+} sipv4_classifier;
+
+//NULL if list can't be compiled [non-contiguous mask, out of memory]
+sipv4_classifier*
+ipv4_classifier_create (
+    IN  const sipv4_allow*          allow
+);
+
+void
+ipv4_classifier_destroy (
+    BTH sipv4_classifier*           classifier
+);
+
+ripv4
+ipv4_classifier_allowed_is (
+    IN  const sipv4_classifier*     classifier,
+        ipv4_t                      from,
+        sipv4_destination*          destination
+);
+
 /// === sysctl wrappers
 
 SYSCTL_WRAPPER(ipv4_default_ttl,        u8  );
@@ -10,8 +10,20 @@
 #include <stdarg.h>
 #include <string.h>
 #include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
 
 static const char* const MODULE = "log";
+static const char* const glog_level_names[]      = {
+        "debug"
+    ,   "verbose"
+    ,   "information"
+    ,   "warning"
+    ,   "error"
+    ,   "critical"
+};
+
 static const char* const glog_level_printable[]  = {
         "d"
     ,   "v"
@@ -21,18 +33,265 @@ static const char* const glog_level_printable[]  = {
     ,   "c"
 };
 
-static uint32_t     glog_suppression = 0;
+uint32_t            glog_suppression = 0;
 static FILE*        glog_file        = NULL;
-static char*        glog_buffer      = NULL;
+
+/** KIM: asynchronous logging
+        once log_async_start is called, lines are formatted by callers into
+        bounded mpsc ring [vyukov's queue, every slot has own sequence], and
+        the writer thread stamps, writes and flushes them. time, localtime &
+        file i/o never happen on relay threads.
+
+        when ring is full, line is dropped and counted, writer reports it.
+        writer polls ring every LOG_RING_IDLE ms while it's empty, so callers
+        never make syscalls to wake it up
+**/
+
+typedef
+struct _log_slot {
+    uint64_t            sequence;
+    elog                level;
+    const char*         block;
+    time_t              time;
+    char                text[LOG_BUFFER_SIZE];
+} slog_slot;
+
+typedef
+struct _log_ring {
+    slog_slot*          slots;
+    uint64_t            tail    __attribute__((aligned(CACHE_LINE_SIZE)));  //producers
+    uint64_t            dropped __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    pthread_t           writer;
+    pthread_mutex_t     file_guard; //log_reopen vs. writer
+    int                 working;
+    int                 active;     //ring accepts lines
+
+    time_t              stamp_time; //writer's cache of formatted second
+    char                stamp[32];
+} slog_ring;
+
+static slog_ring    glog_ring        = { .slots = NULL, .active = 0 };
+
+//prints formatted line, time is used only if date isn't suppressed
+static int
+_log_print (
+        elog            level,
+        const char*     block,
+        const char*     stamp,
+        const char*     text
+) {
+    if (glog_suppression & (1 << elog_LOG_DATE))
+        return fprintf(glog_file, "[%s:%-14s] %s\n", glog_level_printable[level], block, text);
+
+    return fprintf(glog_file, "%s [%s:%-14s] %s\n", stamp, glog_level_printable[level], block, text);
+}
+
+static const char*
+_log_stamp (
+        time_t          time,
+        char*           buffer,
+        size_t          length
+) {
+    struct tm _tm;
+
+    localtime_r(&time, &_tm);
+    strftime(buffer, length, "%Y/%m/%d %H%M.%S", &_tm);
+
+    return buffer;
+}
+
+//takes slot, NULL - ring is full
+static slog_slot*
+_log_ring_claim (
+) {
+    uint64_t _position = __atomic_load_n(&(glog_ring.tail), __ATOMIC_RELAXED);
+
+    FOREVER {
+        slog_slot* _slot     = &(glog_ring.slots[_position & (LOG_RING_SIZE - 1)]);
+        uint64_t   _sequence = __atomic_load_n(&(_slot->sequence), __ATOMIC_ACQUIRE);
+        int64_t    _diff     = (int64_t)(_sequence - _position);
+
+        if (0 == _diff) {
+            if (__atomic_compare_exchange_n(&(glog_ring.tail), &_position, _position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                return _slot;
+
+        } else if (0 > _diff) {
+            return NULL;
+
+        } else {
+            _position = __atomic_load_n(&(glog_ring.tail), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int
+_log_ring_write_va (
+        elog            level,
+        const char*     block,
+        const char*     format,
+        va_list         va
+) {
+    slog_slot* _slot = _log_ring_claim();
+
+    if NULL_IS(_slot) {
+        __atomic_add_fetch(&(glog_ring.dropped), 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    int _return = vsnprintf(_slot->text, LOG_BUFFER_SIZE, format, va);
+
+    _slot->text[LOG_BUFFER_SIZE - 1] = 0;
+    _slot->level = level;
+    _slot->block = block;
+    _slot->time  = time(NULL);   //vdso
+
+    //slot's sequence is position + 1 when it's ready to be written
+    __atomic_store_n(&(_slot->sequence), __atomic_load_n(&(_slot->sequence), __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+
+    return _return;
+}
+
+//writes ready lines, returns count of them
+static size_t
+_log_ring_drain (
+        uint64_t*       head
+) {
+    size_t _count = 0;
+
+    pthread_mutex_lock(&(glog_ring.file_guard));
+
+    FOREVER {
+        slog_slot* _slot = &(glog_ring.slots[(*head) & (LOG_RING_SIZE - 1)]);
+
+        if (__atomic_load_n(&(_slot->sequence), __ATOMIC_ACQUIRE) != ((*head) + 1))
+            break;
+
+        if (_slot->time != glog_ring.stamp_time) {
+            glog_ring.stamp_time = _slot->time;
+            _log_stamp(_slot->time, glog_ring.stamp, sizeof(glog_ring.stamp));
+        }
+
+        _log_print(_slot->level, _slot->block, glog_ring.stamp, _slot->text);
+
+        //slot is free for position + LOG_RING_SIZE
+        __atomic_store_n(&(_slot->sequence), (*head) + LOG_RING_SIZE, __ATOMIC_RELEASE);
+
+        (*head)++;
+        _count++;
+    }
+
+    uint64_t _dropped = __atomic_exchange_n(&(glog_ring.dropped), 0, __ATOMIC_RELAXED);
+
+    if (0 != _dropped) {
+        char _stamp[32];
+        char _text[64];
+
+        snprintf(_text, sizeof(_text), "%"PRIu64" lines dropped, cuz' log ring is full", _dropped);
+        _log_print(elog_warning, MODULE, _log_stamp(time(NULL), _stamp, sizeof(_stamp)), _text);
+    }
+
+    if ((0 != _count) || (0 != _dropped))
+        fflush(glog_file);
+
+    pthread_mutex_unlock(&(glog_ring.file_guard));
+
+    return _count;
+}
+
+static void*
+_log_writer_routine (
+        void*           context
+) {
+    (void)context;
+
+    uint64_t        _head = 0;
+    struct timespec _idle = { 0, LOG_RING_IDLE * 1000000L };
+
+    while (0 != __atomic_load_n(&(glog_ring.working), __ATOMIC_ACQUIRE))
+        if (0 == _log_ring_drain(&_head))
+            nanosleep(&_idle, NULL);
+
+    //ring is inactive already, so it's the last lines
+    _log_ring_drain(&_head);
+
+    return NULL;
+}
 
 rlog
-log_startup (
-    uint32_t            mask
+log_async_start (
 ) {
-    glog_buffer = (char*)malloc(LOG_BUFFER_SIZE);
-    if NULL_IS(glog_buffer)
+    if (0 != glog_ring.active)
+        return rlog_ok;
+
+    if NULL_IS(glog_ring.slots = (slog_slot*)malloc(LOG_RING_SIZE * sizeof(slog_slot))) {
+        log_write(elog_error, MODULE, "out of memory: log ring [%lu]", (unsigned long)(LOG_RING_SIZE * sizeof(slog_slot)));
         return rlog_failed;
+    }
+
+    for (uint64_t _i = 0; _i < LOG_RING_SIZE; ++_i)
+        glog_ring.slots[_i].sequence = _i;
+
+    glog_ring.tail       = 0;
+    glog_ring.dropped    = 0;
+    glog_ring.working    = 1;
+    glog_ring.stamp_time = 0;
+    glog_ring.stamp[0]   = 0;
+
+    if (0 != pthread_mutex_init(&(glog_ring.file_guard), NULL))
+        goto _failed;
+
+    //signals are handled by main thread only [see workers_start]
+    sigset_t _all;
+    sigset_t _old;
+
+    sigfillset(&_all);
+    pthread_sigmask(SIG_BLOCK, &_all, &_old);
+
+    int _r = pthread_create(&(glog_ring.writer), NULL, _log_writer_routine, NULL);
+
+    pthread_sigmask(SIG_SETMASK, &_old, NULL);
+
+    if (0 != _r) {
+        pthread_mutex_destroy(&(glog_ring.file_guard));
+        goto _failed;
+    }
+
+    __atomic_store_n(&(glog_ring.active), 1, __ATOMIC_RELEASE);
+
+    log_write(elog_debug, MODULE, "asynchronous, ring of %u lines", (unsigned int)LOG_RING_SIZE);
+    return rlog_ok;
+
+    _failed:
+        log_write(elog_error, MODULE, "can't start log writer thread");
+
+        free(glog_ring.slots);
+        glog_ring.slots = NULL;
+
+        return rlog_failed;
+}
 
+//all threads which may log must be stopped, lines are written synchronously after it
+void
+log_async_stop (
+) {
+    if (0 == glog_ring.active)
+        return;
+
+    __atomic_store_n(&(glog_ring.active),  0, __ATOMIC_RELEASE);
+    __atomic_store_n(&(glog_ring.working), 0, __ATOMIC_RELEASE);
+
+    pthread_join(glog_ring.writer, NULL);
+    pthread_mutex_destroy(&(glog_ring.file_guard));
+
+    free(glog_ring.slots);
+    glog_ring.slots = NULL;
+}
+
+rlog
+log_startup (
+    uint32_t            mask
+) {
     glog_file        = stdout;
     glog_suppression = mask;
 
@@ -47,8 +306,9 @@ log_cleanup (
 ) { 
     log_write(elog_debug, MODULE, "cleanup");
 
+    log_async_stop();
+
     fflush(glog_file);
-    free(glog_buffer); 
     return rlog_ok;
 }
 
@@ -61,12 +321,28 @@ log_suppress (
     return _old;
 }
 
+uint32_t
+log_suppression (
+        uint32_t        mask
+) {
+    uint32_t _old = glog_suppression;
+    glog_suppression = mask;
+    return _old;
+}
+
 uint32_t
 log_unsuppress (
         uint32_t        mask
 ) {
     uint32_t _old = glog_suppression;
     glog_suppression &= (~mask);
+
+    for (elog _level = elog_debug; _level < LOG_LEVEL_MINIMUM; ++_level)
+        if (0 != (mask & (1 << _level))) {
+            log_write(elog_warning, MODULE, "%s messages are compiled out [LOG_LEVEL_MINIMUM %d]", glog_level_names[_level], (int)LOG_LEVEL_MINIMUM);
+            break;
+        }
+
     return _old;
 }
 
@@ -77,25 +353,16 @@ _log_write_va (
         const char*     format,
         va_list         va
 ) {
-    vsnprintf(glog_buffer, LOG_BUFFER_SIZE, format, va);
-    glog_buffer[LOG_BUFFER_SIZE - 1] = 0;
-
-    int _return = 0;
+    if (0 != __atomic_load_n(&(glog_ring.active), __ATOMIC_ACQUIRE))
+        return _log_ring_write_va(level, block, format, va);
 
-    if (glog_suppression & (1 << elog_LOG_DATE)) {
-        _return = fprintf(glog_file, "[%s:%-14s] %s\n", glog_level_printable[level], block, glog_buffer);        
+    char _buffer[LOG_BUFFER_SIZE]; //own buffer per call, cuz' workers log concurrently
+    char _stamp[32];
 
-    } else {
-        char        _buffer_time[32];
-        struct tm   _tm;
-        time_t      _time;
+    vsnprintf(_buffer, LOG_BUFFER_SIZE, format, va);
+    _buffer[LOG_BUFFER_SIZE - 1] = 0;
 
-        time(&_time);
-        localtime_r(&_time, &_tm);
-        strftime(_buffer_time, sizeof(_buffer_time), "%Y/%m/%d %H%M.%S", &_tm);
-
-        _return = fprintf(glog_file, "%s [%s:%-14s] %s\n", _buffer_time, glog_level_printable[level], block, glog_buffer);         
-    }
+    int _return = _log_print(level, block, _log_stamp(time(NULL), _stamp, sizeof(_stamp)), _buffer);
 
     fflush(glog_file);
 
@@ -225,10 +492,19 @@ log_reopen (
         return rlog_failed;
     }
 
+    //writer thread may be writing right now
+    int _active = __atomic_load_n(&(glog_ring.active), __ATOMIC_ACQUIRE);
+
+    if (0 != _active)
+        pthread_mutex_lock(&(glog_ring.file_guard));
+
     glog_file = _file;
 
     fclose(_old);
 
+    if (0 != _active)
+        pthread_mutex_unlock(&(glog_ring.file_guard));
+
     log_write(elog_debug, MODULE, "file changed to %s", filename);
     return rlog_ok;
 }
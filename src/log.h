@@ -18,11 +18,22 @@
 #define LOG_LEVEL_MASK(level)   \
     ( 1 << (elog_##level) )
 
+/** KIM: levels below LOG_LEVEL_MINIMUM are compiled out, the rest are checked
+        against suppression mask before the call, so suppressed message costs
+        one load & branch [its arguments aren't evaluated]. debug & verbose are
+        expected to be suppressed, others to be written
+**/
+#define LOG_ENABLED(level)      \
+    ( (LOG_LEVEL_MINIMUM <= (elog_##level)) && (0 == (glog_suppression & LOG_LEVEL_MASK(level))) )
+
+#define LOG_EXPECTED(level)     \
+    ( (elog_information <= (elog_##level))?1:0 )
+
 #define LOG(level, ...)         \
-    log_write(elog_##level, MODULE, __VA_ARGS__)
+    do { if (__builtin_expect(LOG_ENABLED(level), LOG_EXPECTED(level))) log_write(elog_##level, MODULE, __VA_ARGS__); } while(0)
 
 #define LOG_BINARY(level, buffer, length, ...)  \
-    log_binary(elog_##level, MODULE, buffer, length, __VA_ARGS__)
+    do { if (__builtin_expect(LOG_ENABLED(level), LOG_EXPECTED(level))) log_binary(elog_##level, MODULE, buffer, length, __VA_ARGS__); } while(0)
 
 typedef
 enum {
@@ -41,6 +52,8 @@ enum {
     ,   rlog_failed
 } rlog;
 
+extern uint32_t glog_suppression;   //use LOG_ENABLED, change by log_[un]suppress or log_suppression
+
 uint32_t
 log_suppress (
         uint32_t        mask
@@ -51,6 +64,12 @@ log_unsuppress (
         uint32_t        mask
 );
 
+//replaces whole mask, reload resets or restores it, returns old one
+uint32_t
+log_suppression (
+        uint32_t        mask
+);
+
 int
 log_write (
         elog            level,
@@ -77,6 +96,15 @@ log_startup (
 rlog
 log_cleanup ();
 
+//lines are written by own thread since it's started, until log_cleanup
+rlog
+log_async_start (
+);
+
+void
+log_async_stop (
+);
+
 rlog
 log_reopen (
         const char*     filename
@@ -0,0 +1,104 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "metrics.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+LOG_MODULE("metrics");
+
+void
+metrics_initialize (
+    OUT smetrics*           metrics
+) {
+    metrics->buffer   = NULL;
+    metrics->length   = 0;
+    metrics->capacity = 0;
+    metrics->failed   = 0;
+}
+
+void
+metrics_cleanup (
+    BTH smetrics*           metrics
+) {
+    free(metrics->buffer);
+    metrics_initialize(metrics);
+}
+
+rmetrics
+metrics_state (
+    IN  smetrics*           metrics
+) { return (0 == metrics->failed)?rmetrics_ok:rmetrics_failed; }
+
+static rmetrics
+_metrics_reserve (
+    BTH smetrics*           metrics,
+        size_t              length
+) {
+    if (metrics->length + length < metrics->capacity)
+        return rmetrics_ok;
+
+    size_t _capacity = (0 == metrics->capacity)?METRICS_BUFFER_SIZE:metrics->capacity;
+
+    while (_capacity <= metrics->length + length)
+        _capacity *= 2;
+
+    char* _buffer = (char*)realloc(metrics->buffer, _capacity);
+
+    if NULL_IS(_buffer) {
+        LOG(critical, "out of memory: metrics [%lu]", (unsigned long)_capacity);
+
+        metrics->failed = 1;
+        return rmetrics_failed;
+    }
+
+    metrics->buffer   = _buffer;
+    metrics->capacity = _capacity;
+
+    return rmetrics_ok;
+}
+
+void
+metrics_printf (
+    BTH smetrics*           metrics,
+    IN  const char*         format,
+        ...
+) {
+    if (0 != metrics->failed)
+        return;
+
+    va_list _args;
+
+    va_start(_args, format);
+    int _length = vsnprintf(NULL, 0, format, _args);
+    va_end(_args);
+
+    if (0 > _length) {
+        metrics->failed = 1;
+        return;
+    }
+
+    if (rmetrics_ok != _metrics_reserve(metrics, (size_t)_length))
+        return;
+
+    va_start(_args, format);
+    vsnprintf(metrics->buffer + metrics->length, metrics->capacity - metrics->length, format, _args);
+    va_end(_args);
+
+    metrics->length += (size_t)_length;
+}
+
+void
+metrics_family (
+    BTH smetrics*           metrics,
+    IN  const char*         name,
+    IN  const char*         type,
+    IN  const char*         help
+) {
+    metrics_printf(metrics, "# HELP %s %s\n", name, help);
+    metrics_printf(metrics, "# TYPE %s %s\n", name, type);
+}
@@ -0,0 +1,68 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_METRICS)
+#define BPROXY_METRICS
+
+#include "bproxy.h"
+
+/** KIM: metrics
+        text buffer for prometheus exposition format, grows on demand. every
+        family is "# HELP" and "# TYPE" lines followed by samples, so producers
+        iterate families first and objects second.
+
+        out of memory is sticky: buffer is marked failed and following appends
+        are ignored, so producers don't check every call
+**/
+
+typedef
+enum {
+        rmetrics_ok         = 0
+    ,   rmetrics_failed
+} rmetrics;
+
+typedef
+struct _metrics         smetrics;
+
+struct _metrics {
+    char*                   buffer;
+    size_t                  length;
+    size_t                  capacity;
+
+    int                     failed;
+};
+
+void
+metrics_initialize (
+    OUT smetrics*           metrics
+);
+
+void
+metrics_cleanup (
+    BTH smetrics*           metrics
+);
+
+rmetrics
+metrics_state (
+    IN  smetrics*           metrics
+);
+
+void
+metrics_printf (
+    BTH smetrics*           metrics,
+    IN  const char*         format,
+        ...
+) __attribute__((format(printf, 2, 3)));
+
+//type: "counter", "gauge" or "histogram"
+void
+metrics_family (
+    BTH smetrics*           metrics,
+    IN  const char*         name,
+    IN  const char*         type,
+    IN  const char*         help
+);
+
+#endif
@@ -22,6 +22,7 @@ poll_create (
         return rpoll_failed;
     }
 
+    poll_guard_set(poll, NULL, NULL, NULL);
     return rpoll_ok;
 }
 
@@ -151,10 +152,21 @@ poll_wait (
         return rpoll_failed;
     }
 
+    rpoll _return = rpoll_ok;
+
+    if NOT_NULL_IS(poll->lock)
+        poll->lock(poll->guard);
+
     for (size_t _i = 0; _i < (unsigned)_r_epoll; ++_i) {
         spollable* _pollable = (spollable*)thread->events[_i].data.ptr;
         uint32_t   _flags    = 0;
 
+        //pollable may be stopped by previous handler [or other thread] after epoll_wait returned
+        if SOCKET_INVALID_IS(pollable_socket(_pollable)) {
+            LOG(debug, "stale event for %p ignored", _pollable);
+            continue;
+        }
+
         if (thread->events[_i].events & EPOLLIN )
             _flags |= FPOLLABLE_IN;
 
@@ -175,9 +187,15 @@ poll_wait (
 
             case rpoll_handler_failed:
                 LOG(error, "handler raise error");
-                return rpoll_failed;
+                _return = rpoll_failed;
+                break;
         }
+
+        break;
     }
 
-    return rpoll_ok;
+    if NOT_NULL_IS(poll->unlock)
+        poll->unlock(poll->guard);
+
+    return _return;
 }
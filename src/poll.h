@@ -49,8 +49,18 @@ struct _pollable {
     spoll*                  poll;
 };
 
+typedef
+void (*fpoll_guard) (
+        void*               context
+);
+
 struct _poll {
     socket_t                epoll;
+
+    //optional, held while handlers are dispatched
+    fpoll_guard             lock;
+    fpoll_guard             unlock;
+    void*                   guard;
 };
 
 struct _poll_thread {
@@ -130,6 +140,18 @@ poll_create (
     OUT spoll*              poll
 );
 
+static inline void
+poll_guard_set (
+    BTH spoll*              poll,
+        fpoll_guard         lock,
+        fpoll_guard         unlock,
+        void*               context
+) {
+    poll->lock   = lock;
+    poll->unlock = unlock;
+    poll->guard  = context;
+}
+
 rpoll
 poll_destroy (
     BTH spoll*              poll
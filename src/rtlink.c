@@ -14,6 +14,8 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
 
 //netlink
 #include <asm/types.h>
@@ -141,6 +143,9 @@ _rtlink_device_lazy_lookup (
     _rtdev->touched = 0;
     _rtdev->mtu     = ipv4_unknown_mtu();
 
+    _rtdev->link_type   = ARPHRD_VOID;
+    _rtdev->link_length = 0;
+
     list_initialize(&(_rtdev->listeners));
     list_initialize(&(_rtdev->addresses));
 
@@ -203,13 +208,23 @@ _rtlink_device_addresses_cleanup (
 
 //--------------------------------------------- 
 
+static inline void
+_rtlink_device_listeners_notify (
+    BTH srtlink_device*                 device,
+        uint32_t                        flags
+) {
+    LIST_FOREACH_SAFE(_listener, srtlink_listener, entry, &(device->listeners))
+        _listener->callback(_listener, flags);
+}
+
 static rnetlink
 _rtlink_device_notify (
     BTH srtlink_device*                 device,
         ertlink_state                   state,
-        device_index_t                  index
+        device_index_t                  index,
+        uint32_t                        flags
 ) {
-    uint32_t _flags = 0;
+    uint32_t _flags = flags;
 
     _flags |= (state != device->state)?FRTLINK_NOTIFY_STATE:0;
     _flags |= (index != device->index)?FRTLINK_NOTIFY_INDEX:0;
@@ -231,14 +246,20 @@ _rtlink_device_notify (
         //if device's index changed, we mainway lose all it addresses
         //but we ignore change if relaxed change occured
         if (0 == (_flags & FRTLINK_NOTIFY_INDEX_RELAXED))
-            _rtlink_device_addresses_cleanup(device);
+            if LIST_NOT_EMPTY(&(device->addresses)) {
+                _rtlink_device_addresses_cleanup(device);
+                _flags |= FRTLINK_NOTIFY_ADDRESS;
+            }
     }
 
     switch (state) {
         case ertlink_state_removed:
             LOG(verbose, "...removed");
 
-            _rtlink_device_addresses_cleanup(device);
+            if LIST_NOT_EMPTY(&(device->addresses)) {
+                _rtlink_device_addresses_cleanup(device);
+                _flags |= FRTLINK_NOTIFY_ADDRESS;
+            }
 
             if LIST_EMPTY(&(device->listeners))
                 return _rtlink_device_remove(device);
@@ -272,9 +293,7 @@ _rtlink_device_notify (
             return rnetlink_failed;
     }
 
-    LIST_FOREACH_SAFE(_listener, srtlink_listener, entry, &(device->listeners))
-        _listener->callback(_listener, _flags);
-
+    _rtlink_device_listeners_notify(device, _flags);
     return rnetlink_ok;
 }
 
@@ -378,6 +397,7 @@ _rtlink_handler_msg_addr (
             }
 
             _rtlink_device_address_free(_address);
+            _rtlink_device_listeners_notify(_rtdev, FRTLINK_NOTIFY_ADDRESS);
             return rnetlink_ok;
 
         case RTM_NEWADDR:
@@ -394,6 +414,11 @@ _rtlink_handler_msg_addr (
 
                 list_entry_initialize(&(_address->entry));
                 list_append(&(_rtdev->addresses), &(_address->entry));
+
+                _address->touched = rtlink->touched;
+
+                _rtlink_device_listeners_notify(_rtdev, FRTLINK_NOTIFY_ADDRESS);
+                return rnetlink_ok;
             }
 
             _address->touched = rtlink->touched;
@@ -406,12 +431,19 @@ _rtlink_handler_msg_addr (
 #define _FMSG_LINK_DATA_RESOLVED_IFNAME     (1)
 #define _FMSG_LINK_DATA_RESOLVED_MTU        (2)
 
+typedef
+struct {
+    uint8_t                         length;     //0 - device has no hardware address
+    ubyte_t                         address[RTLINK_LINK_ADDRESS_LENGTH];
+} _srtlink_link_address;
+
 static rnetlink
 _rtlink_handler_msg_link_data (
     BTH struct ifinfomsg*           info,
     BTH struct nlmsghdr*            hdr,
     OUT char*                       ifname,
-    OUT device_mtu_t*               mtu
+    OUT device_mtu_t*               mtu,
+    OUT _srtlink_link_address*      link
 ) {
     uint32_t _resolved  = 0;
     size_t   _length    = (hdr->nlmsg_len - NLMSG_LENGTH(sizeof(*info)));
@@ -435,6 +467,16 @@ _rtlink_handler_msg_link_data (
 
                 (*mtu) = *((unsigned int*)RTA_DATA(_attr));
                 break;
+
+            case IFLA_ADDRESS:
+                if (RTLINK_LINK_ADDRESS_LENGTH < RTA_PAYLOAD(_attr)) {
+                    LOG(debug, "... hardware address is too long [%lu], ignored", (unsigned long)RTA_PAYLOAD(_attr));
+                    break;
+                }
+
+                link->length = (uint8_t)RTA_PAYLOAD(_attr);
+                memcpy(link->address, RTA_DATA(_attr), link->length);
+                break;
         }
 
     if (0 == (_resolved & _FMSG_LINK_DATA_RESOLVED_IFNAME))
@@ -453,7 +495,8 @@ _rtlink_device_touch (
     BTH srtlink*                    rtlink,
         char*                       device,
         struct ifinfomsg*           info,
-        device_mtu_t                mtu
+        device_mtu_t                mtu,
+    IN  const _srtlink_link_address*    link
 ) {
     if (0 == (IFF_LOWER_UP & info->ifi_flags))
         info->ifi_flags &= (~(IFF_UP | IFF_RUNNING));
@@ -466,10 +509,23 @@ _rtlink_device_touch (
         return rnetlink_failed;
     }
 
+    uint32_t _flags = (mtu != _rtdev->mtu)?FRTLINK_NOTIFY_MTU:0;
+
+    if ((info->ifi_type != _rtdev->link_type) || (link->length != _rtdev->link_length) || (0 != memcmp(link->address, _rtdev->link_address, link->length))) {
+        LOG(verbose, "device %-5d [%-16s] hardware address changed [type %u, %u bytes]", info->ifi_index, device, (unsigned)info->ifi_type, (unsigned)link->length);
+
+        _flags |= FRTLINK_NOTIFY_LINK;
+
+        _rtdev->link_type   = info->ifi_type;
+        _rtdev->link_length = link->length;
+
+        memcpy(_rtdev->link_address, link->address, link->length);
+    }
+
     _rtdev->mtu     = mtu;
     _rtdev->touched = rtlink->touched;
 
-    return _rtlink_device_notify(_rtdev, _state, info->ifi_index);
+    return _rtlink_device_notify(_rtdev, _state, info->ifi_index, _flags);
 }
 
 static inline void
@@ -511,12 +567,14 @@ _rtlink_handler_msg_link (
 ) {
     struct ifinfomsg* _info = (struct ifinfomsg*)NLMSG_DATA(hdr);
 
-    device_mtu_t _device_mtu = 0;
-    char         _device[IFNAMSIZ + 1];
+    device_mtu_t          _device_mtu = 0;
+    char                  _device[IFNAMSIZ + 1];
+    _srtlink_link_address _link;
 
     memset(_device, 0, sizeof(_device));
+    memset(&_link,  0, sizeof(_link));
 
-    if (rnetlink_ok != _rtlink_handler_msg_link_data(_info, hdr, _device, &_device_mtu)) {
+    if (rnetlink_ok != _rtlink_handler_msg_link_data(_info, hdr, _device, &_device_mtu, &_link)) {
         LOG(error, "can't resolve device (idx: %d) name, ignoring", _info->ifi_index);
         return rnetlink_failed;
     }
@@ -536,18 +594,18 @@ _rtlink_handler_msg_link (
             srtlink_device* _rtdev = CONTAINEROF(hashmap_cursor(&_cursor), srtlink_device, hash);
 
             _rtdev->touched = rtlink->touched;
-            return _rtlink_device_notify(_rtdev, ertlink_state_removed, RTLINK_DEVICE_IDX_INVALID);
+            return _rtlink_device_notify(_rtdev, ertlink_state_removed, RTLINK_DEVICE_IDX_INVALID, 0);
         }
 
         case RTM_NEWLINK:
             switch ((ertlink_sequence)(hdr->nlmsg_seq)) {
                 case SEQ_BROADCAST:
                     _rtlink_handler_msg_link_dump(_info, _device, "changed");
-                    return _rtlink_device_touch(rtlink, _device, _info, _device_mtu);
+                    return _rtlink_device_touch(rtlink, _device, _info, _device_mtu, &_link);
 
                 case SEQ_RELOAD_LINK: 
                     LOG(verbose, "device %-5d [%-16s] is reported", _info->ifi_index, _device);
-                    return _rtlink_device_touch(rtlink, _device, _info, _device_mtu);
+                    return _rtlink_device_touch(rtlink, _device, _info, _device_mtu, &_link);
 
                 case SEQ_RELOAD_ADDR:
                     LOG(error, "unexcepted sequence number in handler!");
@@ -583,16 +641,23 @@ _rtlink_handler_msg_done (
                     //device doen't exists in reloading, set it to removed state
 
                     _device->touched = rtlink->touched;
-                    _rtlink_device_notify(_device, ertlink_state_removed, RTLINK_DEVICE_IDX_INVALID);
+                    _rtlink_device_notify(_device, ertlink_state_removed, RTLINK_DEVICE_IDX_INVALID, 0);
 
                     continue;
                 }
 
                 //device exists, check it's addresses
+                size_t _removed = 0;
+
                 LIST_FOREACH_SAFE(_address, srtlink_device_address, entry, &(_device->addresses)) {            
-                    if (_address->touched != rtlink->touched)
+                    if (_address->touched != rtlink->touched) {
                         _rtlink_device_address_free(_address);
+                        _removed++;
+                    }
                 }
+
+                if (0 < _removed)
+                    _rtlink_device_listeners_notify(_device, FRTLINK_NOTIFY_ADDRESS);
             }
 
             LOG(verbose, "...done");
@@ -638,10 +703,13 @@ _rtlink_handler (
 
         if (passthrou->length < (unsigned)_r_recvmsg) {
             LOG(warning, "truncation occured, please increase buffer size to %d [at least]", _r_recvmsg);
+            _rtlink->statistics.truncated++;
             return rpoll_handler_ok;
         }
 
-        for (struct nlmsghdr* _h = (struct nlmsghdr*)passthrou->buffer; NLMSG_OK(_h, (unsigned)_r_recvmsg); _h = NLMSG_NEXT(_h, _r_recvmsg))
+        for (struct nlmsghdr* _h = (struct nlmsghdr*)passthrou->buffer; NLMSG_OK(_h, (unsigned)_r_recvmsg); _h = NLMSG_NEXT(_h, _r_recvmsg)) {
+            _rtlink->statistics.messages++;
+
             switch (_h->nlmsg_type) {
                 case RTM_DELLINK:
                 case RTM_NEWLINK:
@@ -660,14 +728,17 @@ _rtlink_handler (
                 case NLMSG_ERROR: {
                     struct nlmsgerr* _error = (struct nlmsgerr*)NLMSG_DATA(_h);
                     LOG(error, "netlink error received: %d", _error->error);
+                    _rtlink->statistics.errors++;
                     //TODO: restart netlink rtlink
                     break;
                 }
 
                 default:
                     LOG(warning, "unknown message type: %d", _h->nlmsg_type);
+                    _rtlink->statistics.errors++;
                     //TODO: restart netlink rtlink
             }
+        }
     }
 
     LOG(verbose, "%p events per tick limit exceeded", _rtlink);
@@ -749,9 +820,11 @@ rtlink_reload (
 ) {
     if (((rtlink->touched)++) != (rtlink->touched_done)) {
         LOG(error, "last reload freeze, restarting rtlink");
-        
+        rtlink->statistics.freezes++;
     }
 
+    rtlink->statistics.reloads++;
+
     return _rtlink_reload_send(rtlink, RTM_GETLINK, SEQ_RELOAD_LINK);
 }
 
@@ -788,6 +861,8 @@ rtlink_create (
     rtlink->touched         = 0;
     rtlink->touched_done    = 0;
 
+    memset(&(rtlink->statistics), 0, sizeof(rtlink->statistics));
+
     return rnetlink_ok;
 
     _failed_hashmap:
@@ -797,6 +872,46 @@ rtlink_create (
         return rnetlink_failed;
 }
 
+void
+rtlink_metrics (
+    IN  srtlink*                    rtlink,
+    BTH smetrics*                   metrics
+) {
+    static const struct {
+        const char*     name;
+        const char*     help;
+        size_t          offset;
+    } _counters[] = {
+            { "bproxy_rtlink_messages_total",   "Netlink messages received",                    offsetof(srtlink, statistics.messages)  }
+        ,   { "bproxy_rtlink_errors_total",     "Netlink errors and unknown messages",          offsetof(srtlink, statistics.errors)    }
+        ,   { "bproxy_rtlink_truncated_total",  "Netlink datagrams truncated by buffer size",   offsetof(srtlink, statistics.truncated) }
+        ,   { "bproxy_rtlink_reloads_total",    "Devices & addresses reloads requested",        offsetof(srtlink, statistics.reloads)   }
+        ,   { "bproxy_rtlink_freezes_total",    "Reloads requested before previous one done",   offsetof(srtlink, statistics.freezes)   }
+    };
+
+    for (size_t _i = 0; _i < (sizeof(_counters) / sizeof(_counters[0])); ++_i) {
+        metrics_family(metrics, _counters[_i].name, "counter", _counters[_i].help);
+        metrics_printf(metrics, "%s %"PRIu64"\n", _counters[_i].name, *((const uint64_t*)((const ubyte_t*)rtlink + _counters[_i].offset)));
+    }
+
+    //series of family must be grouped
+    metrics_family(metrics, "bproxy_rtlink_device_up", "gauge", "Device is up");
+
+    LIST_FOREACH(_device, srtlink_device, entry, &(rtlink->devices))
+        metrics_printf(metrics, "bproxy_rtlink_device_up{device=\"%s\"} %d\n", _device->name, (ertlink_state_up == _device->state)?1:0);
+
+    metrics_family(metrics, "bproxy_rtlink_device_addresses", "gauge", "IPv4 addresses of device");
+
+    LIST_FOREACH(_device, srtlink_device, entry, &(rtlink->devices)) {
+        size_t _addresses = 0;
+
+        LIST_FOREACH(_address, srtlink_device_address, entry, &(_device->addresses))
+            _addresses++;
+
+        metrics_printf(metrics, "bproxy_rtlink_device_addresses{device=\"%s\"} %lu\n", _device->name, (unsigned long)_addresses);
+    }
+}
+
 rnetlink
 rtlink_destroy (
     BTH srtlink*                    rtlink
@@ -11,6 +11,10 @@
 #include "hashmap.h"
 #include "list.h"
 #include "ipv4.h"
+#include "metrics.h"
+
+#include <net/if_arp.h>
+#include <net/ethernet.h>
 
 typedef
 enum {
@@ -35,6 +39,11 @@ struct _rtlink_listener srtlink_listener;
 #define FRTLINK_NOTIFY_INDEX_RELAXED    (2) //index changed from RTLINK_DEVICE_IDX_INVALID
 
 #define FRTLINK_NOTIFY_STATE            (5)
+#define FRTLINK_NOTIFY_ADDRESS          (8)  //device's address list changed
+#define FRTLINK_NOTIFY_MTU              (16)
+#define FRTLINK_NOTIFY_LINK             (32) //device's hardware address changed
+
+#define RTLINK_LINK_ADDRESS_LENGTH      (8)  //sockaddr_ll's one, longer addresses aren't kept
 
 typedef
 void (*frtlink_notify) (
@@ -51,6 +60,14 @@ struct _rtlink {
 
     size_t                                  touched;
     size_t                                  touched_done;
+
+    struct {
+        uint64_t                                messages;
+        uint64_t                                errors;     //netlink errors & unknown messages
+        uint64_t                                truncated;
+        uint64_t                                reloads;
+        uint64_t                                freezes;    //reload requested before previous one done
+    } statistics;
 } srtlink;
 
 typedef
@@ -73,6 +90,10 @@ struct _rtlink_device {
     device_index_t                          index;
     device_mtu_t                            mtu;
 
+    uint16_t                                link_type;      //ARPHRD_xxx
+    uint8_t                                 link_length;    //0 - unknown
+    ubyte_t                                 link_address[RTLINK_LINK_ADDRESS_LENGTH];
+
     size_t                                  touched;
 
     slist                                   listeners;
@@ -142,6 +163,22 @@ rtlink_listener_mtu (
     return _device->mtu;
 }
 
+//ethernet address of device, NULL - unknown or device isn't ethernet
+static inline const ubyte_t*
+rtlink_listener_ethernet (
+    IN  srtlink_listener*                   listener
+) {
+    srtlink_device* _device = rtlink_listener_device(listener);
+
+    if NULL_IS(_device)
+        return NULL;
+
+    if ((ARPHRD_ETHER != _device->link_type) || (ETHER_ADDR_LEN != _device->link_length))
+        return NULL;
+
+    return _device->link_address;
+}
+
 static inline srtlink_device_address*
 rtlink_listener_address (
     IN  srtlink_listener*                   listener
@@ -193,6 +230,13 @@ rtlink_reload (
     BTH srtlink*                            rtlink
 );
 
+//appends rtlink counters & devices in prometheus text format
+void
+rtlink_metrics (
+    IN  srtlink*                            rtlink,
+    BTH smetrics*                           metrics
+);
+
 rnetlink
 rtlink_destroy (
     BTH srtlink*                            rtlink
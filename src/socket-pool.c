@@ -0,0 +1,270 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "socket-pool.h"
+
+#include "utils.h"
+#include "log.h"
+
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+LOG_MODULE("socket-pool");
+
+typedef
+struct _socket_pool_entry   ssocket_pool_entry;
+
+struct _socket_pool_entry {
+    uint32_t                flags;
+    device_index_t          index;
+    fwmark_t                fwmark;
+    char                    device[IFNAMSIZ];
+
+    int                     bound;      //udp socket
+    sipv4_destination       binding;
+
+    socket_t                socket;
+    size_t                  references;
+
+    ssocket_pool_entry*     next;
+};
+
+static struct {
+    pthread_mutex_t         guard;
+    ssocket_pool_entry*     entries;
+} gsocket_pool = {
+        PTHREAD_MUTEX_INITIALIZER
+    ,   NULL
+};
+
+static socket_t
+_socket_pool_open (
+        uint32_t                flags,
+    IN  const char*             device,
+        fwmark_t                fwmark,
+    IN  const sipv4_destination*    binding
+) {
+    socket_t _socket = SOCKET_INVALID;
+
+    if NOT_NULL_IS(binding) {
+        struct sockaddr_in _address;
+
+        memset(&_address, 0, sizeof(_address));
+
+        _address.sin_family      = AF_INET;
+        _address.sin_addr.s_addr = binding->address;
+        _address.sin_port        = binding->port;
+
+        _socket = socket_open(flags, (struct sockaddr*)&_address, device);
+
+    } else {
+        _socket = socket_raw(flags, device);
+    }
+
+    if SOCKET_INVALID_IS(_socket)
+        return SOCKET_INVALID;
+
+    if (0 != fwmark)
+        if (rsocket_ok != socket_fwmark_set(_socket, fwmark))
+            goto _failed_close;
+
+    if (rsocket_ok != socket_receive_discard(_socket))
+        goto _failed_close;
+
+    return _socket;
+
+    _failed_close:
+        socket_close(_socket);
+        return SOCKET_INVALID;
+}
+
+socket_t
+socket_pool_acquire (
+        uint32_t                flags,
+    IN  const char*             device,
+        device_index_t          index,
+        fwmark_t                fwmark,
+    IN  const sipv4_destination*    binding
+) {
+    char              _device[IFNAMSIZ];
+    sipv4_destination _binding;
+
+    memset(_device,   0, sizeof(_device));
+    memset(&_binding, 0, sizeof(_binding));
+
+    if NOT_NULL_IS(device)
+        strcpy_l(_device, device, IFNAMSIZ);
+
+    if NOT_NULL_IS(binding) {
+        _binding.address = binding->address;
+        _binding.port    = binding->port;
+    }
+
+    socket_t _socket = SOCKET_INVALID;
+
+    pthread_mutex_lock(&(gsocket_pool.guard));
+
+    for (ssocket_pool_entry* _entry = gsocket_pool.entries; NULL != _entry; _entry = _entry->next)
+        if ((flags == _entry->flags) && (index == _entry->index) && (fwmark == _entry->fwmark) && (0 == strncmp(_device, _entry->device, IFNAMSIZ)))
+            if ((NOT_NULL_IS(binding) == _entry->bound) && (_binding.address == _entry->binding.address) && (_binding.port == _entry->binding.port)) {
+                _entry->references++;
+                _socket = _entry->socket;
+
+                goto _done;
+            }
+
+    ssocket_pool_entry* _entry = (ssocket_pool_entry*)malloc(sizeof(ssocket_pool_entry));
+
+    if NULL_IS(_entry) {
+        LOG(critical, "out of memory: socket pool entry [%lu]", (unsigned long)sizeof(ssocket_pool_entry));
+        goto _done;
+    }
+
+    if SOCKET_INVALID_IS(_entry->socket = _socket_pool_open(flags, device, fwmark, binding)) {
+        free(_entry);
+        goto _done;
+    }
+
+    _entry->flags       = flags;
+    _entry->index       = index;
+    _entry->fwmark      = fwmark;
+    _entry->references  = 1;
+    _entry->bound       = NOT_NULL_IS(binding);
+
+    memcpy(_entry->device,   _device,   IFNAMSIZ);
+    memcpy(&(_entry->binding), &_binding, sizeof(_binding));
+
+    _entry->next = gsocket_pool.entries;
+    gsocket_pool.entries = _entry;
+
+    _socket = _entry->socket;
+
+    LOG(verbose, "%s socket %d opened [device %s, index %d, mark %"PRIu32"]", _entry->bound?"udp":"raw", _socket, ('\0' != _device[0])?_device:"-", (int)index, fwmark);
+
+    _done:
+        pthread_mutex_unlock(&(gsocket_pool.guard));
+        return _socket;
+}
+
+void
+socket_pool_release (
+        socket_t                socket
+) {
+    pthread_mutex_lock(&(gsocket_pool.guard));
+
+    for (ssocket_pool_entry** _p = &(gsocket_pool.entries); NULL != (*_p); _p = &((*_p)->next)) {
+        ssocket_pool_entry* _entry = (*_p);
+
+        if (socket != _entry->socket)
+            continue;
+
+        if (0 == --(_entry->references)) {
+            (*_p) = _entry->next;
+
+            LOG(verbose, "socket %d closed", socket);
+
+            socket_close(_entry->socket);
+            free(_entry);
+        }
+
+        pthread_mutex_unlock(&(gsocket_pool.guard));
+        return;
+    }
+
+    pthread_mutex_unlock(&(gsocket_pool.guard));
+
+    LOG(error, "socket %d isn't pooled, closing it anyway", socket);
+    socket_close(socket);
+}
+
+void
+socket_pool_statistics (
+) {
+    size_t   _sockets = 0;
+    uint64_t _memory  = 0;
+
+    pthread_mutex_lock(&(gsocket_pool.guard));
+
+    for (ssocket_pool_entry* _entry = gsocket_pool.entries; NULL != _entry; _entry = _entry->next) {
+        uint32_t _allocated = 0;
+
+        if (rsocket_ok == socket_receive_memory(_entry->socket, &_allocated))
+            _memory += _allocated;
+
+        _sockets++;
+    }
+
+    pthread_mutex_unlock(&(gsocket_pool.guard));
+
+    LOG(information, "raw sockets: %lu, receive memory %"PRIu64" bytes", (unsigned long)_sockets, _memory);
+}
+
+//same labels of receive memory series
+static int
+_socket_pool_same_series (
+    IN  const ssocket_pool_entry*   entry,
+    IN  const ssocket_pool_entry*   other
+) {
+    return (entry->index == other->index) && (entry->fwmark == other->fwmark) && (entry->bound == other->bound)
+        && (entry->binding.address == other->binding.address) && (entry->binding.port == other->binding.port)
+        && (0 == strncmp(entry->device, other->device, IFNAMSIZ));
+}
+
+void
+socket_pool_metrics (
+    BTH smetrics*               metrics
+) {
+    pthread_mutex_lock(&(gsocket_pool.guard));
+
+    size_t _sockets = 0;
+
+    for (ssocket_pool_entry* _entry = gsocket_pool.entries; NULL != _entry; _entry = _entry->next)
+        _sockets++;
+
+    metrics_family(metrics, "bproxy_raw_sockets", "gauge", "Raw [and udp transport] sockets shared by sinks");
+    metrics_printf(metrics, "bproxy_raw_sockets %lu\n", (unsigned long)_sockets);
+
+    metrics_family(metrics, "bproxy_raw_socket_receive_bytes", "gauge", "Receive memory charged to sinks' raw [or udp] socket [SO_MEMINFO], 0 while discard works");
+
+    //entries which differ by flags only are one series
+    for (ssocket_pool_entry* _entry = gsocket_pool.entries; NULL != _entry; _entry = _entry->next) {
+        int _printed = 0;
+
+        for (ssocket_pool_entry* _other = gsocket_pool.entries; (_other != _entry) && (0 == _printed); _other = _other->next)
+            _printed = _socket_pool_same_series(_entry, _other);
+
+        if (0 != _printed)
+            continue;
+
+        uint64_t _memory = 0;
+        int      _known  = 0;
+
+        for (ssocket_pool_entry* _other = _entry; NULL != _other; _other = _other->next) {
+            uint32_t _allocated = 0;
+
+            if (0 == _socket_pool_same_series(_entry, _other))
+                continue;
+
+            if (rsocket_ok != socket_receive_memory(_other->socket, &_allocated))
+                continue;
+
+            _memory += _allocated;
+            _known   = 1;
+        }
+
+        if (0 == _known)
+            continue;
+
+        const ubyte_t* _address = (const ubyte_t*)&(_entry->binding.address);
+
+        metrics_printf(metrics, "bproxy_raw_socket_receive_bytes{device=\"%s\",index=\"%d\",mark=\"%"PRIu32"\",kind=\"%s\",binding=\""IPV4_PRIADDR":%u\"} %"PRIu64"\n"
+            ,   ('\0' != _entry->device[0])?_entry->device:"-", (int)_entry->index, _entry->fwmark, _entry->bound?"udp":"raw"
+            ,   _address[0], _address[1], _address[2], _address[3], (unsigned int)ntohs(_entry->binding.port), _memory
+        );
+    }
+
+    pthread_mutex_unlock(&(gsocket_pool.guard));
+}
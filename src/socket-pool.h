@@ -0,0 +1,56 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_SOCKET_POOL)
+#define BPROXY_SOCKET_POOL
+
+#include "bproxy.h"
+#include "socket.h"
+#include "metrics.h"
+
+/** KIM: raw socket pool
+        sinks send prebuilt ip datagrams [hdrincl], so any raw socket bound to
+        the same device with the same flags & mark does. pool shares them by
+        reference count, key has device's index too: re-created device gets
+        fresh socket, while sinks still holding old one release it on their
+        rtlink notification.
+
+        udp sockets [sinks with udp transport] are pooled the same way, their
+        key has binding [from address & port] too.
+
+        pooled sockets are never read, but raw udp socket gets a copy of every
+        inbound udp datagram [and bound udp socket gets datagrams to its port],
+        so they discard everything on receive.
+
+        sinks are started by workers [lanes], so pool is guarded
+**/
+
+//device may be NULL [routed by table], fwmark 0 - not marked, binding NULL - raw socket
+socket_t
+socket_pool_acquire (
+        uint32_t                flags,
+    IN  const char*             device,
+        device_index_t          index,
+        fwmark_t                fwmark,
+    IN  const sipv4_destination*    binding
+);
+
+void
+socket_pool_release (
+        socket_t                socket
+);
+
+//logs pooled sockets and receive memory charged to them [must stay 0]
+void
+socket_pool_statistics (
+);
+
+//appends the same in prometheus text format
+void
+socket_pool_metrics (
+    BTH smetrics*               metrics
+);
+
+#endif
@@ -13,6 +13,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <linux/filter.h>
+#include <linux/sock_diag.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <sys/mman.h>
 
 #if     !defined(IP_TRANSPARENT)
     #warning hardcoded value used [IP_TRANSPARENT]
@@ -29,6 +34,16 @@
     #define IP_RECVORIGDSTADDR  (IP_ORIGDSTADDR)
 #endif
 
+#if     !defined(SO_MEMINFO)
+    #warning hardcoded value used [SO_MEMINFO]
+    #define SO_MEMINFO          (55)
+#endif
+
+#if     !defined(SO_ATTACH_REUSEPORT_CBPF)
+    #warning hardcoded value used [SO_ATTACH_REUSEPORT_CBPF]
+    #define SO_ATTACH_REUSEPORT_CBPF    (51)
+#endif
+
 LOG_MODULE("socket");
 
 #define __SOCKOPT(t, f, x, y, z, s, n, o)                                                               \
@@ -43,6 +58,10 @@ LOG_MODULE("socket");
 #define _SOCKOPT(x, y, z, s)    \
     __SOCKOPT(socket, return rsocket_failed, x, y, z, s, #x, #y)
 
+//for socket being opened, failure jumps to label
+#define SOCKOPT_FAILED(x, y, z, l)  \
+    __SOCKOPT(_socket, goto l, x, y, &z, sizeof(z), #x, #y)
+
 #define SOCKFLG(x) \
     ( (0 != (flags & (FSOCKET_##x))) )
 
@@ -108,6 +127,9 @@ _socket_flags (
     if SOCKFLG(REUSEADDR)
         SOCKOPT(SOL_SOCKET, SO_REUSEADDR,       _enable);
 
+    if SOCKFLG(REUSEPORT)
+        SOCKOPT(SOL_SOCKET, SO_REUSEPORT,       _enable);
+
     if SOCKFLG(DONTROUTE)
         SOCKOPT(SOL_SOCKET, SO_DONTROUTE,       _enable);
 
@@ -120,6 +142,19 @@ _socket_flags (
     if SOCKFLG(RECVOPTIONS)
         SOCKOPT(SOL_IP,     IP_RECVOPTS,        _enable);
 
+    if SOCKFLG(TIMESTAMP)
+        SOCKOPT(SOL_SOCKET, SO_TIMESTAMPNS,     _enable);
+
+    //older kernel just delivers datagrams one by one, so it isn't failure
+    if SOCKFLG(GRO)
+        if (0 > setsockopt(socket, SOL_UDP, UDP_GRO, &_enable, sizeof(_enable)))
+            LOG(warning, "can't enable UDP_GRO, cuz' %d [%s]", errno, strerror(errno));
+
+    if SOCKFLG(DONTFRAGMENT) {
+        int _discover = IP_PMTUDISC_DO;
+        SOCKOPT(SOL_IP,     IP_MTU_DISCOVER,    _discover);
+    }
+
     return rsocket_ok;
 }
 
@@ -164,6 +199,209 @@ socket_raw (
         return SOCKET_INVALID;
 }
 
+socket_t
+socket_packet (
+        size_t                  blocks,
+        size_t                  block_size,
+        uint32_t                retire,
+    OUT ssocket_ring*           ring
+) {
+    memset(ring, 0, sizeof(*ring));
+
+    socket_t _socket = socket(AF_PACKET, SOCK_DGRAM, 0);
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(error, "can't open packet socket, cuz' %d [%s]", errno, strerror(errno));
+        goto _failure;
+    }
+
+    int _version = TPACKET_V3;
+    SOCKOPT_FAILED(SOL_PACKET, PACKET_VERSION, _version, _failure_close);
+
+    struct tpacket_req3 _request;
+
+    memset(&_request, 0, sizeof(_request));
+
+    _request.tp_block_size          = (unsigned int)block_size;
+    _request.tp_block_nr            = (unsigned int)blocks;
+    _request.tp_frame_size          = TPACKET_ALIGNMENT << 7;   //v3 frames are variable, it only must divide block
+    _request.tp_frame_nr            = (unsigned int)((block_size / _request.tp_frame_size) * blocks);
+    _request.tp_retire_blk_tov      = retire;
+    _request.tp_feature_req_word    = 0;
+
+    SOCKOPT_FAILED(SOL_PACKET, PACKET_RX_RING, _request, _failure_close);
+
+    ring->size = (blocks * block_size);
+    ring->map  = (ubyte_t*)mmap(NULL, ring->size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_LOCKED | MAP_POPULATE), _socket, 0);
+
+    //locked memory may be limited [RLIMIT_MEMLOCK], ring works without it
+    if (MAP_FAILED == ring->map)
+        ring->map = (ubyte_t*)mmap(NULL, ring->size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), _socket, 0);
+
+    if (MAP_FAILED == ring->map) {
+        LOG(error, "can't map packet ring [%lu bytes], cuz' %d [%s]", (unsigned long)ring->size, errno, strerror(errno));
+
+        ring->map = NULL;
+        goto _failure_close;
+    }
+
+    ring->blocks     = blocks;
+    ring->block_size = block_size;
+    ring->current    = 0;
+
+    return _socket;
+
+    _failure_close:
+        close(_socket);
+
+    _failure:
+        return SOCKET_INVALID;
+}
+
+socket_t
+socket_packet_tx (
+        size_t                  frames,
+        size_t                  frame_size,
+    OUT ssocket_ring*           ring
+) {
+    memset(ring, 0, sizeof(*ring));
+
+    socket_t _socket = socket(AF_PACKET, SOCK_RAW, 0);
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(error, "can't open packet socket, cuz' %d [%s]", errno, strerror(errno));
+        goto _failure;
+    }
+
+    int _version = TPACKET_V2;
+    SOCKOPT_FAILED(SOL_PACKET, PACKET_VERSION, _version, _failure_close);
+
+    //malformed frame is skipped instead of stalling the ring
+    int _loss = 1;
+    SOCKOPT_FAILED(SOL_PACKET, PACKET_LOSS, _loss, _failure_close);
+
+    //block must be page multiple, frames don't cross blocks
+    size_t _page  = (size_t)sysconf(_SC_PAGESIZE);
+    size_t _block = (frame_size > _page)?frame_size:_page;
+
+    if (frames < (_block / frame_size))
+        frames = (_block / frame_size);
+
+    struct tpacket_req _request;
+
+    memset(&_request, 0, sizeof(_request));
+
+    _request.tp_block_size  = (unsigned int)_block;
+    _request.tp_block_nr    = (unsigned int)((frames * frame_size) / _block);
+    _request.tp_frame_size  = (unsigned int)frame_size;
+    _request.tp_frame_nr    = (unsigned int)(_request.tp_block_nr * (_block / frame_size));
+
+    SOCKOPT_FAILED(SOL_PACKET, PACKET_TX_RING, _request, _failure_close);
+
+    ring->size = ((size_t)_request.tp_block_nr * _block);
+    ring->map  = (ubyte_t*)mmap(NULL, ring->size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_LOCKED | MAP_POPULATE), _socket, 0);
+
+    if (MAP_FAILED == ring->map)
+        ring->map = (ubyte_t*)mmap(NULL, ring->size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), _socket, 0);
+
+    if (MAP_FAILED == ring->map) {
+        LOG(error, "can't map packet ring [%lu bytes], cuz' %d [%s]", (unsigned long)ring->size, errno, strerror(errno));
+
+        ring->map = NULL;
+        goto _failure_close;
+    }
+
+    ring->blocks     = _request.tp_frame_nr;
+    ring->block_size = frame_size;
+    ring->current    = 0;
+
+    return _socket;
+
+    _failure_close:
+        close(_socket);
+
+    _failure:
+        return SOCKET_INVALID;
+}
+
+rsocket
+socket_packet_kick (
+        socket_t                socket,
+        device_index_t          index
+) {
+    struct sockaddr_ll _device;
+
+    memset(&_device, 0, sizeof(_device));
+
+    _device.sll_family   = AF_PACKET;
+    _device.sll_protocol = htons(ETH_P_IP);
+    _device.sll_ifindex  = index;
+
+    while (0 > sendto(socket, NULL, 0, MSG_DONTWAIT, (struct sockaddr*)&_device, sizeof(_device))) {
+        if EINTR_IS(errno) continue;
+
+        //frames not taken are left marked, next kick retries them
+        if (EAGAIN_IS(errno) || (ENOBUFS == errno))
+            return rsocket_ok;
+
+        LOG(error, "can't kick packet ring cuz' %d [%s]", errno, strerror(errno));
+        return rsocket_failed;
+    }
+
+    return rsocket_ok;
+}
+
+rsocket
+socket_packet_bind (
+        socket_t                socket,
+        device_index_t          index
+) {
+    struct sockaddr_ll _binding;
+
+    memset(&_binding, 0, sizeof(_binding));
+
+    _binding.sll_family   = AF_PACKET;
+    _binding.sll_protocol = htons(ETH_P_IP);
+    _binding.sll_ifindex  = index;
+
+    if (0 > bind(socket, (struct sockaddr*)&_binding, sizeof(_binding))) {
+        LOG(error, "can't bind packet socket cuz' %d [%s]", errno, strerror(errno));
+        return rsocket_failed;
+    }
+
+    return rsocket_ok;
+}
+
+void
+socket_packet_close (
+        socket_t                socket,
+    BTH ssocket_ring*           ring
+) {
+    if NOT_NULL_IS(ring->map)
+        munmap(ring->map, ring->size);
+
+    memset(ring, 0, sizeof(*ring));
+    socket_close(socket);
+}
+
+rsocket
+socket_packet_statistics (
+        socket_t                socket,
+    OUT uint32_t*               drops,
+    OUT uint32_t*               freezes
+) {
+    struct tpacket_stats_v3 _statistics;
+    socklen_t               _length = sizeof(_statistics);
+
+    if (0 > getsockopt(socket, SOL_PACKET, PACKET_STATISTICS, &_statistics, &_length))
+        return rsocket_failed;
+
+    (*drops)   = _statistics.tp_drops;
+    (*freezes) = _statistics.tp_freeze_q_cnt;
+
+    return rsocket_ok;
+}
+
 socket_t
 socket_open (
         uint32_t                flags,
@@ -184,10 +422,8 @@ socket_open (
         goto _failure_close;
 
     if NOT_NULL_IS(binding)
-        if (0 > bind(_socket, binding, sizeof(struct sockaddr))) {
-            LOG(error, "can't bind cuz' %d [%s]", errno, strerror(errno));
+        if (rsocket_ok != socket_bind(_socket, binding))
             goto _failure_close;
-        }
 
     return _socket;
 
@@ -198,6 +434,105 @@ socket_open (
         return SOCKET_INVALID;
 }
 
+rsocket
+socket_bind (
+        socket_t                socket,
+        struct sockaddr*        binding
+) {
+    if (0 > bind(socket, binding, sizeof(struct sockaddr))) {
+        LOG(error, "can't bind cuz' %d [%s]", errno, strerror(errno));
+        return rsocket_failed;
+    }
+
+    return rsocket_ok;
+}
+
+rsocket
+socket_filter_set (
+        socket_t                socket,
+    IN  const struct sock_filter*   code,
+        size_t                  length
+) {
+    struct sock_fprog _program = {
+            .len    = (unsigned short)length
+        ,   .filter = (struct sock_filter*)code
+    };
+
+    _SOCKOPT(SOL_SOCKET, SO_ATTACH_FILTER, &_program, sizeof(_program));
+    return rsocket_ok;
+}
+
+rsocket
+socket_receive_discard (
+        socket_t                socket
+) {
+    struct sock_filter _code[] = {
+            BPF_STMT(BPF_RET | BPF_K, 0)
+    };
+
+    if (rsocket_ok != socket_filter_set(socket, _code, sizeof(_code) / sizeof(_code[0])))
+        return rsocket_failed;
+
+    //kernel clamps it to its minimum
+    int _size = 0;
+
+    SOCKOPT(SOL_SOCKET, SO_RCVBUF, _size);
+    return rsocket_ok;
+}
+
+rsocket
+socket_udp_segment_probe (
+        socket_t                socket
+) {
+    int       _size   = 0;
+    socklen_t _length = sizeof(_size);
+
+    if (0 > getsockopt(socket, SOL_UDP, UDP_SEGMENT, &_size, &_length))
+        return rsocket_failed;
+
+    return rsocket_ok;
+}
+
+rsocket
+socket_receive_memory (
+        socket_t                socket,
+    OUT uint32_t*               allocated
+) {
+    uint32_t  _meminfo[SK_MEMINFO_VARS];
+    socklen_t _length = sizeof(_meminfo);
+
+    memset(_meminfo, 0, sizeof(_meminfo));
+
+    if (0 > getsockopt(socket, SOL_SOCKET, SO_MEMINFO, _meminfo, &_length)) {
+        LOG(error, "can't get socket option [SOL_SOCKET, SO_MEMINFO], cuz' %d [%s]", errno, strerror(errno));
+        return rsocket_failed;
+    }
+
+    (*allocated) = _meminfo[SK_MEMINFO_RMEM_ALLOC];
+    return rsocket_ok;
+}
+
+rsocket
+socket_reuseport_cpu_set (
+        socket_t                socket,
+        size_t                  lanes
+) {
+    //socket index in group is bind order, so it's locality only
+    struct sock_filter _code[] = {
+            BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU)
+        ,   BPF_STMT(BPF_ALU | BPF_MOD | BPF_K,   (uint32_t)lanes)
+        ,   BPF_STMT(BPF_RET | BPF_A,             0)
+    };
+
+    struct sock_fprog _program = {
+            .len    = sizeof(_code) / sizeof(_code[0])
+        ,   .filter = _code
+    };
+
+    _SOCKOPT(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &_program, sizeof(_program));
+    return rsocket_ok;
+}
+
 rsocket
 socket_fwmark_set (
         socket_t                socket,
@@ -9,6 +9,18 @@
 #include "bproxy.h"
 #include "ipv4.h"
 
+#include <netinet/udp.h>
+
+#if     !defined(UDP_SEGMENT)
+    #warning hardcoded value used [UDP_SEGMENT]
+    #define UDP_SEGMENT         (103)
+#endif
+
+#if     !defined(UDP_GRO)
+    #warning hardcoded value used [UDP_GRO]
+    #define UDP_GRO             (104)
+#endif
+
 typedef
 int                     socket_t;
 
@@ -40,6 +52,16 @@ uint8_t                 tos_t;
 #define FSOCKET_RECVTOS                 (1 << 7)
 #define FSOCKET_DONTROUTE               (1 << 8)
 #define FSOCKET_RECVOPTIONS             (1 << 9)
+#define FSOCKET_REUSEPORT               (1 << 10)
+#define FSOCKET_TIMESTAMP               (1 << 11)   //kernel receive timestamps [SO_TIMESTAMPNS]
+#define FSOCKET_DONTFRAGMENT            (1 << 12)   //path mtu discovery, datagrams are never fragmented
+#define FSOCKET_GRO                     (1 << 13)   //receive coalesced datagrams [UDP_GRO, 5.0+], best effort
+
+typedef
+enum {
+        esocket_steering_flow   = 0     //kernel's reuseport hash, broadcasts by source address & port
+    ,   esocket_steering_cpu            //by receiving cpu [rss queue]
+} esocket_steering;
 
 typedef
 enum {
@@ -47,6 +69,31 @@ enum {
     ,   rsocket_failed
 } rsocket;
 
+/** KIM: af-packet ring
+        packet socket [cooked, so data starts with ip header] with TPACKET_V3
+        rx ring: kernel fills blocks of variable sized frames, block is handed
+        to userspace when it's full or retire timeout expired, userspace
+        returns it by status. socket is opened with no protocol, so it gets
+        nothing until it's bound [filter is attached before]
+
+        tx ring [TPACKET_V2, raw]: fixed frames, userspace writes complete
+        frame [link header included] and marks it for sending, one send kicks
+        all marked ones. frame is owned by kernel until device frees it, so
+        ring is full when next frame isn't available yet. socket is never
+        bound, so it receives nothing; device is passed to each kick
+**/
+typedef
+struct _socket_ring     ssocket_ring;
+
+struct _socket_ring {
+    ubyte_t*                map;        //NULL - not mapped
+    size_t                  size;
+
+    size_t                  blocks;     //tx: frames
+    size_t                  block_size; //tx: frame size
+    size_t                  current;    //next block to read [tx: frame to write]
+};
+
 socket_t
 socket_open (
         uint32_t                flags,
@@ -60,6 +107,92 @@ socket_raw (
         const char*             device
 );
 
+rsocket
+socket_bind (
+        socket_t                socket,
+        struct sockaddr*        binding
+);
+
+//af-packet socket with mapped rx ring [see KIM: af-packet ring], block_size is page multiple
+socket_t
+socket_packet (
+        size_t                  blocks,
+        size_t                  block_size,
+        uint32_t                retire,     //ms
+    OUT ssocket_ring*           ring
+);
+
+//starts receiving ip datagrams, index 0 - from all devices
+rsocket
+socket_packet_bind (
+        socket_t                socket,
+        device_index_t          index
+);
+
+//closes socket & unmaps its ring
+void
+socket_packet_close (
+        socket_t                socket,
+    BTH ssocket_ring*           ring
+);
+
+//af-packet socket with mapped tx ring [see KIM: af-packet ring], frame_size is power of 2
+socket_t
+socket_packet_tx (
+        size_t                  frames,
+        size_t                  frame_size,
+    OUT ssocket_ring*           ring
+);
+
+//starts sending of frames marked in tx ring, doesn't wait for them
+rsocket
+socket_packet_kick (
+        socket_t                socket,
+        device_index_t          index
+);
+
+//drops since last call [PACKET_STATISTICS resets them]
+rsocket
+socket_packet_statistics (
+        socket_t                socket,
+    OUT uint32_t*               drops,
+    OUT uint32_t*               freezes
+);
+
+struct sock_filter;
+
+rsocket
+socket_filter_set (
+        socket_t                socket,
+    IN  const struct sock_filter*   code,
+        size_t                  length
+);
+
+//attaches drop-all filter & shrinks receive buffer, for sockets which are never read
+rsocket
+socket_receive_discard (
+        socket_t                socket
+);
+
+//ok if kernel segments udp datagrams [UDP_SEGMENT, 4.18+]
+rsocket
+socket_udp_segment_probe (
+        socket_t                socket
+);
+
+//receive memory charged to socket [SO_MEMINFO]
+rsocket
+socket_receive_memory (
+        socket_t                socket,
+    OUT uint32_t*               allocated
+);
+
+rsocket
+socket_reuseport_cpu_set (
+        socket_t                socket,
+        size_t                  lanes
+);
+
 rsocket
 socket_fwmark_set (
         socket_t                socket,
@@ -3,6 +3,8 @@
     Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
 **/
 
+#define _GNU_SOURCE     //recvmmsg
+
 #include "source.h"
 #include "log.h"
 
@@ -13,6 +15,9 @@
 #include <errno.h>
 #include <string.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <unistd.h>
 
 #define IP_DONTFRAGMENT (0x4000)          /* Flag: "Don't Fragment"       */
 #define IP_FRAGMENT     (0x2000)          /* Flag: "More Fragments"       */
@@ -21,22 +26,40 @@
 
 #include <netinet/ip.h>
 #include <netinet/udp.h>
+#include <linux/if_packet.h>
 
 #include "swap.h"
 #include "ipv4-option.h"
+#include "jenkins.h"
+#include "filter.h"
+#include "socket-pool.h"
 
 LOG_MODULE("source");
 
+//sink's hot part is one cache line [see KIM: sink], fails to compile otherwise
+typedef char _ssink_hot_size[(sizeof(ssink) == CACHE_LINE_SIZE)?1:-1];
+
 static rsource
 _sink_start (
     BTH ssink*                          sink
 );
 
+static rsource
+_source_filter_attach (
+    BTH ssource*                        source,
+        socket_t                        socket
+);
+
 static rsource
 _sink_stop (
     BTH ssink*                          sink
 );
 
+static rsource
+_sink_template_build (
+    BTH ssink*                          sink
+);
+
 static inline rsource
 _sink_restart (
     BTH ssink*                          sink
@@ -54,17 +77,104 @@ struct __source_udp_packet {
 
     void*                               options;
     size_t                              options_length;
+    uint32_t                            options_hash;   //resolved before relaying to sinks
 
     struct sockaddr_in                  from;
 
     uint16_t                            id;
+    uint16_t                            segment;        //UDP_GRO segment size, 0 - single datagram [see KIM: udp gro]
 
     uint8_t                             tos;
     uint8_t                             ttl;
 
     sipv4_destination                   destination;
+
+    struct __source_flow*               flow;           //flow being recorded on cache miss, NULL - don't record
+
+    uint64_t                            received;       //kernel receive timestamp [realtime ns], 0 - unknown
 } _ssource_udp_packet;
 
+/** KIM: udp gro
+        simple source with gro gets run of same flow datagrams as one buffer,
+        UDP_GRO cmsg gives segment size: all segments but last one have it.
+        buffer is split in place, segments are relayed one by one as usual
+        datagrams [flow decision is cached for the rest], tx queue refers
+        them until flush. udp transport sinks coalesce them back
+**/
+
+/** KIM: flow decision cache
+        verdict of _source_proceed and per sink checks [allow, port-range,
+        loops, resolved port] depends on (from, destination, port) and on
+        configuration & rtlink state only, so it's recorded on miss and
+        replayed on hit. rate-limit is still checked per packet.
+
+        entries are tagged by global generation, which is bumped on rtlink
+        notifications, sink templates changes and sources_invalidate
+**/
+typedef
+struct __source_flow_sink {
+    ssink*                              sink;
+    uint64_t                            targets;    //template targets, loops excluded
+    uint16_t                            port;       //resolved destination port
+    uint8_t                             loops;      //targets excluded as loops
+    uint64_t*                           rejected;   //counter of cached rejection, NULL - relayed
+} _ssource_flow_sink;
+
+typedef
+struct __source_flow {
+    uint32_t                            generation; //0 - empty
+    ipv4_t                              from;
+    ipv4_t                              destination;
+    uint16_t                            port;
+
+    uint8_t                             accepted;
+    uint8_t                             count;
+    uint64_t*                           rejected;   //counter of cached rejection, if not accepted
+
+    _ssource_flow_sink                  sinks[SOURCE_FLOW_SINKS];
+} _ssource_flow;
+
+struct _source_flows {
+    _ssource_flow                       entries[SOURCE_FLOW_CACHE_SIZE];
+};
+
+static uint32_t _gsources_generation = 1;
+
+//cleared once kernel [or device] refuses UDP_SEGMENT, udp transport sinks send datagram by datagram then
+static int _gsources_udp_segment = 1;
+
+static inline uint32_t
+_sources_generation (
+) { return __atomic_load_n(&_gsources_generation, __ATOMIC_ACQUIRE); }
+
+static inline void
+_sources_generation_bump (
+) {
+    //zero marks empty entry
+    if (0 == __atomic_add_fetch(&_gsources_generation, 1, __ATOMIC_ACQ_REL))
+        __atomic_add_fetch(&_gsources_generation, 1, __ATOMIC_ACQ_REL);
+}
+
+void
+sources_invalidate (
+) { _sources_generation_bump(); }
+
+static inline uint64_t
+_timespec_nsec (
+    IN  const struct timespec*  time
+) { return ((uint64_t)time->tv_sec * 1000000000ULL) + (uint64_t)time->tv_nsec; }
+
+static inline void
+_control_timestamp (
+    IN  struct cmsghdr*         cmsg,
+    OUT _ssource_udp_packet*    packet
+) {
+    struct timespec _stamp;
+
+    memcpy(&_stamp, CMSG_DATA(cmsg), sizeof(_stamp));
+    packet->received = _timespec_nsec(&_stamp);
+}
+
 rsource
 _control_information (
     IN  struct msghdr*          msg,
@@ -78,9 +188,26 @@ _control_information (
 
     int _resolved = 0;
 
+    packet->received = 0;
+    packet->segment  = 0;
+
     for (struct cmsghdr* _cmsg = CMSG_FIRSTHDR(msg); NULL != _cmsg; _cmsg = CMSG_NXTHDR(msg, _cmsg)) {
         LOG(debug, "cmsg [level: %d, type: %d]", _cmsg->cmsg_level, _cmsg->cmsg_type);
 
+        if ( (SOL_SOCKET == _cmsg->cmsg_level) && (SCM_TIMESTAMPNS == _cmsg->cmsg_type) ) {
+            _control_timestamp(_cmsg, packet);
+            continue;
+        }
+
+        if ( (SOL_UDP == _cmsg->cmsg_level) && (UDP_GRO == _cmsg->cmsg_type) ) {
+            int _segment;
+
+            memcpy(&_segment, CMSG_DATA(_cmsg), sizeof(_segment));
+            packet->segment = (uint16_t)_segment;
+
+            continue;
+        }
+
         if ( (SOL_IP == _cmsg->cmsg_level) && (IP_PKTINFO == _cmsg->cmsg_type) ) {
             if (0 != (_RESOLVED_ORIGDSTADDR & _resolved))
                 continue;
@@ -151,7 +278,7 @@ _control_information (
             _resolved |= _RESOLVED_OPTIONS;
 
             packet->options        = CMSG_DATA(_cmsg);
-            packet->options_length = _cmsg->cmsg_len;
+            packet->options_length = (_cmsg->cmsg_len - CMSG_LEN(0));
             continue;
         }   
 
@@ -192,6 +319,9 @@ _sink_rtlink_handler (
     BTH ssink*                          sink,
         uint32_t                        flags
 ) {
+    //join addresses are used by sources' martian checks
+    _sources_generation_bump();
+
     switch (rtlink_listener_state(listener)) {
         case ertlink_state_removed:
             _sink_stop(sink);
@@ -202,6 +332,16 @@ _sink_rtlink_handler (
                 if (0 == (FRTLINK_NOTIFY_INDEX_RELAXED & flags))
                     _sink_stop(sink);
 
+            //ring's frames fit device's mtu and carry its address
+            if (0 != (FSINK_REWRITE_TRANSPORT_PACKET & sink->rewrite))
+                if (0 != ((FRTLINK_NOTIFY_LINK | FRTLINK_NOTIFY_MTU) & flags))
+                    _sink_stop(sink);
+
+            if (! SOCKET_INVALID_IS(sink->socket))
+                if (0 != ((FRTLINK_NOTIFY_ADDRESS | FRTLINK_NOTIFY_MTU) & flags))
+                    if (rsource_ok != _sink_template_build(sink))
+                        _sink_stop(sink);
+
             _sink_start(sink);
             break;
     }
@@ -212,8 +352,8 @@ _sink_rtlink_handler_simple (
     BTH srtlink_listener*               listener,
         uint32_t                        flags
 ) {
-    ssink* _sink = CONTAINEROF(listener, ssink, ts.simple.device.runtime);
-    _sink_rtlink_handler(listener, _sink, flags);
+    ssink_cold* _cold = CONTAINEROF(listener, ssink_cold, ts.simple.device.runtime);
+    _sink_rtlink_handler(listener, _cold->sink, flags);
 }
 
 static void
@@ -221,8 +361,8 @@ _sink_rtlink_handler_join (
     BTH srtlink_listener*               listener,
         uint32_t                        flags
 ) {
-    ssink* _sink = CONTAINEROF(listener, ssink, ts.join.runtime.device);
-    _sink_rtlink_handler(listener, _sink, flags);
+    ssink_cold* _cold = CONTAINEROF(listener, ssink_cold, ts.join.runtime.device);
+    _sink_rtlink_handler(listener, _cold->sink, flags);
 }
 
 static void
@@ -232,6 +372,8 @@ _source_rtlink_handler (
 ) {
     ssource* _source = CONTAINEROF(listener, ssource, ss.runtime.device);
 
+    _sources_generation_bump();
+
     switch (rtlink_listener_state(listener)) {
         case ertlink_state_removed:
             source_stop(_source);
@@ -242,6 +384,13 @@ _source_rtlink_handler (
                 if (0 == (FRTLINK_NOTIFY_INDEX_RELAXED & flags))
                     source_stop(_source);
 
+            //filter is compiled with device's addresses
+            if ((0 != (FRTLINK_NOTIFY_ADDRESS & flags)) && (rsource_ok == source_state(_source)))
+                if (rsource_ok != _source_filter_attach(_source, pollable_socket(_source_pollable(_source)))) {
+                    LOG(verbose, "source %p: can't rebuild filter, restarting", _source);
+                    source_stop(_source);
+                }
+
             source_start(_source);
             break;
     }
@@ -252,69 +401,408 @@ _sink_stop (
     BTH ssink*                          sink
 );
 
+static device_mtu_t
+_sink_mtu (
+    IN  ssink*                          sink
+) {
+    if (0 != (FSINK_REWRITE_MTU & sink->rewrite))
+        return sink->cold->mtu;
+
+    switch (sink->type) {
+        case esink_type_simple:
+            return rtlink_listener_mtu(&(sink->cold->ts.simple.device.runtime));
+
+        case esink_type_join:
+            return rtlink_listener_mtu(&(sink->cold->ts.join.runtime.device));
+    }
+
+    LOG(critical, "_sink_mtu wrong sink type, check code");
+    return ipv4_unknown_mtu();
+}
+
+static void
+_sink_template_free (
+    BTH ssink*                          sink
+) {
+    //targets are cached by flows
+    _sources_generation_bump();
+
+    free(sink->template.targets);
+
+    sink->template.targets  = NULL;
+    sink->template.count    = 0;
+}
+
 static rsource
-_sink_start (
+_sink_template_build (
     BTH ssink*                          sink
 ) {
-    if (! SOCKET_INVALID_IS(sink->socket)) return rsource_ok;
+    _sink_template_free(sink);
+
+    //----- fields common for all targets
+    uint32_t      _patch = 0;
+
+    struct iphdr  _iphdr;
+    struct udphdr _udphdr;
+
+    memset(&_iphdr,  0, sizeof(_iphdr));
+    memset(&_udphdr, 0, sizeof(_udphdr));
+
+    _iphdr.version  = 4;
+    _iphdr.ihl      = (sizeof(struct iphdr) >> 2);
+    _iphdr.protocol = IPPROTO_UDP;
+
+    if (0 != (FSINK_REWRITE_TOS & sink->rewrite)) {
+        _iphdr.tos = sink->cold->tos;
+    } else {
+        _patch |= FSINK_TEMPLATE_TOS;
+    }
+
+    if (0 != (FSINK_REWRITE_TTL & sink->rewrite)) {
+        if (0 == (_iphdr.ttl = sink->cold->ttl))
+            if (rsysctl_ok != ipv4_default_ttl(&(_iphdr.ttl))) {
+                LOG(error, "sink: %p can't resolve system's default ttl", sink);
+                return rsource_failed;
+            }
+
+    } else {
+        _patch |= FSINK_TEMPLATE_TTL;
+    }
+
+    if (0 != (FSINK_REWRITE_FROM & sink->rewrite)) {
+        u32_unaligned(&(_iphdr.saddr), sink->cold->from.address);
+
+        if (0 != sink->cold->from.port) {
+            u16_unaligned(&(_udphdr.source), sink->cold->from.port);
+        } else {
+            _patch |= FSINK_TEMPLATE_SPORT;
+        }
+
+    } else {
+        _patch |= (FSINK_TEMPLATE_SADDR | FSINK_TEMPLATE_SPORT);
+    }
+
+    if (0 == (FSINK_REWRITE_NO_IP_ID & sink->rewrite))
+        _patch |= FSINK_TEMPLATE_ID;
+
+    if (0 != (FSINK_REWRITE_DESTINATION_ORIGINAL & sink->rewrite))
+        _patch |= FSINK_TEMPLATE_DADDR;
 
-    const char* _device = NULL;
+    //----- targets
+    size_t _count = 0;
 
     switch (sink->type) {
         case esink_type_simple:
-            _device = rtlink_listener_device_name(&(sink->ts.simple.device.runtime));
+            _count = 1;
             break;
 
         case esink_type_join:
-            _device = rtlink_listener_device_name(&(sink->ts.join.runtime.device));
+            for (srtlink_device_address* _address = rtlink_listener_address(&(sink->cold->ts.join.runtime.device)); NULL != _address; _address = rtlink_device_address_next(_address))
+                _count++;
+
             break;
     }
 
-    if SOCKET_INVALID_IS(sink->socket = socket_raw(sink->flg_socket, _device))
-        return rsource_failed;
+    ssink_target* _targets = NULL;
+
+    if (0 < _count)
+        if NULL_IS(_targets = (ssink_target*)calloc(_count, sizeof(ssink_target))) {
+            LOG(critical, "out of memory: sink targets [%lu]", (unsigned long)(_count * sizeof(ssink_target)));
+            return rsource_failed;
+        }
+
+    switch (sink->type) {
+        case esink_type_simple:
+            memcpy(&(_targets[0].network), &(sink->cold->ts.simple.target), sizeof(sipv4_network));
+            _targets[0].address.sin_addr.s_addr = sink->cold->ts.simple.target.address;
+            break;
+
+        case esink_type_join: {
+            ssink_target* _target = _targets;
+
+            for (srtlink_device_address* _address = rtlink_listener_address(&(sink->cold->ts.join.runtime.device)); NULL != _address; _address = rtlink_device_address_next(_address), _target++) {
+                memcpy(&(_target->network), &(_address->network), sizeof(sipv4_network));
+                _target->address.sin_addr.s_addr = _address->broadcast;
+            }
+
+            break;
+        }
+    }
+
+    for (size_t _i = 0; _i < _count; ++_i) {
+        ssink_target* _target = &(_targets[_i]);
+
+        _target->address.sin_family = AF_INET;
+
+        memcpy(&(_target->iphdr),  &_iphdr,  sizeof(_iphdr));
+        memcpy(&(_target->udphdr), &_udphdr, sizeof(_udphdr));
 
-    if (0 != (FSINK_REWRITE_FWMARK & sink->fwmark))
-        if (rsocket_ok != socket_fwmark_set(sink->socket, sink->fwmark))
-            goto _failed_close;
+        u32_unaligned(&(_target->iphdr.daddr), _target->address.sin_addr.s_addr);
+    }
+
+    sink->template.patch    = (uint16_t)_patch;
+    sink->template.mtu      = _sink_mtu(sink);
+    sink->template.count    = (uint16_t)_count;
+    sink->template.targets  = _targets;
 
+    LOG(debug, "sink: %p template built, %lu targets, mtu %"PRIu32", patch %"PRIx32, sink, (unsigned long)_count, (uint32_t)sink->template.mtu, _patch);
     return rsource_ok;
+}
 
-    _failed_close:
-        _sink_stop(sink);
-        return rsource_failed;
+/** KIM: af-xdp source
+        raw source with "xdp" receives by af-xdp socket per lane, bound to
+        lane's queue of source's device [lanes are queues here, nic spreads
+        datagrams among them], datagrams are parsed right in umem frames.
+        program passes datagrams of queue without socket to kernel, where
+        nobody relays them, so source isn't started unless its lanes cover
+        every rx queue of device.
+
+        sink with packet transport on other device opens its own socket,
+        sharing lane's umem, so broadcast is sent in place: headers are
+        written over received ones [right before payload] and descriptor of
+        the same frame is posted to sink's tx ring. frame is held by sink until
+        its completion, then it goes back to fill ring. frame is posted by one
+        sink only, other sinks [and datagrams which don't fit] are copied into
+        af-packet tx ring as usual.
+
+        frames return to fill ring exactly once: completed ones by reclaim,
+        received ones by rx handler after batch is flushed. sink stopped in
+        the middle of batch [send failure] marks its frames released, they are
+        left to handler as well, otherwise frame of batch would be filled twice.
+
+        rx handler runs only while rx ring gets frames, so sinks never hold
+        more than frames less rx budget [the rest is copied], and completions
+        are reclaimed by lane's timer too, while any frame is held.
+
+        mode is zero copy if driver supports it, copy otherwise [and for veth],
+        kernel must have xdp links & shared umem [5.10+]. sharing socket gets
+        mode of umem, zero copy one would take rx ring of sink device's queue
+        over [its fill ring is never stocked], so umem is shared in copy mode
+        only, zero copy source copies broadcasts into af-packet tx ring.
+**/
+struct _source_xdp {
+    sxdp_umem                           umem;
+    sxdp_socket                         socket;     //receiving one
+    device_index_t                      index;      //source's device
+    uint32_t                            queue;      //lane's
+
+    ssink**                             holders;    //frame -> sink, which posted it, NULL - free
+    size_t                              current;    //frame being proceeded, its headers are still read, frames - none
+    uint8_t                             mapped;     //socket is in program's xskmap
+    uint8_t                             batch;      //rx batch is being proceeded
+    uint8_t                             armed;      //reclaim timer is armed
+    size_t                              held;       //frames held by sinks [or released]
+    uint8_t                             released;   //some holders are SOURCE_XDP_RELEASED
+
+    uint64_t                            drops;      //XDP_STATISTICS are since open, so counted ones are kept
+    uint64_t                            empty;
+};
+
+//holder of frame whose sink was stopped during batch
+#define SOURCE_XDP_RELEASED     ((ssink*)(uintptr_t)1)
+
+static inline void
+_source_xdp_refill (
+    BTH ssource_xdp*                    xdp,
+        size_t                          frame
+) { (*xdp_ring_address(&(xdp->socket.fill), xdp->socket.fill.head++)) = (uint64_t)(frame * xdp->umem.frame_size); }
+
+//frames held by sink return to fill ring, socket itself is closed
+static void
+_sink_xsk_close (
+    BTH ssink*                          sink
+) {
+    ssink_cold*  _cold = sink->cold;
+    ssource_xdp* _xdp  = _cold->packet.xdp;
+
+    if SOCKET_INVALID_IS(_cold->packet.xsk.socket)
+        return;
+
+    xdp_socket_close(&(_cold->packet.xsk));
+    _cold->packet.posted = 0;
+
+    for (size_t _i = 0; _i < _xdp->umem.frames; ++_i)
+        if (sink == _xdp->holders[_i]) {
+            //batch's frames are refilled by rx handler [see KIM: af-xdp source]
+            if (0 != _xdp->batch) {
+                _xdp->holders[_i] = SOURCE_XDP_RELEASED;
+                _xdp->released    = 1;
+                continue;
+            }
+
+            _xdp->holders[_i] = NULL;
+            _xdp->held--;
+            _source_xdp_refill(_xdp, _i);
+        }
+
+    if (0 == _xdp->batch)
+        xdp_ring_submit(&(_xdp->socket.fill));
 }
 
-static rsource
-_sink_stop (
+static void
+_sink_xsk_open (
+    BTH ssink*                          sink,
+    BTH srtlink_listener*               listener
+) {
+    ssink_cold*  _cold = sink->cold;
+    ssource_xdp* _xdp  = _cold->packet.xdp;
+
+    if (NULL_IS(_xdp) || (0 == _cold->packet.mtu) || (! SOCKET_INVALID_IS(_cold->packet.xsk.socket)))
+        return;
+
+    //device's queue is bound by source's socket already
+    if (_xdp->index == rtlink_listener_index(listener))
+        return;
+
+    //queue of sink's device would stop receiving [see KIM: af-xdp source]
+    if (XDP_ZEROCOPY == _xdp->socket.mode) {
+        LOG(verbose, "sink: %p source's af-xdp umem is zero copy, broadcasts are copied", sink);
+        return;
+    }
+
+    if (rxdp_ok != xdp_socket_open(&(_cold->packet.xsk), &(_xdp->umem), &(_xdp->socket), rtlink_listener_index(listener), _xdp->queue, SINK_XDP_ENTRIES)) {
+        LOG(warning, "sink: %p can't share af-xdp umem on device [%s] queue %"PRIu32", broadcasts are copied", sink, rtlink_listener_device_name(listener), _xdp->queue);
+        return;
+    }
+
+    LOG(verbose, "sink: %p sends in place by af-xdp", sink);
+}
+
+static void
+_sink_ring_close (
     BTH ssink*                          sink
 ) {
-    if SOCKET_INVALID_IS(sink->socket) return rsource_ok;
+    ssink_cold* _cold = sink->cold;
 
-    socket_close(sink->socket);
-    sink->socket = SOCKET_INVALID;
+    _sink_xsk_close(sink);
+    _cold->packet.mtu = 0;
 
-    return rsource_ok;
+    if SOCKET_INVALID_IS(_cold->packet.socket)
+        return;
+
+    socket_packet_close(_cold->packet.socket, &(_cold->packet.ring));
+    _cold->packet.socket = SOCKET_INVALID;
 }
 
-static device_mtu_t
-_sink_mtu (
-    IN  ssink*                          sink
+//without ring sink still works, broadcasts are routed [see KIM: packet transport]
+static void
+_sink_ring_open (
+    BTH ssink*                          sink,
+    BTH srtlink_listener*               listener
 ) {
-    if (0 != (FSINK_REWRITE_MTU & sink->rewrite))
-        return sink->mtu;
+    ssink_cold*    _cold    = sink->cold;
+    const ubyte_t* _address = rtlink_listener_ethernet(listener);
+
+    if NULL_IS(_address) {
+        LOG(warning, "sink: %p device [%s] isn't ethernet [or its address is unknown], broadcasts are routed", sink, rtlink_listener_device_name(listener));
+        return;
+    }
+
+    device_mtu_t _mtu   = rtlink_listener_mtu(listener);
+    size_t       _need  = (TPACKET_ALIGN(sizeof(struct tpacket2_hdr)) + ETHER_HDR_LEN + _mtu);
+    size_t       _frame = TPACKET_ALIGNMENT;
+
+    struct ether_header* _ethernet = (struct ether_header*)_cold->packet.ethernet;
+
+    memset(_ethernet->ether_dhost, 0xFF, ETHER_ADDR_LEN);
+    memcpy(_ethernet->ether_shost, _address, ETHER_ADDR_LEN);
+    htons_unaligned(&(_ethernet->ether_type), ETHERTYPE_IP);
+
+    //header is known, so frames may be posted in place even without ring
+    _cold->packet.index = rtlink_listener_index(listener);
+    _cold->packet.mtu   = _mtu;
+
+    _sink_xsk_open(sink, listener);
+
+    while (_frame < _need)
+        _frame <<= 1;
+
+    if SOCKET_INVALID_IS(_cold->packet.socket = socket_packet_tx(SINK_RING_FRAMES, _frame, &(_cold->packet.ring))) {
+        LOG(warning, "sink: %p can't open tx ring, broadcasts are routed", sink);
+        return;
+    }
+
+    LOG(verbose, "sink: %p tx ring of %lu frames [%lu bytes]", sink, (unsigned long)_cold->packet.ring.blocks, (unsigned long)_frame);
+}
 
+static srtlink_listener*
+_sink_listener (
+    BTH ssink*                          sink
+) {
     switch (sink->type) {
         case esink_type_simple:
-            return rtlink_listener_mtu(&(sink->ts.simple.device.runtime));
+            return &(sink->cold->ts.simple.device.runtime);
 
         case esink_type_join:
-            return rtlink_listener_mtu(&(sink->ts.join.runtime.device));
+            return &(sink->cold->ts.join.runtime.device);
     }
 
-    LOG(critical, "_sink_mtu wrong sink type, check code");
-    return ipv4_unknown_mtu();
+    return NULL;
+}
+
+static rsource
+_sink_start (
+    BTH ssink*                          sink
+) {
+    if (! SOCKET_INVALID_IS(sink->socket)) return rsource_ok;
+
+    srtlink_listener* _listener = _sink_listener(sink);
+
+    if NULL_IS(_listener)
+        return rsource_failed;
+
+    fwmark_t _fwmark = (0 != (FSINK_REWRITE_FWMARK & sink->rewrite))?sink->cold->fwmark:0;
+
+    uint32_t                 _flags   = sink->cold->flg_socket;
+    const sipv4_destination* _binding = NULL;
+
+    //kernel builds headers, so socket is bound to "from" [see KIM: udp transport]
+    if (0 != (FSINK_REWRITE_TRANSPORT_UDP & sink->rewrite)) {
+        _flags   = ((_flags & ~FSOCKET_HDRINCL) | FSOCKET_TRANSPARENT | FSOCKET_REUSEADDR);
+        _binding = &(sink->cold->from);
+
+        if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite))
+            _flags |= FSOCKET_DONTFRAGMENT;
+    }
+
+    //sinks on the same device share socket [see KIM: raw socket pool]
+    if SOCKET_INVALID_IS(sink->socket = socket_pool_acquire(_flags, rtlink_listener_device_name(_listener), rtlink_listener_index(_listener), _fwmark, _binding))
+        return rsource_failed;
+
+    if (NOT_NULL_IS(_binding) && (0 != __atomic_load_n(&_gsources_udp_segment, __ATOMIC_RELAXED)))
+        if (rsocket_ok != socket_udp_segment_probe(sink->socket)) {
+            LOG(warning, "sink: %p kernel doesn't support UDP_SEGMENT, datagrams won't be coalesced", sink);
+            __atomic_store_n(&_gsources_udp_segment, 0, __ATOMIC_RELAXED);
+        }
+
+    if (rsource_ok != _sink_template_build(sink))
+        goto _failed_close;
+
+    if (0 != (FSINK_REWRITE_TRANSPORT_PACKET & sink->rewrite))
+        _sink_ring_open(sink, _listener);
+
+    return rsource_ok;
+
+    _failed_close:
+        _sink_stop(sink);
+        return rsource_failed;
 }
 
+static rsource
+_sink_stop (
+    BTH ssink*                          sink
+) {
+    if SOCKET_INVALID_IS(sink->socket) return rsource_ok;
+
+    _sink_ring_close(sink);
+
+    socket_pool_release(sink->socket);
+    sink->socket = SOCKET_INVALID;
+
+    _sink_template_free(sink);
+
+    return rsource_ok;
+}
 
 static rsource
 _source_relay_sink_ip_options_copy (
@@ -373,7 +861,7 @@ _source_relay_sink_ip_options (
         if (0 == (FSINK_REWRITE_SECURITY_DROP & sink->rewrite)) {
             LOG(debug, "rewriting security");
 
-            if (ripv4_ok != ipv4_security_option(&_cursor, sink->security_level, sink->security_categories)) {
+            if (ripv4_ok != ipv4_security_option(&_cursor, sink->cold->security_level, sink->cold->security_categories)) {
                 LOG(error, "can't fill ip security option");
                 return rsource_failed;
             }
@@ -402,845 +890,3759 @@ _source_relay_sink_ip_options (
     return rsource_ok;
 }
 
-static rsource
-_source_relay_sink_send (
-    IN  ssink*                          sink,
-    BTH _ssource_udp_packet*            packet,
-        struct sockaddr_in*             target
-) {
-    //----- first, fast check mtu
-    uint32_t _mtu_sink = _sink_mtu(sink);
+//--------------------------------------------- queued transmit [sendmmsg]
 
-    ubyte_t  _ip_options[IPV4_MAX_OPTIONS_LENGTH];
-    ubyte_t* _ip_fragments = _ip_options;  
+typedef
+struct __source_tx_entry {
+    struct msghdr                       msg;
+    struct iovec                        iov[4];     //iphdr, options, udphdr, payload
+
+    ssink*                              sink;       //NULL once grouped for sending
+    struct sockaddr_in                  target;
+
+    struct iphdr                        iphdr;      //udp transport: only ttl & tos
+    struct udphdr                       udphdr;
+    ubyte_t                             options[IPV4_MAX_OPTIONS_LENGTH];
+
+    union {
+        size_t                          align;      //cmsghdr alignment
+        ubyte_t                         buffer[(CMSG_SPACE(sizeof(int)) * 2) + CMSG_SPACE(sizeof(uint16_t))];
+    }                                   control;    //udp transport: ttl, tos & segment size of run it starts
+} _ssource_tx_entry;
+
+/** KIM: udp transport
+        raw sink pays full per datagram cost: headers are built & sent one by
+        one. sink with udp transport sends payloads by udp socket bound
+        [transparent] to "from", kernel builds headers, checksums and
+        fragments.
+
+        while flushing, consecutive payloads of such sink to the same target
+        [with the same ttl & tos] are coalesced into one send with UDP_SEGMENT:
+        all of them but last one must have the same size, last one may be
+        shorter [and closes run]. kernel splits it back to datagrams in one
+        pass [or device does, when it offloads segmentation].
+
+        socket is bound once, so "from" with port is required, ip options
+        aren't relayed, ip ids & security are kernel's
+**/
 
-    size_t   _ip_hlength   = sizeof(struct iphdr); //in 32bits
+#define SOURCE_UDP_SEGMENTS         (64)        //UDP_MAX_SEGMENTS of older kernels
+#define SOURCE_UDP_PAYLOAD          (65507)     //max udp payload
 
-    if (rsource_ok != _source_relay_sink_ip_options(sink, packet, &_ip_options, &_ip_hlength, &_ip_fragments)) {
-        LOG(error, "can't fill ip options");
-        return rsource_failed;
-    }
+struct _source_tx {
+    size_t                              depth;
+    size_t                              used;
 
-    LOG_BINARY(debug, _ip_options, _ip_hlength - sizeof(struct iphdr), "starting with ip options");
+    _ssource_tx_entry*                  entries;
+    struct mmsghdr*                     messages;   //entries grouped by sink while flushing
+    size_t*                             datagrams;  //... datagrams per message [UDP_SEGMENT run is many]
+    struct iovec*                       segments;   //... payloads of udp transport runs
+};
 
-    LOG(debug, "sink %p: mtu is %"PRIu32, sink, (uint32_t)_mtu_sink);
+static void
+_source_tx_free (
+    BTH ssource_tx*                     tx
+) {
+    if NULL_IS(tx)
+        return;
+
+    free(tx->entries);
+    free(tx->messages);
+    free(tx->datagrams);
+    free(tx->segments);
+    free(tx);
+}
 
-    if (_mtu_sink <= (_ip_hlength + sizeof(struct udphdr))) {
-        LOG(error, "sink %p: mtu too small to fit atleast headers", sink);
-        LOG(warning, " ^ increase mtu to atleast %"PRIu32, (uint32_t)(_ip_hlength + sizeof(struct udphdr)));
+static ssource_tx*
+_source_tx_allocate (
+        size_t                          depth
+) {
+    ssource_tx* _tx = (ssource_tx*)calloc(1, sizeof(ssource_tx));
 
-        return rsource_failed;
+    if NULL_IS(_tx) {
+        LOG(critical, "out of memory: tx queue [%lu]", (unsigned long)sizeof(ssource_tx));
+        return NULL;
     }
 
-    uint32_t _mtu = (_mtu_sink - (_ip_hlength + sizeof(struct udphdr)));
-
-    if (packet->length > _mtu)
-        if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite)) {
-            LOG(verbose, "sink: %p message rejected, cuz' fragmentation required", sink);
-
-            if (0 == (FSINK_REWRITE_NO_ICMP_FRAGMENTATION & sink->rewrite)) {
+    _tx->depth      = depth;
+    _tx->used       = 0;
 
-            }
+    _tx->entries    = (_ssource_tx_entry*)calloc(depth, sizeof(_ssource_tx_entry));
+    _tx->messages   = (struct mmsghdr*)calloc(depth, sizeof(struct mmsghdr));
+    _tx->datagrams  = (size_t*)calloc(depth, sizeof(size_t));
+    _tx->segments   = (struct iovec*)calloc(depth, sizeof(struct iovec));
 
-            return rsource_ok;
-        }
+    if (NULL_IS(_tx->entries) || NULL_IS(_tx->messages) || NULL_IS(_tx->datagrams) || NULL_IS(_tx->segments)) {
+        LOG(critical, "out of memory: tx queue of %lu", (unsigned long)depth);
 
-    //----- restore sink's socket
-    if (rsource_ok != _sink_start(sink)) {
-        LOG(verbose, "sink: %p can't start sink", sink);
-        return rsource_failed;
+        _source_tx_free(_tx);
+        return NULL;
     }
 
-    //----- resolve source address
-    ipv4_t   _from_address = packet->from.sin_addr.s_addr;
-    uint16_t _from_port    = packet->from.sin_port;
+    //entries never move, so headers can be wired once
+    for (size_t _i = 0; _i < depth; ++_i) {
+        _ssource_tx_entry* _entry = &(_tx->entries[_i]);
 
-    if (0 != (FSINK_REWRITE_FROM & sink->rewrite)) {
-        _from_address = sink->from.address;
+        _entry->iov[0].iov_base = &(_entry->iphdr);
+        _entry->iov[0].iov_len  = sizeof(struct iphdr);
+        _entry->iov[1].iov_base = _entry->options;
+        _entry->iov[2].iov_base = &(_entry->udphdr);
 
-        if (0 != (sink->from.port))
-            _from_port = sink->from.port;
+        _entry->msg.msg_name    = &(_entry->target);
+        _entry->msg.msg_namelen = sizeof(_entry->target);
+        _entry->msg.msg_iov     = _entry->iov;
+        _entry->msg.msg_iovlen  = 4;
     }
 
-    //----- fill headers
-    struct iphdr  _iphdr;
-    struct udphdr _udphdr;
-
-    htons_unaligned(&(_iphdr.check),  0); //calculate by kernel
-    htons_unaligned(&(_udphdr.check), 0); //calculate by kernel
+    return _tx;
+}
 
-    _iphdr.version  = 4;
-    _iphdr.protocol = IPPROTO_UDP;
+static inline uint64_t
+_source_clock (
+        clockid_t                       clock
+) {
+    struct timespec _time;
 
-    uint16_t _ip_id = packet->id;
+    clock_gettime(clock, &_time);
+    return _timespec_nsec(&_time);
+}
 
-    if (0 != (FSINK_REWRITE_NO_IP_ID & sink->rewrite)) {
-        _ip_id = htons(sink->last_ip_id);
+//receive syscall returned, processing starts
+static inline void
+_source_latency_begin (
+    BTH ssource*                        source
+) {
+    ssource_latency* _timing = source->timing;
 
-        if (0 == (++(sink->last_ip_id)))
-            sink->last_ip_id = 1;
-    }
+    if NULL_IS(_timing)
+        return;
 
-    u16_unaligned(&(_iphdr.id), _ip_id);
+    _timing->begin = _source_clock(CLOCK_MONOTONIC_RAW);
 
-    if (0 != (FSINK_REWRITE_TOS & sink->rewrite)) {
-        _iphdr.tos = sink->tos;
-    } else {
-        _iphdr.tos = packet->tos;
-    }
+    if (esource_latency_kernel == source->latency)
+        _timing->begin_real = _source_clock(CLOCK_REALTIME);
+}
 
-    if (0 != (FSINK_REWRITE_TTL & sink->rewrite)) {
-        if (0 == (_iphdr.ttl = sink->ttl))
-            if (rsysctl_ok != ipv4_default_ttl(&(_iphdr.ttl))) {
-                LOG(error, "sink: %p can't resolve system's default ttl", sink);
-                return rsource_failed;
-            }
+static inline void
+_source_latency_queued (
+    BTH ssource*                        source,
+    IN  const _ssource_udp_packet*      packet
+) {
+    ssource_latency* _timing = source->timing;
 
-    } else {
-        uint8_t _ttl = packet->ttl;
+    if (NULL_IS(_timing) || (0 == packet->received))
+        return;
 
-        if (_ttl < 2) {
-            LOG(verbose, "sink: %p message rejected due to low ttl", sink);
+    //realtime may step back
+    if (packet->received <= _timing->begin_real)
+        histogram_record(&(_timing->queue), _timing->begin_real - packet->received, 1);
+}
 
-            if (0 == (FSINK_REWRITE_NO_ICMP_TTL & sink->rewrite)) {
+//all datagrams of count packets are sent
+static inline void
+_source_latency_end (
+    BTH ssource*                        source,
+        size_t                          count
+) {
+    ssource_latency* _timing = source->timing;
 
-            }
+    if (NULL_IS(_timing) || (0 == count))
+        return;
 
-            return rsource_ok; //this isn't failure
-        }
+    histogram_record(&(_timing->process), _source_clock(CLOCK_MONOTONIC_RAW) - _timing->begin, count);
+}
 
-        _iphdr.ttl = (_ttl - 1);
-    }
+static inline size_t
+_source_tx_datagrams (
+    IN  const size_t*                   datagrams,
+        size_t                          count
+) {
+    size_t _datagrams = 0;
 
-    u32_unaligned(  &(_iphdr.saddr),    _from_address                                               );
-    u16_unaligned(  &(_udphdr.source),  _from_port                                                  );
+    for (size_t _i = 0; _i < count; ++_i)
+        _datagrams += datagrams[_i];
 
-    u32_unaligned(  &(_iphdr.daddr),    target->sin_addr.s_addr                                     );
-    u16_unaligned(  &(_udphdr.dest),    target->sin_port                                            );
+    return _datagrams;
+}
 
-    htons_unaligned(&(_iphdr.tot_len),  (_ip_hlength + sizeof(struct udphdr) + packet->length)      );
-    htons_unaligned(&(_udphdr.len),     (sizeof(_udphdr) + packet->length)                          );
+static void
+_source_tx_send (
+    BTH ssink*                          sink,
+    BTH struct mmsghdr*                 messages,
+    IN  const size_t*                   datagrams,
+        size_t                          count
+) {
+    size_t _sent = 0;
 
-    //----- sending fragmented[if needed] packet
-    ubyte_t* _buffer   = packet->buffer;
-    size_t   _length   = packet->length;
-    uint16_t _offset   = 0;
-    size_t   _overhead = 0;
+    while (_sent < count) {
+        int _r_sendmmsg = sendmmsg(sink->socket, &(messages[_sent]), (count - _sent), 0);
 
-    LOG(verbose, "sink %p: sending from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16, sink, 
-            IPV4_DPRIADDR(_from_address), htons(_from_port)
-        ,   IPV4_DPRIADDR(target->sin_addr.s_addr), htons(target->sin_port)
-    );
-    
-    _iphdr.ihl = (_ip_hlength >> 2);
+        if (0 > _r_sendmmsg) {
+            if EINTR_IS(errno) continue;
 
-    do { //if packet have zero size, we anyway should send it
-        #define __LOG_FRAGMENT()    \
-            LOG(debug, "sending fragment %10"PRIu32" [%6"PRIu32" = data %6"PRIu32" + head %3"PRIu32"]", (uint32_t)(_offset), (uint32_t)(_ip_hlength + sizeof(_udphdr) + _sending), (uint32_t)_sending, (uint32_t)(_ip_hlength + sizeof(_udphdr)))
+            LOG(error, "sink: %p sendmmsg failed cuz' %d [%s]", sink, errno, strerror(errno));
 
-        uint16_t _flags   = 0x0;
-        size_t   _sending = (_length > _mtu)?_mtu:_length;
+            switch (errno) {
+                case EPERM:
+                    LOG(warning, "... may be you want to remove \"no broadcast\" option");
+                    break;
 
-        _overhead += (_ip_hlength + sizeof(_udphdr));
+                case EMSGSIZE:
+                    LOG(warning, "... may be you want to use \"mtu\" option");
+                    break;
 
-        if (0 == (_length - _sending)) {
-            if (0 == _offset) {
-                if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite))
-                    _flags  |= IP_DONTFRAGMENT;
+                case EIO:
+                case EINVAL:
+                    if (1 < datagrams[_sent]) {
+                        //device can't checksum segments [or route's mtu is less], send unsegmented from now on
+                        LOG(warning, "... UDP_SEGMENT refused, datagrams won't be coalesced");
+                        __atomic_store_n(&_gsources_udp_segment, 0, __ATOMIC_RELAXED);
+                        break;
+                    }
+                    /* fall through */
 
-            } else {
-                __LOG_FRAGMENT();
+                default:
+                    //socket itself is broken, drop the rest and let _sink_start restore it
+                    sink->statistics->failed += _source_tx_datagrams(&(datagrams[_sent]), (count - _sent));
+                    _sink_stop(sink);
+                    return;
             }
 
-        } else {
-            /*  cuz' we do fragmentation, we must align sended data to 8 bytes boundary
-                just zero last 3 bits and set IP_FRAGMENT flag  */
+            //message related error, skip it and continue with the rest
+            sink->statistics->failed += datagrams[_sent];
+            _sent                    += 1;
+            continue;
+        }
 
-            _flags   |= IP_FRAGMENT;
-            _sending &= ~0x07;
+        for (int _i = 0; _i < _r_sendmmsg; ++_i, ++_sent) {
+            sink->statistics->sent += datagrams[_sent];
 
-            __LOG_FRAGMENT();
+            if (1 < datagrams[_sent])
+                sink->statistics->segmented += datagrams[_sent];
         }
 
-        htons_unaligned(&(_iphdr.frag_off), (uint16_t)((_flags & IP_FLAGS) | ((_offset >> 3) & IP_OFFSET)));
-
-        struct iovec   _iov[] = {{ &_iphdr, sizeof(_iphdr) }, { _ip_options, (_ip_hlength - sizeof(struct iphdr))}, { &_udphdr, sizeof(_udphdr) }, { _buffer, _sending }};
-        struct msghdr  _msg   = { target, sizeof(*target), _iov, 4, NULL, 0, 0 };
+        if (_sent < count) {
+            sink->statistics->partial += 1;
+            LOG(verbose, "sink: %p partial send, %lu of %lu queued", sink, (unsigned long)_sent, (unsigned long)count);
+        }
+    }
+}
 
-        FOREVER {
-            int _r_sendto = sendmsg(sink->socket, &_msg, 0);
+static inline void
+_source_tx_control (
+    BTH struct msghdr*                  msg,
+        int                             level,
+        int                             type,
+    IN  const void*                     value,
+        size_t                          length
+) {
+    struct cmsghdr* _cmsg = (struct cmsghdr*)((ubyte_t*)msg->msg_control + msg->msg_controllen);
 
-            if (0 > _r_sendto) {
-                if EINTR_IS(errno) continue; 
+    _cmsg->cmsg_level = level;
+    _cmsg->cmsg_type  = type;
+    _cmsg->cmsg_len   = CMSG_LEN(length);
 
-                LOG(error, "sendto failed cuz' %d [%s]", errno, strerror(errno));
+    memcpy(CMSG_DATA(_cmsg), value, length);
 
-                switch (errno) {
-                    case EPERM:
-                        LOG(warning, "... may be you want to remove \"no broadcast\" option");
-                        break;
+    msg->msg_controllen += CMSG_SPACE(length);
+}
 
-                    case EMSGSIZE:
-                        LOG(warning, "... may be you want to use \"mtu\" option");
-                        break;
+//groups queued payloads of udp transport sink, runs are coalesced [see KIM: udp transport]
+static size_t
+_source_tx_group_udp (
+    BTH ssource_tx*                     tx,
+    IN  ssink*                          sink,
+        size_t                          first,
+        size_t                          grouped,
+    BTH size_t*                         segment
+) {
+    int                _coalesce = __atomic_load_n(&_gsources_udp_segment, __ATOMIC_RELAXED);
+    _ssource_tx_entry* _run      = NULL;    //open run's first entry
+    size_t             _size     = 0;       //... its segment size
+    size_t             _total    = 0;       //... its payload
 
-                    default:
-                        _sink_stop(sink);
-                        break;
-                }
+    for (size_t _j = first; _j < tx->used; ++_j) {
+        _ssource_tx_entry* _entry = &(tx->entries[_j]);
 
-                return rsource_failed;
-            }
+        if (sink != _entry->sink)
+            continue;
 
-            break;
-        }
+        _entry->sink = NULL;
 
-        if ((0 == _offset) && (0 != (_flags & IP_FRAGMENT)) && (_ip_fragments != _ip_options)) {
-            //first fragment sended, correct mtu space and ip header length       
-            if (ripv4_ok != ipv4_option_padding(_ip_options, sizeof(_ip_options), &_ip_fragments)) {
-                LOG(debug, "can't pad fragment's options");
-                return rsource_failed;
-            }
+        size_t _length = _entry->iov[3].iov_len;
 
-            _ip_hlength = (sizeof(struct iphdr) + (_ip_fragments - _ip_options));
-            _mtu        = (_mtu_sink - (_ip_hlength + sizeof(struct udphdr)));
-            _iphdr.ihl  = (_ip_hlength >> 2);
+        tx->segments[*segment] = _entry->iov[3];
 
-            LOG_BINARY(debug, _ip_options, _ip_hlength - sizeof(struct iphdr), "first fragment sended, ip options recalculated");
-        }
+        //empty payload is no segment for kernel, it is sent alone
+        if (NOT_NULL_IS(_run) && (0 < _length) && (_length <= _size) && ((_total + _length) <= SOURCE_UDP_PAYLOAD))
+            if ((_run->target.sin_addr.s_addr == _entry->target.sin_addr.s_addr) && (_run->target.sin_port == _entry->target.sin_port))
+                if ((_run->iphdr.ttl == _entry->iphdr.ttl) && (_run->iphdr.tos == _entry->iphdr.tos)) {
+                    struct msghdr* _msg = &(tx->messages[grouped - 1].msg_hdr);
 
-        /** ok, we send fragment, so strafe agains buffer **/
-        _length -= _sending;
-        _offset += _sending;
-        _buffer += _sending;
+                    if (1 == tx->datagrams[grouped - 1]) {
+                        uint16_t _gso = (uint16_t)_size;
+                        _source_tx_control(_msg, SOL_UDP, UDP_SEGMENT, &_gso, sizeof(_gso));
+                    }
 
-    } while (_length > 0);
+                    _msg->msg_iovlen++;
+                    _total += _length;
+                    (*segment)++;
 
-    LOG(verbose, "sink: %p relayed, overhead %"PRIu32" bytes", sink, (uint32_t)_overhead);
-    return rsource_ok;
-}
+                    //shorter segment closes run
+                    if ((SOURCE_UDP_SEGMENTS == ++(tx->datagrams[grouped - 1])) || (_length < _size))
+                        _run = NULL;
 
-static rsource
-_source_relay_sink (
-    IN  ssink*                          sink,
-    BTH _ssource_udp_packet*            packet,
-        uint16_t                        port
-) {
-    if (ripv4_ok != ipv4_portrange_check(sink->portrange, ntohs(packet->destination.port))) {
-        LOG(verbose, "sink: %p rejected by port-range", sink);
-        return rsource_ok;
-    }
+                    continue;
+                }
 
-    switch (sink->type) {
-        case esink_type_simple: {
-            struct sockaddr_in  _target;
-            _target.sin_family      = AF_INET;
-            _target.sin_port        = port;
+        //new message
+        struct msghdr* _msg = &(tx->messages[grouped].msg_hdr);
 
-            if (0 == (FSINK_REWRITE_DESTINATION_ORIGINAL & sink->rewrite)) {
-                _target.sin_addr.s_addr = sink->ts.simple.target.address;
-            } else {
-                _target.sin_addr.s_addr = packet->destination.address;
-            }
+        memset(_msg, 0, sizeof(*_msg));
 
-            return _source_relay_sink_send(sink, packet, &_target);
-        }
+        _msg->msg_name          = &(_entry->target);
+        _msg->msg_namelen       = sizeof(_entry->target);
+        _msg->msg_iov           = &(tx->segments[*segment]);
+        _msg->msg_iovlen        = 1;
+        _msg->msg_control       = _entry->control.buffer;
 
-        case esink_type_join: {
-            rsource _return = rsource_failed;
+        int _ttl = _entry->iphdr.ttl;
+        int _tos = _entry->iphdr.tos;
 
-            //now we should check all addresses agains
-            for (srtlink_device_address* _address = rtlink_listener_address(&(sink->ts.join.runtime.device)); NULL != _address; _address = rtlink_device_address_next(_address)) {
-                if (ripv4_ok == ipv4_address_in_network(packet->destination.address, &(_address->network))) {
-                    LOG(verbose, "sink: rejected loop in %p", sink);
-                    _return = rsource_ok;
-                    continue;
-                }
+        if (0 != _ttl)
+            _source_tx_control(_msg, SOL_IP, IP_TTL, &_ttl, sizeof(_ttl));
 
-                struct sockaddr_in  _target;
-                _target.sin_family      = AF_INET;
-                _target.sin_addr.s_addr = _address->broadcast;
-                _target.sin_port        = port;
+        _source_tx_control(_msg, SOL_IP, IP_TOS, &_tos, sizeof(_tos));
 
-                if (rsource_ok != _source_relay_sink_send(sink, packet, &_target)) {
-                    LOG(verbose, "sink: relay failed %p", sink);
-                    continue;
-                }
+        tx->messages[grouped].msg_len = 0;
+        tx->datagrams[grouped]        = 1;
 
-                _return = rsource_ok;
-            }
+        grouped++;
+        (*segment)++;
 
-            return _return;
-        }
+        //segments must fit mtu, otherwise kernel refuses them
+        _run   = ((0 != _coalesce) && (0 < _length) && ((_length + sizeof(struct iphdr) + sizeof(struct udphdr)) <= sink->template.mtu))?_entry:NULL;
+        _size  = _length;
+        _total = _length;
     }
 
-    return rsource_failed;
+    return grouped;
 }
 
-static rsource
-_source_relay_sink_allowed (
-    IN  ssink*                          sink,
-    BTH _ssource_udp_packet*            packet
-) {
-    if (NULL != sink->allow) {
-        if (ripv4_ok != ipv4_allow_allowed_is(sink->allow, packet->from.sin_addr.s_addr, &(packet->destination))) {
-            LOG(verbose, "sink: rejected by allow in %p", sink);
-            return rsource_failed;
-        }
+/** KIM: packet transport
+        raw socket's datagram still passes routing, neighbour lookup & qdisc
+        one by one, while broadcast [or multicast] of sink on ethernet device
+        needs none of them: its hardware destination is known. sink with
+        packet transport writes such datagrams as complete frames [ethernet
+        header prebuilt with device's address learned by rtlink, ip checksum
+        computed] into its own af-packet tx ring, ring is kicked once per
+        flush. lanes are single writers, so each has its own ring.
+
+        other destinations, datagrams longer than device's mtu or without
+        source address [kernel would choose it] are routed by raw socket as
+        usual, so is everything while ring is full. frames bypass netfilter
+        & local delivery, so "fwmark" and local listeners don't see them
+**/
 
-        return rsource_ok;
-    }
+//target whose broadcast [or any multicast] is destination, NULL - datagram is routed
+static inline const ssink_target*
+_sink_frame_target (
+    IN  const ssink*                    sink,
+        ipv4_t                          destination
+) {
+    if (0 == sink->template.count)
+        return NULL;
 
-    switch (sink->type) {
-        case esink_type_simple:
-            if (0 == (FSINK_REWRITE_DESTINATION_ORIGINAL & sink->rewrite))
-                if (ripv4_ok == ipv4_address_in_network(packet->destination.address, &(sink->ts.simple.target))) {
-                    LOG(verbose, "sink: rejected loop in %p", sink);
-                    return rsource_failed;
-                }
+    if ((INADDR_BROADCAST == destination) || (ripv4_ok == ipv4_address_in_network(destination, &IPV4_NETWORK_ALL_MULTICAST)))
+        return &(sink->template.targets[0]);
 
-            return rsource_ok;
+    for (size_t _i = 0; _i < sink->template.count; ++_i) {
+        const ssink_target* _target = &(sink->template.targets[_i]);
 
-        case esink_type_join:
-            //KIM: will be checked in _source_relay_sink while iterating via addresses
-            return rsource_ok;
+        if ((IPV4_MASK(32) != _target->network.mask) && (destination == ipv4_network_broadcast(&(_target->network))))
+            return _target;
     }
 
-    return rsource_failed;
+    return NULL;
 }
 
-static rsource
-_source_relay (
-    BTH ssource*                        source,
-    BTH _ssource_udp_packet*            packet,
-    BTH spoll_passthrou*                passthrou
+/*  lane's ids are lane + 1 + n * lanes, all within 16 bits and never 0, so lanes
+    stay in own residue class after wrap for any number of lanes */
+static inline uint16_t
+_sink_ip_id_next (
+    BTH ssink*                          sink
 ) {
-    //now, as packet allowed, we should check for ratelimit
-    if (NULL != source->ratelimit)
-        if (rratelimit_allowed != ratelimit(source->ratelimit, 1, &(passthrou->time))) {
-            LOG(verbose, "source: %p rejected by rate-limit", source); //TODO(iybego#0): protect itself with ratelimit and change to warning
-            return rsource_ok;
-        }
+    uint16_t _id   = sink->last_ip_id;
+    uint32_t _next = ((uint32_t)_id + sink->ip_id_step);
 
-    for (ssink* _target = source->sinks; NULL != _target; _target = _target->next) {
-        if (rsource_ok != _source_relay_sink_allowed(_target, packet))
-            continue;
+    sink->last_ip_id = (uint16_t)((UINT16_MAX < _next)?((uint32_t)((_id - 1) % sink->ip_id_step) + 1):_next);
+    return _id;
+}
 
-        uint16_t _port = _target->port;
+//ethernet, ip [with options] & udp headers of queued datagram, its payload follows them
+static void
+_source_tx_frame_headers (
+    BTH ssink*                          sink,
+    IN  const _ssource_tx_entry*        entry,
+        ipv4_t                          source,
+    OUT ubyte_t*                        data
+) {
+    ssink_cold* _cold        = sink->cold;
+    ipv4_t      _destination = entry->target.sin_addr.s_addr;
+    size_t      _header      = (sizeof(struct iphdr) + entry->iov[1].iov_len);
+    ubyte_t*    _ip          = (data + ETHER_HDR_LEN);
 
-        if (0 == _port)
-            _port = packet->destination.port;
+    memcpy(data, _cold->packet.ethernet, ETHER_HDR_LEN);
 
-        if (0 == _port)
-            _port = source->port;
+    if (INADDR_BROADCAST != _destination)
+        if (ripv4_ok == ipv4_address_in_network(_destination, &IPV4_NETWORK_ALL_MULTICAST)) {
+            const ubyte_t* _group = (const ubyte_t*)&_destination;
 
-        if (0 == _port) {
-            LOG(warning, "sink: %p left port unresolved!");
-            continue;
+            data[0] = 0x01; data[1] = 0x00; data[2] = 0x5E;
+            data[3] = (_group[1] & 0x7F);
+            data[4] = _group[2];
+            data[5] = _group[3];
         }
 
-        if (rsource_ok != _source_relay_sink(_target, packet, _port))
-            LOG(verbose, "sink: %p relay failed", source);
-    }
+    struct iphdr* _iphdr = (struct iphdr*)_ip;
 
-    return rsource_ok;
+    memcpy(_ip,                         &(entry->iphdr),  sizeof(struct iphdr));
+    memcpy(_ip + sizeof(struct iphdr),  entry->options,   entry->iov[1].iov_len);
+    memcpy(_ip + _header,               &(entry->udphdr), entry->iov[2].iov_len);
+
+    u32_unaligned(&(_iphdr->saddr), source);
+
+    //zero id is filled by kernel for raw socket only
+    if (0 == unaligned_u16(&(_iphdr->id)))
+        htons_unaligned(&(_iphdr->id), _sink_ip_id_next(sink));
+
+    u16_unaligned(&(_iphdr->check), 0);
+    htons_unaligned(&(_iphdr->check), ipv4_checksum(_ip, _header));
 }
 
+//payload received into umem is sent from the same frame [see KIM: af-xdp source]
 static rsource
-_source_proceed_listener_addresses (
-    BTH ssource*                        source,
-    BTH _ssource_udp_packet*            packet,
-    BTH spoll_passthrou*                passthrou,
-    BTH srtlink_listener*               listener
+_source_tx_post (
+    BTH ssink*                          sink,
+    IN  const _ssource_tx_entry*        entry,
+        ipv4_t                          source,
+        size_t                          headers
 ) {
-    for (srtlink_device_address* _address = rtlink_listener_address(listener); NULL != _address; _address = rtlink_device_address_next(_address)) {
-        LOG(debug, "... network "IPV4_PRIADDR"/"IPV4_PRIADDR, IPV4_DPRIADDR(_address->network.address), IPV4_DPRIADDR(_address->network.mask));
+    ssink_cold*  _cold = sink->cold;
+    ssource_xdp* _xdp  = _cold->packet.xdp;
 
-        if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(_address->network))) {
-            LOG(debug, "... from network");
+    if SOCKET_INVALID_IS(_cold->packet.xsk.socket)
+        return rsource_failed;
 
-            if (packet->destination.address == _address->broadcast) {
-                LOG(debug, "... to broadcast");
-                return _source_relay(source, packet, passthrou);
-            }
-        }
-    }
+    const ubyte_t* _payload = (const ubyte_t*)entry->iov[3].iov_base;
+
+    if ((_payload < _xdp->umem.area) || (_payload >= (_xdp->umem.area + _xdp->umem.size)))
+        return rsource_failed;
+
+    size_t _offset = (size_t)(_payload - _xdp->umem.area);
+    size_t _frame  = (_offset / _xdp->umem.frame_size);
+
+    if ((_frame == _xdp->current) || NOT_NULL_IS(_xdp->holders[_frame]))
+        return rsource_failed;
+
+    //fill ring keeps rx budget at least, otherwise rx would stall [see KIM: af-xdp source]
+    if ((_xdp->held + SOURCE_MAX_PACKETS_PER_TICK) >= _xdp->umem.frames)
+        return rsource_failed;
+
+    //received headers are shorter [sink adds ip options]
+    if ((_offset - (_frame * _xdp->umem.frame_size)) < headers)
+        return rsource_failed;
+
+    sxdp_ring* _tx = &(_cold->packet.xsk.tx);
+
+    if (0 == xdp_ring_free(_tx))
+        return rsource_failed;
+
+    _source_tx_frame_headers(sink, entry, source, (ubyte_t*)_payload - headers);
+
+    struct xdp_desc* _descriptor = xdp_ring_descriptor(_tx, _tx->head++);
+
+    _descriptor->addr    = (uint64_t)(_offset - headers);
+    _descriptor->len     = (uint32_t)(headers + entry->iov[3].iov_len);
+    _descriptor->options = 0;
+
+    _xdp->holders[_frame] = sink;
+    _xdp->held++;
+    _cold->packet.posted++;
 
-    LOG(debug, "addresses iterating failed");
     return rsource_ok;
 }
 
+//writes queued datagram into sink's tx ring [see KIM: packet transport], failure - route it
 static rsource
-_source_proceed (
-    BTH ssource*                        source,
-    BTH _ssource_udp_packet*            packet,
-    BTH spoll_passthrou*                passthrou
+_source_tx_frame (
+    BTH ssink*                          sink,
+    IN  const _ssource_tx_entry*        entry
 ) {
-    if (ripv4_ok != ipv4_portrange_check(source->portrange, ntohs(packet->destination.port))) {
-        LOG(verbose, "source: rejected by port-range");
-        return rsource_ok;
-    }
+    ssink_cold* _cold = sink->cold;
 
-    if (NULL != source->allow) {
-        if (ripv4_ok == ipv4_allow_allowed_is(source->allow, packet->from.sin_addr.s_addr, &(packet->destination)))
-            return _source_relay(source, packet, passthrou);
+    if (0 == _cold->packet.mtu)
+        return rsource_failed;
 
-        LOG(verbose, "source: rejected by allow");
-        return rsource_ok;
-    }
+    ipv4_t              _destination = entry->target.sin_addr.s_addr;
+    const ssink_target* _target      = _sink_frame_target(sink, _destination);
 
-    //if we subscribe to multicast check if packet targeted to subscribed networks and allow it
+    if NULL_IS(_target)
+        return rsource_failed;
 
-    if (NULL != source->mgroups) {
-        if (ripv4_ok == ipv4_address_in_network(packet->destination.address, &IPV4_NETWORK_ALL_MULTICAST))
-            for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; _mgroup = _mgroup->next)
-                if (_mgroup->group == packet->destination.address) {
-                    LOG(debug, "source: accepted by m-group "IPV4_PRIADDR, IPV4_DPRIADDR(_mgroup->group));
+    //"no broadcast" is enforced by raw socket [EACCES], so broadcasts go there
+    if ((0 == (FSOCKET_BROADCAST & _cold->flg_socket)) && (ripv4_ok != ipv4_address_in_network(_destination, &IPV4_NETWORK_ALL_MULTICAST)))
+        return rsource_failed;
+
+    ipv4_t _source = unaligned_u32(&(entry->iphdr.saddr));
+
+    //join's targets are device's addresses, simple's one is configured network
+    if (0 == _source) {
+        if (esink_type_join != sink->type)
+            return rsource_failed;
+
+        _source = _target->network.address;
+    }
+
+    size_t _header  = (sizeof(struct iphdr) + entry->iov[1].iov_len);
+    size_t _headers = (ETHER_HDR_LEN + _header + entry->iov[2].iov_len);
+    size_t _length  = (_header + entry->iov[2].iov_len + entry->iov[3].iov_len);
+
+    if (_length > _cold->packet.mtu)
+        return rsource_failed;
+
+    //headers of non-first fragment would overwrite payload of previous one
+    if ((sizeof(struct udphdr) == entry->iov[2].iov_len) && (rsource_ok == _source_tx_post(sink, entry, _source, _headers)))
+        return rsource_ok;
+
+    if SOCKET_INVALID_IS(_cold->packet.socket)
+        return rsource_failed;
+
+    ssocket_ring*        _ring  = &(_cold->packet.ring);
+    struct tpacket2_hdr* _frame = (struct tpacket2_hdr*)(_ring->map + (_ring->current * _ring->block_size));
+
+    //frame is kernel's until device frees it
+    if (TP_STATUS_AVAILABLE != __atomic_load_n(&(_frame->tp_status), __ATOMIC_ACQUIRE))
+        return rsource_failed;
+
+    ubyte_t* _data = ((ubyte_t*)_frame + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+
+    _source_tx_frame_headers(sink, entry, _source, _data);
+    memcpy(_data + _headers, entry->iov[3].iov_base, entry->iov[3].iov_len);
+
+    _frame->tp_len = (uint32_t)(ETHER_HDR_LEN + _length);
+    __atomic_store_n(&(_frame->tp_status), TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    _ring->current = ((_ring->current + 1) % _ring->blocks);
+    return rsource_ok;
+}
+
+static void
+_source_tx_kick (
+    BTH ssink*                          sink,
+        size_t                          framed
+) {
+    ssink_cold* _cold   = sink->cold;
+    size_t      _posted = _cold->packet.posted;
+
+    if (0 == framed)
+        return;
+
+    _cold->packet.posted = 0;
+
+    if (0 < _posted) {
+        xdp_ring_submit(&(_cold->packet.xsk.tx));
+
+        if (rxdp_ok != xdp_socket_kick(&(_cold->packet.xsk)))
+            goto _failed;
+    }
+
+    if (_posted < framed)
+        if (rsocket_ok != socket_packet_kick(_cold->packet.socket, _cold->packet.index))
+            goto _failed;
+
+    sink->statistics->sent   += framed;
+    sink->statistics->framed += framed;
+    sink->statistics->posted += _posted;
+
+    return;
+
+    _failed:
+        //ring is broken, drop its frames and let _sink_start restore it
+        sink->statistics->failed += framed;
+        _sink_stop(sink);
+}
+
+static void
+_source_tx_flush (
+    BTH ssource*                        source
+) {
+    ssource_tx* _tx = source->tx;
+
+    if (0 == _tx->used)
+        return;
+
+    LOG(debug, "source: %p flushing %lu queued datagrams", source, (unsigned long)_tx->used);
+
+    //group queued datagrams by sink [order inside a sink is preserved], one sendmmsg per group
+    size_t _grouped = 0;
+    size_t _segment = 0;
+
+    for (size_t _i = 0; _i < _tx->used; ++_i) {
+        ssink* _sink = _tx->entries[_i].sink;
+
+        if NULL_IS(_sink)
+            continue;
+
+        size_t _first  = _grouped;
+        size_t _framed = 0;
+
+        //sinks' histograms are allocated with source's ones, so cold part is touched only when enabled
+        uint64_t _queued = NULL_IS(source->timing)?0:_source_clock(CLOCK_MONOTONIC_RAW);
+
+        if (0 != (FSINK_REWRITE_TRANSPORT_UDP & _sink->rewrite)) {
+            _grouped = _source_tx_group_udp(_tx, _sink, _i, _grouped, &_segment);
+
+        } else {
+            int _packet = (0 != (FSINK_REWRITE_TRANSPORT_PACKET & _sink->rewrite));
+
+            for (size_t _j = _i; _j < _tx->used; ++_j)
+                if (_sink == _tx->entries[_j].sink) {
+                    _tx->entries[_j].sink = NULL;
+
+                    if (_packet && (rsource_ok == _source_tx_frame(_sink, &(_tx->entries[_j])))) {
+                        _framed++;
+                        continue;
+                    }
+
+                    _tx->messages[_grouped].msg_hdr = _tx->entries[_j].msg;
+                    _tx->messages[_grouped].msg_len = 0;
+                    _tx->datagrams[_grouped]        = 1;
+
+                    _grouped++;
+                }
+        }
+
+        _source_tx_kick(_sink, _framed);
+
+        if SOCKET_INVALID_IS(_sink->socket) {
+            _sink->statistics->failed += _source_tx_datagrams(&(_tx->datagrams[_first]), (_grouped - _first));
+            continue;
+        }
+
+        _source_tx_send(_sink, &(_tx->messages[_first]), &(_tx->datagrams[_first]), (_grouped - _first));
+
+        if NULL_IS(source->timing)
+            continue;
+
+        histogram_record(&(_sink->cold->timing->queue), _queued - source->timing->begin, (_grouped - _first) + _framed);
+        histogram_record(&(_sink->cold->timing->send),  _source_clock(CLOCK_MONOTONIC_RAW) - _queued, (_grouped - _first) + _framed);
+    }
+
+    _tx->used = 0;
+}
+
+static inline _ssource_tx_entry*
+_source_tx_entry (
+    BTH ssource*                        source,
+    BTH ssink*                          sink
+) {
+    if (source->tx->used == source->tx->depth)
+        _source_tx_flush(source);
+
+    _ssource_tx_entry* _entry = &(source->tx->entries[source->tx->used++]);
+    _entry->sink = sink;
+
+    return _entry;
+}
+
+static rsource
+_source_relay_sink_ip_options_cached (
+    BTH ssink*                          sink,
+    BTH _ssource_udp_packet*            packet,
+    OUT ubyte_t*                        options,
+        size_t*                         length,
+        ubyte_t**                       fragments
+) {
+    size_t _key_length = packet->options_length;
+
+    if (NULL_IS(packet->options) || (0 != (FSINK_REWRITE_NO_IP_OPTIONS & sink->rewrite)))
+        _key_length = 0; //received options doesn't matter
+
+    if (IPV4_MAX_OPTIONS_LENGTH < _key_length)
+        return _source_relay_sink_ip_options(sink, packet, options, length, fragments);
+
+    uint32_t       _hash  = (0 == _key_length)?0:packet->options_hash;
+    ssink_options* _entry = &(sink->cold->options[_hash % SINK_OPTIONS_CACHE_SIZE]);
+
+    if (0 != _entry->valid)
+        if ((_hash == _entry->hash) && (_key_length == _entry->key_length))
+            if (0 == memcmp(_entry->key, packet->options, _key_length)) {
+                memcpy(options, _entry->options, _entry->length);
+
+                (*length)    = (sizeof(struct iphdr) + _entry->length);
+                (*fragments) = (options + _entry->fragments);
+
+                return rsource_ok;
+            }
+
+    if (rsource_ok != _source_relay_sink_ip_options(sink, packet, options, length, fragments))
+        return rsource_failed;
+
+    LOG(debug, "sink: %p ip options cached [%08"PRIx32"]", sink, _hash);
+
+    _entry->valid       = 1;
+    _entry->hash        = _hash;
+    _entry->key_length  = (uint8_t)_key_length;
+    _entry->length      = (uint8_t)((*length) - sizeof(struct iphdr));
+    _entry->fragments   = (uint8_t)((*fragments) - options);
+
+    memcpy(_entry->key,     packet->options, _key_length);
+    memcpy(_entry->options, options,         _entry->length);
+
+    return rsource_ok;
+}
+
+//payload is queued as is, kernel builds headers [see KIM: udp transport]
+static rsource
+_source_relay_sink_send_udp (
+    BTH ssource*                        source,
+    BTH ssink*                          sink,
+    IN  ssink_target*                   target,
+    BTH _ssource_udp_packet*            packet,
+        uint16_t                        port
+) {
+    uint32_t _mtu_sink = sink->template.mtu;
+    uint32_t _patch    = sink->template.patch;
+
+    if (_mtu_sink <= (sizeof(struct iphdr) + sizeof(struct udphdr))) {
+        LOG(error, "sink %p: mtu too small to fit atleast headers", sink);
+        LOG(warning, " ^ increase mtu to atleast %"PRIu32, (uint32_t)(sizeof(struct iphdr) + sizeof(struct udphdr)));
+
+        return rsource_failed;
+    }
+
+    int _fragmented = (packet->length > (_mtu_sink - (sizeof(struct iphdr) + sizeof(struct udphdr))));
+
+    if (_fragmented)
+        if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite)) {
+            LOG(verbose, "sink: %p message rejected, cuz' fragmentation required", sink);
+            sink->statistics->rejected_mtu++;
+
+            return rsource_ok;
+        }
+
+    uint8_t _ttl = target->iphdr.ttl;
+    uint8_t _tos = target->iphdr.tos;
+
+    if (0 != (FSINK_TEMPLATE_TTL & _patch)) {
+        if (packet->ttl < 2) {
+            LOG(verbose, "sink: %p message rejected due to low ttl", sink);
+            sink->statistics->rejected_ttl++;
+
+            return rsource_ok; //this isn't failure
+        }
+
+        _ttl = (packet->ttl - 1);
+    }
+
+    if (0 != (FSINK_TEMPLATE_TOS & _patch))
+        _tos = packet->tos;
+
+    _ssource_tx_entry* _entry = _source_tx_entry(source, sink);
+
+    memcpy(&(_entry->target), &(target->address), sizeof(_entry->target));
+
+    if (0 != (FSINK_TEMPLATE_DADDR & _patch))
+        _entry->target.sin_addr.s_addr = packet->destination.address;
+
+    _entry->target.sin_port = port;
+
+    _entry->iphdr.ttl       = _ttl;
+    _entry->iphdr.tos       = _tos;
+
+    _entry->iov[3].iov_base = packet->buffer;
+    _entry->iov[3].iov_len  = packet->length;
+
+    sink->statistics->relayed++;
+
+    if (_fragmented)
+        sink->statistics->fragmented++;
+
+    LOG(verbose, "sink %p: queued to "IPV4_PRIADDR":%"PRIu16" [udp]", sink, IPV4_DPRIADDR(_entry->target.sin_addr.s_addr), htons(port));
+    return rsource_ok;
+}
+
+static rsource
+_source_relay_sink_send (
+    BTH ssource*                        source,
+    BTH ssink*                          sink,
+    IN  ssink_target*                   target,
+    BTH _ssource_udp_packet*            packet,
+        uint16_t                        port
+) {
+    if (0 != (FSINK_REWRITE_TRANSPORT_UDP & sink->rewrite))
+        return _source_relay_sink_send_udp(source, sink, target, packet, port);
+
+    //----- first, fast check mtu
+    uint32_t _mtu_sink = sink->template.mtu;
+    uint32_t _patch    = sink->template.patch;
+
+    ubyte_t  _ip_options[IPV4_MAX_OPTIONS_LENGTH];
+    ubyte_t* _ip_fragments = _ip_options;  
+
+    size_t   _ip_hlength   = sizeof(struct iphdr); //in 32bits
+
+    if (rsource_ok != _source_relay_sink_ip_options_cached(sink, packet, _ip_options, &_ip_hlength, &_ip_fragments)) {
+        LOG(error, "can't fill ip options");
+        return rsource_failed;
+    }
+
+    LOG_BINARY(debug, _ip_options, _ip_hlength - sizeof(struct iphdr), "starting with ip options");
+
+    LOG(debug, "sink %p: mtu is %"PRIu32, sink, (uint32_t)_mtu_sink);
+
+    if (_mtu_sink <= (_ip_hlength + sizeof(struct udphdr))) {
+        LOG(error, "sink %p: mtu too small to fit atleast headers", sink);
+        LOG(warning, " ^ increase mtu to atleast %"PRIu32, (uint32_t)(_ip_hlength + sizeof(struct udphdr)));
+
+        return rsource_failed;
+    }
+
+    uint32_t _mtu = (_mtu_sink - (_ip_hlength + sizeof(struct udphdr)));
+
+    if (packet->length > _mtu)
+        if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite)) {
+            LOG(verbose, "sink: %p message rejected, cuz' fragmentation required", sink);
+            sink->statistics->rejected_mtu++;
+
+            if (0 == (FSINK_REWRITE_NO_ICMP_FRAGMENTATION & sink->rewrite)) {
+
+            }
+
+            return rsource_ok;
+        }
+
+    //----- patch prebuilt headers
+    struct iphdr        _iphdr;
+    struct udphdr       _udphdr;
+    struct sockaddr_in  _address;
+
+    memcpy(&_iphdr,   &(target->iphdr),   sizeof(_iphdr));
+    memcpy(&_udphdr,  &(target->udphdr),  sizeof(_udphdr));
+    memcpy(&_address, &(target->address), sizeof(_address));
+
+    if (0 != (FSINK_TEMPLATE_TTL & _patch)) {
+        if (packet->ttl < 2) {
+            LOG(verbose, "sink: %p message rejected due to low ttl", sink);
+            sink->statistics->rejected_ttl++;
+
+            if (0 == (FSINK_REWRITE_NO_ICMP_TTL & sink->rewrite)) {
+
+            }
+
+            return rsource_ok; //this isn't failure
+        }
+
+        _iphdr.ttl = (packet->ttl - 1);
+    }
+
+    if (0 != (FSINK_TEMPLATE_TOS & _patch))
+        _iphdr.tos = packet->tos;
+
+    uint16_t _ip_id = packet->id;
+
+    //zero id is filled by kernel per datagram, so fragments would never be reassembled
+    if ((0 == (FSINK_TEMPLATE_ID & _patch)) || ((0 == _ip_id) && (packet->length > _mtu)))
+        _ip_id = htons(_sink_ip_id_next(sink));
+
+    u16_unaligned(&(_iphdr.id), _ip_id);
+
+    if (0 != (FSINK_TEMPLATE_SADDR & _patch))
+        u32_unaligned(&(_iphdr.saddr), packet->from.sin_addr.s_addr);
+
+    if (0 != (FSINK_TEMPLATE_SPORT & _patch))
+        u16_unaligned(&(_udphdr.source), packet->from.sin_port);
+
+    if (0 != (FSINK_TEMPLATE_DADDR & _patch)) {
+        _address.sin_addr.s_addr = packet->destination.address;
+        u32_unaligned(&(_iphdr.daddr), _address.sin_addr.s_addr);
+    }
+
+    _address.sin_port = port;
+    u16_unaligned(&(_udphdr.dest), port);
+
+    htons_unaligned(&(_udphdr.len), (sizeof(_udphdr) + packet->length));
+
+    //----- queue fragmented[if needed] packet
+    ubyte_t* _buffer    = packet->buffer;
+    size_t   _length    = packet->length;
+    size_t   _offset    = 0; //in ip payload, so udp header counted
+    size_t   _overhead  = 0;
+    size_t   _fragments = 0;
+
+    LOG(verbose, "sink %p: sending from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16, sink, 
+            IPV4_DPRIADDR(unaligned_u32(&(_iphdr.saddr))), htons(unaligned_u16(&(_udphdr.source)))
+        ,   IPV4_DPRIADDR(_address.sin_addr.s_addr), htons(_address.sin_port)
+    );
+    
+    _iphdr.ihl = (_ip_hlength >> 2);
+
+    do { //if packet have zero size, we anyway should send it
+        #define __LOG_FRAGMENT()    \
+            LOG(debug, "queue fragment %10"PRIu32" [%6"PRIu32" = data %6"PRIu32" + head %3"PRIu32"]", (uint32_t)(_offset), (uint32_t)(_ip_hlength + _head + _sending), (uint32_t)_sending, (uint32_t)(_ip_hlength + _head))
+
+        uint16_t _flags   = 0x0;
+        size_t   _head    = (0 == _offset)?sizeof(_udphdr):0;   //only first fragment carries udp header
+        size_t   _space   = (_mtu_sink - (_ip_hlength + _head));
+        size_t   _sending = (_length > _space)?_space:_length;
+
+        _overhead += (_ip_hlength + _head);
+        _fragments++;
+
+        if (0 == (_length - _sending)) {
+            if (0 == _offset) {
+                if (0 != (FSINK_REWRITE_NO_FRAGMENT & sink->rewrite))
+                    _flags  |= IP_DONTFRAGMENT;
+
+            } else {
+                __LOG_FRAGMENT();
+            }
+
+        } else {
+            /*  cuz' we do fragmentation, we must align sended data to 8 bytes boundary
+                just zero last 3 bits and set IP_FRAGMENT flag [udp header is 8 bytes, so alignment kept] */
+
+            _flags   |= IP_FRAGMENT;
+            _sending &= ~0x07;
+
+            __LOG_FRAGMENT();
+        }
+
+        #undef __LOG_FRAGMENT
+
+        _ssource_tx_entry* _entry = _source_tx_entry(source, sink);
+
+        memcpy(&(_entry->iphdr),  &_iphdr,  sizeof(_iphdr));
+        memcpy(&(_entry->udphdr), &_udphdr, sizeof(_udphdr));
+        memcpy(&(_entry->target), &_address, sizeof(_address));
+        memcpy(_entry->options,   _ip_options, (_ip_hlength - sizeof(struct iphdr)));
+
+        htons_unaligned(&(_entry->iphdr.frag_off), (uint16_t)((_flags & IP_FLAGS) | ((_offset >> 3) & IP_OFFSET)));
+        htons_unaligned(&(_entry->iphdr.tot_len),  (uint16_t)(_ip_hlength + _head + _sending));
+
+        _entry->iov[1].iov_len  = (_ip_hlength - sizeof(struct iphdr));
+        _entry->iov[2].iov_len  = _head;
+        _entry->iov[3].iov_base = _buffer;
+        _entry->iov[3].iov_len  = _sending;
+
+        if ((0 == _offset) && (0 != (_flags & IP_FRAGMENT)) && (_ip_fragments != _ip_options)) {
+            //first fragment queued, correct ip header length for the rest
+            if (ripv4_ok != ipv4_option_padding(_ip_options, sizeof(_ip_options), &_ip_fragments)) {
+                LOG(debug, "can't pad fragment's options");
+                return rsource_failed;
+            }
+
+            _ip_hlength = (sizeof(struct iphdr) + (_ip_fragments - _ip_options));
+            _iphdr.ihl  = (_ip_hlength >> 2);
+
+            LOG_BINARY(debug, _ip_options, _ip_hlength - sizeof(struct iphdr), "first fragment queued, ip options recalculated");
+        }
+
+        /** ok, we queue fragment, so strafe agains buffer **/
+        _length -= _sending;
+        _offset += (_head + _sending);
+        _buffer += _sending;
+
+    } while (_length > 0);
+
+    sink->statistics->relayed++;
+
+    if (1 < _fragments)
+        sink->statistics->fragmented++;
+
+    LOG(verbose, "sink: %p queued, overhead %"PRIu32" bytes", sink, (uint32_t)_overhead);
+    return rsource_ok;
+}
+
+static _ssource_flow_sink*
+_source_flow_record (
+    BTH _ssource_udp_packet*            packet,
+    IN  ssink*                          sink,
+        uint16_t                        port
+) {
+    _ssource_flow* _flow = packet->flow;
+
+    if NULL_IS(_flow)
+        return NULL;
+
+    if (SOURCE_FLOW_SINKS <= _flow->count) {
+        _flow->generation = 0;
+        packet->flow      = NULL;
+        return NULL;
+    }
+
+    _ssource_flow_sink* _record = &(_flow->sinks[_flow->count++]);
+
+    _record->sink     = sink;
+    _record->port     = port;
+    _record->targets  = 0;
+    _record->loops    = 0;
+    _record->rejected = NULL;
+
+    return _record;
+}
+
+//counts rejection by sink and keeps it in flow, so cached flow counts it too
+static inline void
+_source_flow_sink_reject (
+    BTH _ssource_udp_packet*            packet,
+    IN  ssink*                          sink,
+    BTH uint64_t*                       counter
+) {
+    (*counter)++;
+
+    _ssource_flow_sink* _record = _source_flow_record(packet, sink, 0);
+
+    if (NULL != _record)
+        _record->rejected = counter;
+}
+
+//counts rejection by source and keeps it in flow
+static inline void
+_source_flow_reject (
+    BTH _ssource_udp_packet*            packet,
+    BTH uint64_t*                       counter
+) {
+    (*counter)++;
+
+    if (NULL != packet->flow)
+        packet->flow->rejected = counter;
+}
+
+static inline void
+_source_flow_discard (
+    BTH _ssource_udp_packet*            packet
+) {
+    if NULL_IS(packet->flow)
+        return;
+
+    packet->flow->generation = 0;
+    packet->flow             = NULL;
+}
+
+static rsource
+_source_relay_sink (
+    BTH ssource*                        source,
+    BTH ssink*                          sink,
+    BTH _ssource_udp_packet*            packet,
+        uint16_t                        port
+) {
+    if (ripv4_ok != ipv4_ports_check(sink->ports, ntohs(packet->destination.port))) {
+        LOG(verbose, "sink: %p rejected by port-range", sink);
+
+        _source_flow_sink_reject(packet, sink, &(sink->statistics->rejected_portrange));
+        return rsource_ok;
+    }
+
+    _ssource_flow_sink* _record = _source_flow_record(packet, sink, port);
+
+    //----- restore sink's socket [and its template]
+    if (rsource_ok != _sink_start(sink)) {
+        LOG(verbose, "sink: %p can't start sink", sink);
+
+        _source_flow_discard(packet);
+        return rsource_failed;
+    }
+
+    switch (sink->type) {
+        case esink_type_simple:
+            if (NULL != _record)
+                _record->targets = 1;
+
+            return _source_relay_sink_send(source, sink, &(sink->template.targets[0]), packet, port);
+
+        case esink_type_join: {
+            rsource _return = rsource_failed;
+
+            if ((NULL != _record) && (64 < sink->template.count))
+                _source_flow_discard(packet);
+
+            //now we should check all addresses agains
+            for (size_t _i = 0; _i < sink->template.count; ++_i) {
+                ssink_target* _target = &(sink->template.targets[_i]);
+
+                if (ripv4_ok == ipv4_address_in_network(packet->destination.address, &(_target->network))) {
+                    LOG(verbose, "sink: rejected loop in %p", sink);
+                    sink->statistics->rejected_loop++;
+
+                    if (NULL != packet->flow)
+                        _record->loops++;
+
+                    _return = rsource_ok;
+                    continue;
+                }
+
+                if (NULL != packet->flow)
+                    _record->targets |= (((uint64_t)1) << _i);
+
+                if (rsource_ok != _source_relay_sink_send(source, sink, _target, packet, port)) {
+                    LOG(verbose, "sink: relay failed %p", sink);
+                    continue;
+                }
+
+                _return = rsource_ok;
+            }
+
+            return _return;
+        }
+    }
+
+    return rsource_failed;
+}
+
+//simple sink's target, from template while it's built, so cold part isn't touched
+static inline const sipv4_network*
+_sink_target_network (
+    IN  const ssink*                    sink
+) {
+    if (0 < sink->template.count)
+        return &(sink->template.targets[0].network);
+
+    return &(sink->cold->ts.simple.target);
+}
+
+static inline ripv4
+_source_allowed_is (
+    IN  const sipv4_allow*              allow,
+    IN  const sipv4_classifier*         classifier,
+    BTH _ssource_udp_packet*            packet
+) {
+    if (NULL != classifier)
+        return ipv4_classifier_allowed_is(classifier, packet->from.sin_addr.s_addr, &(packet->destination));
+
+    return ipv4_allow_allowed_is(allow, packet->from.sin_addr.s_addr, &(packet->destination));
+}
+
+static rsource
+_source_relay_sink_allowed (
+    IN  ssink*                          sink,
+    BTH _ssource_udp_packet*            packet
+) {
+    if (0 != sink->filtered) {
+        if (ripv4_ok != _source_allowed_is(sink->cold->allow, sink->cold->classifier, packet)) {
+            LOG(verbose, "sink: rejected by allow in %p", sink);
+
+            _source_flow_sink_reject(packet, sink, &(sink->statistics->rejected_allow));
+            return rsource_failed;
+        }
+
+        return rsource_ok;
+    }
+
+    switch (sink->type) {
+        case esink_type_simple:
+            if (0 == (FSINK_REWRITE_DESTINATION_ORIGINAL & sink->rewrite))
+                if (ripv4_ok == ipv4_address_in_network(packet->destination.address, _sink_target_network(sink))) {
+                    LOG(verbose, "sink: rejected loop in %p", sink);
+
+                    _source_flow_sink_reject(packet, sink, &(sink->statistics->rejected_loop));
+                    return rsource_failed;
+                }
+
+            return rsource_ok;
+
+        case esink_type_join:
+            //KIM: will be checked in _source_relay_sink while iterating via addresses
+            return rsource_ok;
+    }
+
+    return rsource_failed;
+}
+
+static rsource
+_source_relay_admit (
+    BTH ssource*                        source,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    //now, as packet allowed, we should check for ratelimit
+    if (NULL != source->ratelimit) {
+        if (NULL != source->ratelimit_guard)
+            pthread_mutex_lock(source->ratelimit_guard);
+
+        rratelimit _allowed = ratelimit(source->ratelimit, 1, &(passthrou->time));
+
+        if (NULL != source->ratelimit_guard)
+            pthread_mutex_unlock(source->ratelimit_guard);
+
+        if (rratelimit_allowed != _allowed) {
+            LOG(verbose, "source: %p rejected by rate-limit", source); //TODO(iybego#0): protect itself with ratelimit and change to warning
+            source->statistics->rejected_ratelimit++;
+            return rsource_failed;
+        }
+    }
+
+    source->statistics->relayed++;
+
+    packet->options_hash = 0;
+
+    if (NOT_NULL_IS(packet->options) && (0 < packet->options_length))
+        packet->options_hash = hash32_jenkins(packet->options, packet->options_length);
+
+    return rsource_ok;
+}
+
+static rsource
+_source_relay (
+    BTH ssource*                        source,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    if (NULL != packet->flow)
+        packet->flow->accepted = 1;
+
+    if (rsource_ok != _source_relay_admit(source, packet, passthrou)) {
+        //sinks weren't checked, so decision is incomplete
+        _source_flow_discard(packet);
+        return rsource_ok;
+    }
+
+    for (ssink* _target = source->sinks; NULL != _target; _target = _target->next) {
+        if (rsource_ok != _source_relay_sink_allowed(_target, packet))
+            continue;
+
+        uint16_t _port = _target->port;
+
+        if (0 == _port)
+            _port = packet->destination.port;
+
+        if (0 == _port)
+            _port = source->port;
+
+        if (0 == _port) {
+            LOG(warning, "sink: %p left port unresolved!");
+            continue;
+        }
+
+        if (rsource_ok != _source_relay_sink(source, _target, packet, _port))
+            LOG(verbose, "sink: %p relay failed", source);
+    }
+
+    return rsource_ok;
+}
+
+static rsource
+_source_relay_cached (
+    BTH ssource*                        source,
+    IN  _ssource_flow*                  flow,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    if (0 == flow->accepted) {
+        LOG(verbose, "source: rejected by cached flow");
+
+        if (NULL != flow->rejected)
+            (*flow->rejected)++;
+
+        return rsource_ok;
+    }
+
+    if (rsource_ok != _source_relay_admit(source, packet, passthrou))
+        return rsource_ok;
+
+    for (size_t _i = 0; _i < flow->count; ++_i) {
+        const _ssource_flow_sink* _record = &(flow->sinks[_i]);
+        ssink*                    _sink   = _record->sink;
+
+        if (NULL != _record->rejected) {
+            (*_record->rejected)++;
+            continue;
+        }
+
+        _sink->statistics->rejected_loop += _record->loops;
+
+        if (rsource_ok != _sink_start(_sink)) {
+            LOG(verbose, "sink: %p can't start sink", _sink);
+            continue;
+        }
+
+        //sink was restarted and its template rebuilt, targets are stale
+        if (flow->generation != _sources_generation()) {
+            if (rsource_ok != _source_relay_sink(source, _sink, packet, _record->port))
+                LOG(verbose, "sink: %p relay failed", source);
+
+            continue;
+        }
+
+        for (size_t _t = 0; (_t < _sink->template.count) && (_t < 64); ++_t)
+            if (0 != (_record->targets & (((uint64_t)1) << _t)))
+                if (rsource_ok != _source_relay_sink_send(source, _sink, &(_sink->template.targets[_t]), packet, _record->port))
+                    LOG(verbose, "sink: relay failed %p", _sink);
+    }
+
+    return rsource_ok;
+}
+
+//ok if packet is sent from listener's network to its broadcast
+static ripv4
+_source_proceed_listener_addresses (
+    IN  _ssource_udp_packet*            packet,
+    BTH srtlink_listener*               listener
+) {
+    for (srtlink_device_address* _address = rtlink_listener_address(listener); NULL != _address; _address = rtlink_device_address_next(_address)) {
+        LOG(debug, "... network "IPV4_PRIADDR"/"IPV4_PRIADDR, IPV4_DPRIADDR(_address->network.address), IPV4_DPRIADDR(_address->network.mask));
+
+        if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(_address->network))) {
+            LOG(debug, "... from network");
+
+            if (packet->destination.address == _address->broadcast) {
+                LOG(debug, "... to broadcast");
+                return ripv4_ok;
+            }
+        }
+    }
+
+    LOG(debug, "addresses iterating failed");
+    return ripv4_failed;
+}
+
+static rsource
+_source_proceed_decide (
+    BTH ssource*                        source,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    if (ripv4_ok != ipv4_ports_check(source->ports, ntohs(packet->destination.port))) {
+        LOG(verbose, "source: rejected by port-range");
+
+        _source_flow_reject(packet, &(source->statistics->rejected_portrange));
+        return rsource_ok;
+    }
+
+    if (NULL != source->allow) {
+        if (ripv4_ok == _source_allowed_is(source->allow, source->classifier, packet))
+            return _source_relay(source, packet, passthrou);
+
+        LOG(verbose, "source: rejected by allow");
+
+        _source_flow_reject(packet, &(source->statistics->rejected_allow));
+        return rsource_ok;
+    }
+
+    //if we subscribe to multicast check if packet targeted to subscribed networks and allow it
+
+    if (NULL != source->mgroups) {
+        if (ripv4_ok == ipv4_address_in_network(packet->destination.address, &IPV4_NETWORK_ALL_MULTICAST))
+            for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; _mgroup = _mgroup->next)
+                if (_mgroup->group == packet->destination.address) {
+                    LOG(debug, "source: accepted by m-group "IPV4_PRIADDR, IPV4_DPRIADDR(_mgroup->group));
                     return _source_relay(source, packet, passthrou);
                 }
     }
 
-    //if no allow declaration avalible we must use sinks as allow list:
-    //  find allowed networks and check for martians packets - ...
-    //  ... packets wich received from non-connected network
-    // but if we binded to device, we can check only its addresses
+    //if no allow declaration avalible we must use sinks as allow list:
+    //  find allowed networks and check for martians packets - ...
+    //  ... packets wich received from non-connected network
+    // but if we binded to device, we can check only its addresses
+
+    if RTLINK_LISTENER_ATTACHED(&(source->ss.runtime.device)) {
+        if (ripv4_ok == _source_proceed_listener_addresses(packet, &(source->ss.runtime.device)))
+            return _source_relay(source, packet, passthrou);
+
+        LOG(verbose, "source: rejected martian");
+
+        _source_flow_reject(packet, &(source->statistics->rejected_allow));
+        return rsource_ok;
+    }
+
+    if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(source->binding)))
+        for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+            switch (_sink->type) {
+                case esink_type_simple:
+                    //if sink is simple, use its target itself as allow
+
+                    LOG(debug, "sink "IPV4_PRIADDR"/"IPV4_PRIADDR, IPV4_DPRIADDR(_sink->cold->ts.simple.target.address), IPV4_DPRIADDR(_sink->cold->ts.simple.target.mask));
+
+                    if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(_sink->cold->ts.simple.target))) {
+                        LOG(debug, "... from network");
+
+                        if (packet->destination.address == ipv4_network_broadcast(&(_sink->cold->ts.simple.target))) {
+                            LOG(debug, "... to broadcast");
+                            return _source_relay(source, packet, passthrou);
+                        }
+                    }
+
+                    break;
+
+                case esink_type_join:
+                    LOG(debug, "join, checking addresses");
+
+                    if (ripv4_ok == _source_proceed_listener_addresses(packet, &(_sink->cold->ts.join.runtime.device)))
+                        return _source_relay(source, packet, passthrou);
+
+                    break;
+            }
+
+    LOG(verbose, "source: rejected by sinks");
+
+    _source_flow_reject(packet, &(source->statistics->rejected_allow));
+    return rsource_ok;
+}
+
+static rsource
+_source_proceed (
+    BTH ssource*                        source,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    packet->flow = NULL;
+
+    if NULL_IS(source->flows)
+        return _source_proceed_decide(source, packet, passthrou);
+
+    shash32_jenkins _hash;
+
+    hash32_jenkins_begin(&_hash);
+    hash32_jenkins_append(&_hash, &(packet->from.sin_addr.s_addr), sizeof(packet->from.sin_addr.s_addr));
+    hash32_jenkins_append(&_hash, &(packet->destination.address),  sizeof(packet->destination.address));
+    hash32_jenkins_append(&_hash, &(packet->destination.port),     sizeof(packet->destination.port));
+
+    _ssource_flow* _flow       = &(source->flows->entries[hash32_jenkins_end(&_hash) & (SOURCE_FLOW_CACHE_SIZE - 1)]);
+    uint32_t       _generation = _sources_generation();
+
+    if (    (_generation                    == _flow->generation)
+        &&  (packet->from.sin_addr.s_addr   == _flow->from)
+        &&  (packet->destination.address    == _flow->destination)
+        &&  (packet->destination.port       == _flow->port)
+    ) {
+        source->statistics->flow_hit++;
+        return _source_relay_cached(source, _flow, packet, passthrou);
+    }
+
+    source->statistics->flow_miss++;
+
+    _flow->generation   = _generation;
+    _flow->from         = packet->from.sin_addr.s_addr;
+    _flow->destination  = packet->destination.address;
+    _flow->port         = packet->destination.port;
+    _flow->accepted     = 0;
+    _flow->count        = 0;
+    _flow->rejected     = NULL;
+
+    packet->flow = _flow;
+
+    rsource _return = _source_proceed_decide(source, packet, passthrou);
+
+    if (rsource_ok != _return)
+        _source_flow_discard(packet);
+
+    return _return;
+}
+
+static inline size_t
+_source_packet_segments (
+    IN  const _ssource_udp_packet*      packet
+) {
+    if ((0 == packet->segment) || (packet->length <= packet->segment))
+        return 1;
+
+    return ((packet->length + packet->segment - 1) / packet->segment);
+}
+
+//coalesced datagram is relayed segment by segment from the same buffer [see KIM: udp gro]
+static rsource
+_source_proceed_segments (
+    BTH ssource*                        source,
+    BTH _ssource_udp_packet*            packet,
+    BTH spoll_passthrou*                passthrou
+) {
+    if ((0 == packet->segment) || (packet->length <= packet->segment))
+        return _source_proceed(source, packet, passthrou);
+
+    ubyte_t* _buffer = (ubyte_t*)packet->buffer;
+    size_t   _length = packet->length;
+
+    while (0 < _length) {
+        packet->buffer = _buffer;
+        packet->length = (_length > packet->segment)?packet->segment:_length;
+
+        if (rsource_ok != _source_proceed(source, packet, passthrou))
+            return rsource_failed;
+
+        _buffer += packet->length;
+        _length -= packet->length;
+    }
+
+    return rsource_ok;
+}
+
+static rsource
+_source_packet_simple (
+    IN  ssource*                        source,
+    BTH struct msghdr*                  msg,
+        int                             length,
+    OUT _ssource_udp_packet*            packet
+) {
+    if (0 != msg->msg_flags) {
+        if (0 != (msg->msg_flags & MSG_CTRUNC)) {
+            LOG(error, "control truncated, please check SOURCE_SIMPLE_CONTROL_LENGTH constant!");
+        }
+
+        if (0 != (msg->msg_flags & MSG_TRUNC)) {
+            LOG(warning, "message truncated! increase buffer size to %d [at least]", length);
+            return rsource_failed;
+        }
+    }
+
+    if (rsource_ok != _control_information(msg, packet)) {
+        LOG(error, "message ignored, cuz' unable to resolve required control information");
+        return rsource_failed;
+    }
+
+    LOG(verbose, "simple: %p received %d bytes, from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16
+        , source, length, IPV4_DPRIADDR(packet->from.sin_addr.s_addr), ntohs(packet->from.sin_port)
+        , IPV4_DPRIADDR(packet->destination.address), ntohs(packet->destination.port)
+    );
+
+    packet->id              = 0;
+    packet->buffer          = msg->msg_iov[0].iov_base;
+    packet->length          = (unsigned)length;
+
+    size_t _segments = _source_packet_segments(packet);
+
+    //received counts datagrams, so coalesced ones are counted by segments
+    if (1 < _segments) {
+        source->statistics->received  += (_segments - 1);
+        source->statistics->coalesced += _segments;
+    }
+
+    return rsource_ok;
+}
+
+//ip datagram [raw socket or af-packet ring], packet's from & received are filled by caller
+static rsource
+_source_packet_ip (
+    IN  ssource*                        source,
+    BTH ubyte_t*                        buffer,
+        int                             length,
+    OUT _ssource_udp_packet*            packet
+) {
+    //this is little paranoic, cuz' system must not send packet to userspace if it broken
+    // but it add so small overhead, so i don't remove it
+    if (20 > length) {
+        LOG(error, "data too small to be packet");
+        return rsource_failed;
+    }
+
+    struct iphdr* _iphdr = (struct iphdr*)buffer;
+
+    if (unaligned_htons(&(_iphdr->tot_len)) != length) {
+        LOG(error, "wrong packet size");
+        return rsource_failed;
+    }
+
+    if (5 > _iphdr->ihl) {
+        LOG(error, "wrong ihl value %u", (unsigned int)_iphdr->ihl);
+        return rsource_failed;
+    }
+
+    packet->options         = NULL;
+    packet->options_length  = 0;
+    packet->segment         = 0;
+
+    if (5 < _iphdr->ihl)
+        if (0 != (source->flg_socket & FSOCKET_RECVOPTIONS)) {
+            packet->options         = (buffer + sizeof(struct iphdr));
+            packet->options_length  = (_iphdr->ihl - 5) * 4;
+        }
+
+    /*ubyte_t _ip_options_test[] = {0x09, 0x02, 0x09, 0x02, 0x09, 0x02, 0x09, 0x02, 0x09, 0x20, 0x09, 0x02};
+    packet->options         = _ip_options_test;
+    packet->options_length  = sizeof(_ip_options_test);
+    */
+
+    size_t _shift = (_iphdr->ihl * 4);
+
+    if ((unsigned)length < (_shift + sizeof(struct udphdr))) {
+        LOG(error, "udp header doesn't fit to buffer");
+        return rsource_failed;
+    }
+
+    struct udphdr* _udphdr = (struct udphdr*)(buffer + _shift);
+
+    uint16_t _udphdr_length = unaligned_htons(&(_udphdr->len));
+
+    if (sizeof(struct udphdr) > _udphdr_length) {
+        LOG(error, "wrong udp length");
+        return rsource_failed;
+    }
+
+    if ((unsigned)length < (_shift + _udphdr_length - sizeof(struct udphdr))) {
+        LOG(error, "udp data doesn't fit to buffer");
+        return rsource_failed;
+    }
+
+    _shift += sizeof(struct udphdr);
+
+    packet->buffer = buffer + _shift;
+    packet->length = length - _shift;
+
+    packet->id     = unaligned_u16(&(_iphdr->id));
+
+    packet->tos    = _iphdr->tos;
+    if (0 == (source->flg_socket & FSOCKET_RECVTOS))
+        packet->tos = 0x00;
+
+    packet->ttl    = _iphdr->ttl;
+    if (0 == (source->flg_socket & FSOCKET_RECVTTL))
+        if (rsysctl_ok != ipv4_default_ttl(&(packet->ttl))) {
+            LOG(error, "receiving of ttl disabled, but default ttl resolving failed");
+            return rsource_failed;
+        }
+
+    packet->destination.address = unaligned_u32(&(_iphdr->daddr));
+    packet->destination.port    = unaligned_u16(&(_udphdr->dest));
+
+    //this is strange, but we should fix it
+    if (0 == packet->from.sin_addr.s_addr)
+        packet->from.sin_addr.s_addr = unaligned_u32(&(_iphdr->saddr));
+
+    if (0 == packet->from.sin_port)
+        packet->from.sin_port = unaligned_u16(&(_udphdr->source));
+
+    if (AF_INET != packet->from.sin_family)
+        packet->from.sin_family = AF_INET;
+
+    LOG(verbose, "raw: %p received %d bytes, from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16
+        , source, length, IPV4_DPRIADDR(packet->from.sin_addr.s_addr), ntohs(packet->from.sin_port)
+        , IPV4_DPRIADDR(packet->destination.address), ntohs(packet->destination.port)
+    );
+
+    return rsource_ok;
+}
+
+static rsource
+_source_packet_raw (
+    IN  ssource*                        source,
+    BTH struct msghdr*                  msg,
+        int                             length,
+    OUT _ssource_udp_packet*            packet
+) {
+    if (0 != msg->msg_flags)
+        if (0 != (msg->msg_flags & MSG_TRUNC)) {
+            LOG(warning, "message truncated! increase buffer size to %d [at least]", length);
+            return rsource_failed;
+        }
+
+    packet->received = 0;
+
+    //header is in datagram itself, so only timestamp is passed as control
+    for (struct cmsghdr* _cmsg = CMSG_FIRSTHDR(msg); NULL != _cmsg; _cmsg = CMSG_NXTHDR(msg, _cmsg))
+        if ( (SOL_SOCKET == _cmsg->cmsg_level) && (SCM_TIMESTAMPNS == _cmsg->cmsg_type) )
+            _control_timestamp(_cmsg, packet);
+
+    return _source_packet_ip(source, (ubyte_t*)msg->msg_iov[0].iov_base, length, packet);
+}
+
+//frame of af-packet ring, datagram isn't copied [see KIM: af-packet ring]
+static rsource
+_source_packet_ring (
+    IN  ssource*                        source,
+    IN  struct tpacket3_hdr*            frame,
+    OUT _ssource_udp_packet*            packet
+) {
+    ubyte_t* _buffer = ((ubyte_t*)frame + frame->tp_net);
+    size_t   _length = frame->tp_snaplen;
+
+    if (frame->tp_snaplen < frame->tp_len) {
+        LOG(warning, "ring frame truncated [%"PRIu32" of %"PRIu32"], increase ring block size", frame->tp_snaplen, frame->tp_len);
+        return rsource_failed;
+    }
+
+    if (sizeof(struct iphdr) > _length) {
+        LOG(error, "data too small to be packet");
+        return rsource_failed;
+    }
+
+    struct iphdr* _iphdr = (struct iphdr*)_buffer;
+
+    //link layer padding isn't trimmed yet [ip_rcv does it later]
+    if (unaligned_htons(&(_iphdr->tot_len)) < _length)
+        _length = unaligned_htons(&(_iphdr->tot_len));
+
+    memset(&(packet->from), 0, sizeof(packet->from));
+
+    packet->received = ((uint64_t)frame->tp_sec * 1000000000ULL) + frame->tp_nsec;
+
+    return _source_packet_ip(source, _buffer, (int)_length, packet);
+}
+
+//frame of af-xdp umem, datagram isn't copied [see KIM: af-xdp source]
+static rsource
+_source_packet_xdp (
+    IN  ssource*                        source,
+    BTH ubyte_t*                        frame,
+        size_t                          length,
+    OUT _ssource_udp_packet*            packet
+) {
+    if ((ETHER_HDR_LEN + sizeof(struct iphdr)) > length) {
+        LOG(error, "data too small to be packet");
+        return rsource_failed;
+    }
+
+    //program redirects ip frames only, so it's paranoic too
+    if (ETHERTYPE_IP != unaligned_htons((const uint16_t*)(frame + offsetof(struct ether_header, ether_type)))) {
+        LOG(error, "frame isn't ip");
+        return rsource_failed;
+    }
+
+    ubyte_t*      _buffer = (frame + ETHER_HDR_LEN);
+    size_t        _length = (length - ETHER_HDR_LEN);
+    struct iphdr* _iphdr  = (struct iphdr*)_buffer;
+
+    //link layer padding isn't trimmed
+    if (unaligned_htons(&(_iphdr->tot_len)) < _length)
+        _length = unaligned_htons(&(_iphdr->tot_len));
+
+    memset(&(packet->from), 0, sizeof(packet->from));
+
+    packet->received = 0;
+
+    return _source_packet_ip(source, _buffer, (int)_length, packet);
+}
+
+//frames which filter drops [see filter_packet], checked again: filter is best effort
+static inline int
+_source_ring_frame_foreign (
+    IN  struct tpacket3_hdr*            frame
+) {
+    const struct sockaddr_ll* _link  = (const struct sockaddr_ll*)((ubyte_t*)frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+    const struct iphdr*       _iphdr = (const struct iphdr*)((ubyte_t*)frame + frame->tp_net);
+
+    if (PACKET_OUTGOING == _link->sll_pkttype)
+        return 1;
+
+    if (sizeof(struct iphdr) > frame->tp_snaplen)
+        return 0; //malformed
+
+    return ((IPPROTO_UDP != _iphdr->protocol) || (0 != (unaligned_htons(&(_iphdr->frag_off)) & (IP_FRAGMENT | IP_OFFSET))));
+}
+
+static rpoll_handler
+_source_poll_handler_simple (
+    BTH ssource*                        source,
+    BTH spollable*                      pollable,
+    BTH spoll_passthrou*                passthrou
+) {
+    LOG(debug, "source simple %p", source);
+
+    for (size_t _current_packet_per_tick = SOURCE_MAX_PACKETS_PER_TICK; _current_packet_per_tick--; ) {
+        _ssource_udp_packet _packet;
+
+        char                _control[SOURCE_SIMPLE_CONTROL_LENGTH];
+
+        struct iovec        _iov = {passthrou->buffer, passthrou->length};
+        struct msghdr       _msg = { &(_packet.from), sizeof(_packet.from), &_iov, 1, _control, sizeof(_control), 0};
+
+        int _length = recvmsg(pollable_socket(pollable), &_msg, (MSG_DONTWAIT | MSG_TRUNC | MSG_CTRUNC));
+
+        if (0  > _length) {
+            if EINTR_IS      (errno) continue;
+
+            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
+            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+
+            LOG(error, "recvmsg failed, cuz' %d [%s]", errno, strerror(errno));
+            return rpoll_handler_failed;
+        }
+
+        source->statistics->received++;
+        _source_latency_begin(source);
+
+        if (rsource_ok != _source_packet_simple(source, &_msg, _length, &_packet)) {
+            source->statistics->malformed++;
+            continue;
+        }
+
+        _source_latency_queued(source, &_packet);
+
+        size_t  _segments = _source_packet_segments(&_packet);
+        rsource _r        = _source_proceed_segments(source, &_packet, passthrou);
+
+        //payload lives in thread buffer, so it must leave before next receive
+        _source_tx_flush(source);
+        _source_latency_end(source, _segments);
+
+        if (rsource_ok != _r)
+            return rpoll_handler_failed;
+    }
+
+    LOG(verbose, "simple: %p packet per tick limit exceeded", source);
+    return rpoll_handler_ok;
+}
+
+static rpoll_handler
+_source_poll_handler_raw (
+    BTH ssource*                        source,
+    BTH spollable*                      pollable,
+    BTH spoll_passthrou*                passthrou
+) {
+    for (size_t _current_packet_per_tick = SOURCE_MAX_PACKETS_PER_TICK; _current_packet_per_tick--; ) {
+        _ssource_udp_packet _packet;
+
+        char                _control[SOURCE_RAW_CONTROL_LENGTH];
+
+        struct iovec        _iov = {passthrou->buffer, passthrou->length};
+        struct msghdr       _msg = { &(_packet.from), sizeof(_packet.from), &_iov, 1, _control, sizeof(_control), 0};
+
+        int _length = recvmsg(pollable_socket(pollable), &_msg, (MSG_DONTWAIT | MSG_TRUNC));
+
+        if (0  > _length) {
+            if EINTR_IS      (errno) continue;
+            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
+            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+
+            LOG(error, "recvmsg failed, cuz' %d [%s]", errno, strerror(errno));
+            return rpoll_handler_failed;
+        }
+
+        source->statistics->received++;
+        _source_latency_begin(source);
+
+        if (rsource_ok != _source_packet_raw(source, &_msg, _length, &_packet)) {
+            source->statistics->malformed++;
+            continue;
+        }
+
+        _source_latency_queued(source, &_packet);
+
+        rsource _r = _source_proceed(source, &_packet, passthrou);
+
+        _source_tx_flush(source);
+        _source_latency_end(source, 1);
+
+        if (rsource_ok != _r)
+            return rpoll_handler_failed;
+    }
+
+    LOG(verbose, "raw: %p packet per tick limit exceeded", source);
+    return rpoll_handler_ok;
+}
+
+//whole blocks are processed, upto packet per tick limit [see KIM: af-packet ring]
+static rpoll_handler
+_source_poll_handler_ring (
+    BTH ssource*                        source,
+    BTH spollable*                      pollable,
+    BTH spoll_passthrou*                passthrou
+) {
+    ssocket_ring* _ring   = &(source->ring);
+    size_t        _budget = SOURCE_MAX_PACKETS_PER_TICK;
+
+    (void)pollable;
+
+    for (size_t _blocks = _ring->blocks; (0 < _blocks) && (0 < _budget); --_blocks) {
+        struct tpacket_block_desc* _block = (struct tpacket_block_desc*)(_ring->map + (_ring->current * _ring->block_size));
+
+        if (0 == (TP_STATUS_USER & __atomic_load_n(&(_block->hdr.bh1.block_status), __ATOMIC_ACQUIRE)))
+            return rpoll_handler_ok;
+
+        _source_latency_begin(source);
+
+        uint32_t             _count  = _block->hdr.bh1.num_pkts;
+        struct tpacket3_hdr* _frame  = (struct tpacket3_hdr*)((ubyte_t*)_block + _block->hdr.bh1.offset_to_first_pkt);
+        size_t               _parsed = 0;
+        rsource              _r      = rsource_ok;
+
+        LOG(debug, "ring: %p block %lu, %"PRIu32" frames", source, (unsigned long)_ring->current, _count);
+
+        for (uint32_t _i = 0; _i < _count; ++_i, _frame = (struct tpacket3_hdr*)((ubyte_t*)_frame + _frame->tp_next_offset)) {
+            _ssource_udp_packet _packet;
+
+            if (_source_ring_frame_foreign(_frame))
+                continue;
+
+            source->statistics->received++;
+
+            if (rsource_ok != _source_packet_ring(source, _frame, &_packet)) {
+                source->statistics->malformed++;
+                continue;
+            }
+
+            _source_latency_queued(source, &_packet);
+            _parsed++;
+
+            if (rsource_ok != (_r = _source_proceed(source, &_packet, passthrou)))
+                break;
+        }
+
+        //payloads live in the block, so they must leave before it's returned to kernel
+        _source_tx_flush(source);
+        _source_latency_end(source, _parsed);
+
+        __atomic_store_n(&(_block->hdr.bh1.block_status), TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        _ring->current = ((_ring->current + 1) % _ring->blocks);
+
+        if (rsource_ok != _r)
+            return rpoll_handler_failed;
+
+        _budget -= (_count < _budget)?_count:_budget;
+    }
+
+    LOG(verbose, "ring: %p packet per tick limit exceeded", source);
+    return rpoll_handler_ok;
+}
+
+//sinks' sent frames return to fill ring [see KIM: af-xdp source]
+static void
+_source_xdp_reclaim (
+    BTH ssource*                        source
+) {
+    ssource_xdp* _xdp = source->xdp;
+
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        sxdp_socket* _xsk = &(_sink->cold->packet.xsk);
+
+        if SOCKET_INVALID_IS(_xsk->socket)
+            continue;
+
+        //descriptors left by previous kick
+        if (0 < xdp_ring_pending(&(_xsk->tx)))
+            xdp_socket_kick(_xsk);
+
+        for (uint32_t _ready = xdp_ring_ready(&(_xsk->completion)); 0 < _ready; --_ready) {
+            size_t _frame = (size_t)((*xdp_ring_address(&(_xsk->completion), _xsk->completion.head++)) / _xdp->umem.frame_size);
+
+            _xdp->holders[_frame] = NULL;
+            _xdp->held--;
+            _source_xdp_refill(_xdp, _frame);
+        }
+
+        xdp_ring_release(&(_xsk->completion));
+    }
+
+    xdp_ring_submit(&(_xdp->socket.fill));
+}
+
+static void
+_source_xdp_arm (
+    BTH ssource*                        source
+) {
+    ssource_xdp* _xdp = source->xdp;
+
+    if ((0 != _xdp->armed) || (0 == _xdp->held))
+        return;
+
+    if (rtimer_ok == timer_arm(&(source->xdp_timer), SOURCE_XDP_RECLAIM * TIMER_SHIFT_MSEC))
+        _xdp->armed = 1;
+}
+
+//completions are reclaimed while rx is idle [see KIM: af-xdp source]
+static rtimer
+_source_xdp_tick (
+        stimer*                         timer
+) {
+    ssource* _source = CONTAINEROF(timer, ssource, xdp_timer);
+
+    if NULL_IS(_source->xdp)
+        return rtimer_ok;
+
+    _source->xdp->armed = 0;
+
+    _source_xdp_reclaim(_source);
+    _source_xdp_arm(_source);
+
+    return rtimer_ok;
+}
+
+static rpoll_handler
+_source_poll_handler_xdp (
+    BTH ssource*                        source,
+    BTH spollable*                      pollable,
+    BTH spoll_passthrou*                passthrou
+) {
+    ssource_xdp* _xdp    = source->xdp;
+    sxdp_ring*   _rx     = &(_xdp->socket.rx);
+    size_t       _budget = SOURCE_MAX_PACKETS_PER_TICK;
+
+    (void)pollable;
+
+    _source_xdp_reclaim(source);
+
+    while (0 < _budget) {
+        uint32_t _ready = xdp_ring_ready(_rx);
+
+        if (0 == _ready)
+            return rpoll_handler_ok;
+
+        if (_ready > _budget)
+            _ready = (uint32_t)_budget;
+
+        _source_latency_begin(source);
+
+        size_t  _parsed = 0;
+        rsource _r      = rsource_ok;
+
+        _xdp->batch = 1;
+
+        for (uint32_t _i = 0; (_i < _ready) && (rsource_ok == _r); ++_i) {
+            const struct xdp_desc* _descriptor = xdp_ring_descriptor(_rx, _rx->head + _i);
+            _ssource_udp_packet    _packet;
+
+            _xdp->current = (size_t)(_descriptor->addr / _xdp->umem.frame_size);
+
+            source->statistics->received++;
+
+            if (rsource_ok != _source_packet_xdp(source, _xdp->umem.area + _descriptor->addr, _descriptor->len, &_packet)) {
+                source->statistics->malformed++;
+                continue;
+            }
+
+            _parsed++;
+            _r = _source_proceed(source, &_packet, passthrou);
+        }
+
+        //payloads live in frames, so they must leave [or be held by sinks] before frames are refilled
+        _xdp->current = _xdp->umem.frames;
+
+        _source_tx_flush(source);
+        _source_latency_end(source, _parsed);
+
+        _xdp->batch = 0;
+
+        for (uint32_t _i = 0; _i < _ready; ++_i) {
+            size_t _frame = (size_t)(xdp_ring_descriptor(_rx, _rx->head++)->addr / _xdp->umem.frame_size);
+
+            if NULL_IS(_xdp->holders[_frame])
+                _source_xdp_refill(_xdp, _frame);
+        }
+
+        //frames of sinks stopped during batch, each is refilled once here
+        if (0 != _xdp->released) {
+            _xdp->released = 0;
+
+            for (size_t _i = 0; _i < _xdp->umem.frames; ++_i)
+                if (SOURCE_XDP_RELEASED == _xdp->holders[_i]) {
+                    _xdp->holders[_i] = NULL;
+                    _xdp->held--;
+                    _source_xdp_refill(_xdp, _i);
+                }
+        }
+
+        xdp_ring_release(_rx);
+        xdp_ring_submit(&(_xdp->socket.fill));
+
+        _source_xdp_arm(source);
+
+        if (rsource_ok != _r)
+            return rpoll_handler_failed;
+
+        _budget -= _ready;
+    }
+
+    LOG(verbose, "xdp: %p packet per tick limit exceeded", source);
+    return rpoll_handler_ok;
+}
+
+//--------------------------------------------- batched receive [recvmmsg]
+
+struct _source_batch {
+    size_t                              depth;
+
+    struct mmsghdr*                     messages;
+    struct iovec*                       iov;
+    _ssource_udp_packet*                packets;
+
+    ubyte_t*                            controls;   //each slot have own control area...
+    size_t                              control_length;
+
+    ubyte_t*                            buffers;    //... and own buffer
+    size_t                              buffer_size;
+};
+
+static void
+_source_batch_free (
+    BTH ssource_batch*                  batch
+) {
+    if NULL_IS(batch)
+        return;
+
+    free(batch->messages);
+    free(batch->iov);
+    free(batch->packets);
+    free(batch->controls);
+    free(batch->buffers);
+    free(batch);
+}
+
+static ssource_batch*
+_source_batch_allocate (
+        size_t                          depth,
+        size_t                          buffer_size,
+        size_t                          control_length
+) {
+    ssource_batch* _batch = (ssource_batch*)calloc(1, sizeof(ssource_batch));
+
+    if NULL_IS(_batch) {
+        LOG(critical, "out of memory: batch [%lu]", (unsigned long)sizeof(ssource_batch));
+        return NULL;
+    }
+
+    _batch->depth           = depth;
+    _batch->buffer_size     = buffer_size;
+    _batch->control_length  = control_length;
+
+    _batch->messages        = (struct mmsghdr*)calloc(depth, sizeof(struct mmsghdr));
+    _batch->iov             = (struct iovec*)calloc(depth, sizeof(struct iovec));
+    _batch->packets         = (_ssource_udp_packet*)calloc(depth, sizeof(_ssource_udp_packet));
+    _batch->buffers         = (ubyte_t*)malloc(depth * buffer_size);
+
+    if (0 < control_length)
+        _batch->controls    = (ubyte_t*)malloc(depth * control_length);
+
+    if (NULL_IS(_batch->messages) || NULL_IS(_batch->iov) || NULL_IS(_batch->packets) || NULL_IS(_batch->buffers) || (NULL_IS(_batch->controls) && (0 < control_length))) {
+        LOG(critical, "out of memory: batch of %lu [%lu bytes per slot]", (unsigned long)depth, (unsigned long)(buffer_size + control_length));
+
+        _source_batch_free(_batch);
+        return NULL;
+    }
+
+    for (size_t _i = 0; _i < depth; ++_i) {
+        struct msghdr* _msg = &(_batch->messages[_i].msg_hdr);
+
+        _batch->iov[_i].iov_base    = &(_batch->buffers[_i * buffer_size]);
+        _batch->iov[_i].iov_len     = buffer_size;
+
+        _msg->msg_name              = &(_batch->packets[_i].from);
+        _msg->msg_iov               = &(_batch->iov[_i]);
+        _msg->msg_iovlen            = 1;
+        _msg->msg_control           = (0 < control_length)?&(_batch->controls[_i * control_length]):NULL;
+    }
+
+    return _batch;
+}
+
+static inline void
+_source_batch_rewind (
+    BTH ssource_batch*                  batch,
+        size_t                          depth
+) {
+    for (size_t _i = 0; _i < depth; ++_i) {
+        struct msghdr* _msg = &(batch->messages[_i].msg_hdr);
+
+        _msg->msg_namelen    = sizeof(struct sockaddr_in);
+        _msg->msg_controllen = batch->control_length;
+        _msg->msg_flags      = 0;
+    }
+}
+
+static rpoll_handler
+_source_poll_handler_batch (
+    BTH ssource*                        source,
+    BTH spollable*                      pollable,
+    BTH spoll_passthrou*                passthrou
+) {
+    ssource_batch* _batch = source->rx;
+
+    for (size_t _budget = SOURCE_MAX_PACKETS_PER_TICK; 0 < _budget; ) {
+        size_t _depth = (_budget < _batch->depth)?_budget:_batch->depth;
+
+        _source_batch_rewind(_batch, _depth);
+
+        int _received = recvmmsg(pollable_socket(pollable), _batch->messages, _depth, (MSG_DONTWAIT | MSG_TRUNC), NULL);
+
+        if (0  > _received) {
+            if EINTR_IS      (errno) continue;
+            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
+            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+
+            LOG(error, "recvmmsg failed, cuz' %d [%s]", errno, strerror(errno));
+            return rpoll_handler_failed;
+        }
+
+        LOG(debug, "batch: %p received %d datagrams", source, _received);
+
+        _source_latency_begin(source);
+
+        size_t _parsed = 0;
+
+        //first resolve whole batch, then relay it
+        for (size_t _i = 0; _i < (unsigned)_received; ++_i) {
+            struct mmsghdr*      _message = &(_batch->messages[_i]);
+            _ssource_udp_packet* _packet  = &(_batch->packets[_i]);
+
+            rsource _r = rsource_failed;
+
+            switch (source->type) {
+                case esource_type_simple:
+                    _r = _source_packet_simple(source, &(_message->msg_hdr), _message->msg_len, _packet);
+                    break;
+
+                case esource_type_raw:
+                    _r = _source_packet_raw(source, &(_message->msg_hdr), _message->msg_len, _packet);
+                    break;
+            }
+
+            if (rsource_ok != _r) {
+                _packet->buffer = NULL; //ignored
+                source->statistics->malformed++;
+                continue;
+            }
+
+            _source_latency_queued(source, _packet);
+            _parsed += _source_packet_segments(_packet);
+        }
+
+        source->statistics->received += (unsigned)_received;
+
+        for (size_t _i = 0; _i < (unsigned)_received; ++_i) {
+            if NULL_IS(_batch->packets[_i].buffer)
+                continue;
+
+            if (rsource_ok != _source_proceed_segments(source, &(_batch->packets[_i]), passthrou)) {
+                _source_tx_flush(source);
+                return rpoll_handler_failed;
+            }
+        }
+
+        //whole batch relayed from own buffers, so one flush for it
+        _source_tx_flush(source);
+        _source_latency_end(source, _parsed);
+
+        if ((unsigned)_received < _depth)
+            return rpoll_handler_ok; //socket queue drained, don't waste syscall for EAGAIN
+
+        _budget -= _depth;
+    }
+
+    LOG(verbose, "batch: %p packet per tick limit exceeded", source);
+    return rpoll_handler_ok;
+}
+
+static rpoll_handler
+_source_poll_handler (
+    BTH spollable*                      pollable,
+        uint32_t                        flags,
+    BTH spoll_passthrou*                passthrou
+) {
+    ssource* _source = CONTAINEROF(pollable, ssource, ss.runtime.pollable);
+
+    if (0 != (flags & (FPOLLABLE_ERR | FPOLLABLE_HUP))) {
+        LOG(verbose, "source %p failed", _source);
+        source_stop(_source);
+        return rpoll_handler_ok;
+    }
+
+    if NOT_NULL_IS(_source->xdp)
+        return _source_poll_handler_xdp(_source, pollable, passthrou);
+
+    if NOT_NULL_IS(_source->ring.map)
+        return _source_poll_handler_ring(_source, pollable, passthrou);
+
+    if NOT_NULL_IS(_source->rx)
+        return _source_poll_handler_batch(_source, pollable, passthrou);
+
+    switch (_source->type) {
+        case esource_type_simple:
+            return _source_poll_handler_simple(_source, pollable, passthrou);
+
+        case esource_type_raw:
+            return _source_poll_handler_raw(_source, pollable, passthrou);
+    }
+
+    return rpoll_handler_failed;
+}
+
+/** KIM: kernel side prefilter
+        same decision as _source_proceed, but without per-packet state, so
+        it's compiled at start and rebuilt on source device address changes.
+        join sinks' addresses aren't tracked here, so with join sinks filter
+        accepts everything from binding network - userspace decides
+**/
+static void
+_source_filter_compile (
+    IN  ssource*                        source,
+    BTH sfilter*                        filter
+) {
+    filter_label_t _accept = filter_label(filter);
+    filter_label_t _drop   = filter_label(filter);
+
+    filter_prologue(filter);
+
+    if (NULL != source->portrange) {
+        filter_label_t _port = filter_label(filter);
+
+        filter_goto_in_portrange(filter, source->portrange, _port);
+        filter_goto(filter, _drop);
+        filter_bind(filter, _port);
+    }
+
+    if (NULL != source->allow) {
+        //first allow matched by source address decides
+        for (const sipv4_allow* _allow = source->allow; NULL != _allow; _allow = _allow->next) {
+            filter_label_t _next = filter_label(filter);
+
+            filter_goto_not_in_network(filter, FILTER_MEM_FROM, &(_allow->address), _next);
+
+            if (NULL != _allow->allow_to) {
+                for (const sipv4_allow_to* _to = _allow->allow_to; NULL != _to; _to = _to->next) {
+                    filter_label_t _next_to = filter_label(filter);
+
+                    filter_goto_not_in_network(filter, FILTER_MEM_DESTINATION, &(_to->address), _next_to);
+
+                    if NULL_IS(_to->portrange) {
+                        filter_goto(filter, _accept);
+
+                    } else {
+                        filter_goto_in_portrange(filter, _to->portrange, _accept);
+                        filter_goto(filter, _drop);
+                    }
+
+                    filter_bind(filter, _next_to);
+                }
+
+            } else {
+                filter_goto_equal(filter, FILTER_MEM_DESTINATION, ipv4_network_broadcast(&(_allow->address)), _accept);
+                filter_goto(filter, _drop);
+            }
+
+            filter_bind(filter, _next);
+        }
+
+        filter_goto(filter, _drop);
+
+    } else {
+        for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; _mgroup = _mgroup->next)
+            filter_goto_equal(filter, FILTER_MEM_DESTINATION, _mgroup->group, _accept);
+
+        if RTLINK_LISTENER_ATTACHED(&(source->ss.runtime.device)) {
+            for (srtlink_device_address* _address = rtlink_listener_address(&(source->ss.runtime.device)); NULL != _address; _address = rtlink_device_address_next(_address)) {
+                filter_label_t _next = filter_label(filter);
+
+                filter_goto_not_in_network(filter, FILTER_MEM_FROM, &(_address->network), _next);
+                filter_goto_equal(filter, FILTER_MEM_DESTINATION, _address->broadcast, _accept);
+                filter_bind(filter, _next);
+            }
+
+        } else {
+            filter_goto_not_in_network(filter, FILTER_MEM_FROM, &(source->binding), _drop);
+
+            for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+                switch (_sink->type) {
+                    case esink_type_simple: {
+                        filter_label_t _next = filter_label(filter);
+
+                        filter_goto_not_in_network(filter, FILTER_MEM_FROM, &(_sink->cold->ts.simple.target), _next);
+                        filter_goto_equal(filter, FILTER_MEM_DESTINATION, ipv4_network_broadcast(&(_sink->cold->ts.simple.target)), _accept);
+                        filter_bind(filter, _next);
+                        break;
+                    }
+
+                    case esink_type_join:
+                        filter_goto(filter, _accept);
+                        break;
+                }
+        }
+
+        filter_goto(filter, _drop);
+    }
+
+    filter_bind(filter, _accept);
+    filter_return(filter, 1);
+
+    filter_bind(filter, _drop);
+    filter_return(filter, 0);
+}
+
+//program is shared by lanes, so any lane replaces it [see KIM: xdp program]
+static rsource
+_source_filter_attach_xdp (
+    BTH ssource*                        source
+) {
+    sfilter* _filter = filter_create();
+
+    if NULL_IS(_filter)
+        return rsource_failed;
+
+    _source_filter_compile(source, _filter);
+
+    const sfilter* _compiled = _filter;
+
+    if (rfilter_ok != filter_finalize(_filter)) {
+        LOG(verbose, "source %p: can't compile filter, xdp program accepts any udp datagram", source);
+        _compiled = NULL;
+    }
+
+    rxdp _r = xdp_program_attach(source->xdp_program, _compiled, rtlink_listener_index(&(source->ss.runtime.device)), source->workers);
+
+    filter_destroy(_filter);
+    return (rxdp_ok == _r)?rsource_ok:rsource_failed;
+}
+
+static rsource
+_source_filter_attach (
+    BTH ssource*                        source,
+        socket_t                        socket
+) {
+    if (0 < source->xdp_frames)
+        return _source_filter_attach_xdp(source);
+
+    sfilter* _filter = filter_create();
+
+    if NULL_IS(_filter)
+        return rsource_failed;
+
+    if (1 < source->workers)
+        filter_lane(_filter, source->lane, source->workers, source->steering);
+
+    if (0 < source->ring_blocks)
+        filter_packet(_filter);
+
+    _source_filter_compile(source, _filter);
+
+    if (rfilter_ok != filter_finalize(_filter)) {
+        LOG(verbose, "source %p: can't compile filter, datagrams are filtered in userspace only", source);
+
+        if ((1 == source->workers) && (0 == source->ring_blocks)) {
+            filter_destroy(_filter);
+            return rsource_ok;
+        }
+
+        //lane filter is mandatory, ring one keeps foreign traffic out of ring
+        filter_reset(_filter);
+
+        if (1 < source->workers)
+            filter_lane(_filter, source->lane, source->workers, source->steering);
+
+        if (0 < source->ring_blocks)
+            filter_packet(_filter);
+
+        filter_return(_filter, 1);
+
+        if (rfilter_ok != filter_finalize(_filter))
+            goto _failed;
+    }
+
+    if (rsocket_ok != socket_filter_set(socket, _filter->code, _filter->length))
+        goto _failed;
+
+    LOG(debug, "source %p: filter attached [%lu instructions]", source, (unsigned long)_filter->length);
+
+    filter_destroy(_filter);
+    return rsource_ok;
+
+    _failed:
+        filter_destroy(_filter);
+        return rsource_failed;
+}
+
+static void
+_source_xdp_close (
+    BTH ssource*                        source
+) {
+    ssource_xdp* _xdp = source->xdp;
+
+    if NULL_IS(_xdp)
+        return;
+
+    //sinks' sockets share umem, so they go first
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        _sink_xsk_close(_sink);
+        _sink->cold->packet.xdp = NULL;
+    }
+
+    if (0 != _xdp->mapped)
+        xdp_program_remove(source->xdp_program, _xdp->queue);
+
+    //pending event of closed timer is stale [see poll]
+    if (! SOCKET_INVALID_IS(pollable_socket(&(source->xdp_timer.pollable)))) {
+        timer_detach(&(source->xdp_timer));
+        timer_cleanup(&(source->xdp_timer));
+        pollable_socket_set(&(source->xdp_timer.pollable), SOCKET_INVALID);
+    }
+
+    xdp_socket_close(&(_xdp->socket));
+    xdp_umem_destroy(&(_xdp->umem));
+
+    free(_xdp->holders);
+    free(_xdp);
+
+    source->xdp = NULL;
+}
+
+//lane's socket is bound to queue of the same index, all frames are given to kernel at once
+static socket_t
+_source_xdp_open (
+    BTH ssource*                        source
+) {
+    srtlink_listener* _device = &(source->ss.runtime.device);
+
+    device_index_t _index = rtlink_listener_index(_device);
+    size_t         _need  = (XDP_PACKET_HEADROOM + ETHER_HDR_LEN + rtlink_listener_mtu(_device));
+    size_t         _frame = 2048;
+
+    while ((_frame < _need) && (_frame < (size_t)sysconf(_SC_PAGESIZE)))
+        _frame <<= 1;
+
+    //started again by rtlink, when device appears
+    if (RTLINK_DEVICE_IDX_INVALID == _index) {
+        LOG(verbose, "source %p: device [%s] isn't known yet", source, rtlink_listener_device_name(_device));
+        return SOCKET_INVALID;
+    }
+
+    if (_frame < _need) {
+        LOG(error, "source %p: device [%s] mtu doesn't fit af-xdp frame [%lu bytes]", source, rtlink_listener_device_name(_device), (unsigned long)_frame);
+        return SOCKET_INVALID;
+    }
+
+    size_t _queues = 0;
+
+    //channels may be changed at any time, so they're checked on every start
+    if (rxdp_ok != xdp_device_queues(rtlink_listener_device_name(_device), &_queues)) {
+        LOG(warning, "source %p: rx queues of device [%s] are unknown, datagrams of queues above %lu go to kernel", source, rtlink_listener_device_name(_device), (unsigned long)source->workers);
+
+    } else if (_queues != source->workers) {
+        LOG(error, "source %p: device [%s] has %lu rx queues, source with xdp needs \"workers %lu\" [or device's channels changed]", source, rtlink_listener_device_name(_device), (unsigned long)_queues, (unsigned long)_queues);
+        return SOCKET_INVALID;
+    }
+
+    ssource_xdp* _xdp = (ssource_xdp*)calloc(1, sizeof(ssource_xdp));
+
+    if NULL_IS(_xdp) {
+        LOG(critical, "out of memory: source af-xdp [%lu]", (unsigned long)sizeof(ssource_xdp));
+        return SOCKET_INVALID;
+    }
+
+    _xdp->socket.socket = SOCKET_INVALID;
+    _xdp->index         = _index;
+    _xdp->queue         = (uint32_t)source->lane;
+    _xdp->current       = source->xdp_frames;
+
+    source->xdp = _xdp;
+
+    if NULL_IS(_xdp->holders = (ssink**)calloc(source->xdp_frames, sizeof(ssink*))) {
+        LOG(critical, "out of memory: af-xdp frames of %lu", (unsigned long)source->xdp_frames);
+        goto _failed;
+    }
+
+    if (rxdp_ok != xdp_umem_create(source->xdp_frames, _frame, &(_xdp->umem)))
+        goto _failed;
+
+    if (rxdp_ok != xdp_socket_open(&(_xdp->socket), &(_xdp->umem), NULL, _index, _xdp->queue, source->xdp_frames))
+        goto _failed;
+
+    for (size_t _i = 0; _i < _xdp->umem.frames; ++_i)
+        _source_xdp_refill(_xdp, _i);
+
+    xdp_ring_submit(&(_xdp->socket.fill));
+
+    //lane's poll, so tick never races with rx handler
+    if (rtimer_ok != timer_startup(&(source->xdp_timer), pollable_poll(_source_pollable(source)), _source_xdp_tick))
+        goto _failed;
+
+    if (rtimer_ok != timer_attach(&(source->xdp_timer))) {
+        timer_cleanup(&(source->xdp_timer));
+        pollable_socket_set(&(source->xdp_timer.pollable), SOCKET_INVALID);
+        goto _failed;
+    }
+
+    if (rsource_ok != _source_filter_attach_xdp(source))
+        goto _failed;
+
+    if (rxdp_ok != xdp_program_insert(source->xdp_program, _xdp->queue, &(_xdp->socket)))
+        goto _failed;
+
+    _xdp->mapped = 1;
+
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        _sink->cold->packet.xdp = _xdp;
+
+        if ((0 != (FSINK_REWRITE_TRANSPORT_PACKET & _sink->rewrite)) && (! SOCKET_INVALID_IS(_sink->socket)))
+            _sink_xsk_open(_sink, _sink_listener(_sink));
+    }
+
+    LOG(verbose, "source %p: af-xdp queue %"PRIu32" of %lu frames [%lu bytes, %s]", source, _xdp->queue, (unsigned long)_xdp->umem.frames, (unsigned long)_frame, (XDP_ZEROCOPY == _xdp->socket.mode)?"zero copy":"copy");
+    return _xdp->socket.socket;
+
+    _failed:
+        //program isn't detached by failed lane, other ones may use it
+        if (0 == source->xdp_program->users)
+            xdp_program_detach(source->xdp_program);
+
+        _source_xdp_close(source);
+        return SOCKET_INVALID;
+}
+
+static void
+_source_socket_close (
+    BTH ssource*                        source,
+        socket_t                        socket
+) {
+    if NOT_NULL_IS(source->xdp) {
+        _source_xdp_close(source);
+        return;
+    }
+
+    if NULL_IS(source->ring.map) {
+        socket_close(socket);
+        return;
+    }
+
+    socket_packet_close(socket, &(source->ring));
+}
+
+//PACKET_STATISTICS resets counters, so they are accumulated by lane's statistics, XDP_STATISTICS don't
+static void
+_source_ring_statistics (
+    BTH ssource*                        source
+) {
+    uint32_t _drops   = 0;
+    uint32_t _freezes = 0;
+
+    if (NOT_NULL_IS(source->xdp) && NOT_NULL_IS(source->statistics)) {
+        ssource_xdp* _xdp   = source->xdp;
+        uint64_t     _lost  = 0;
+        uint64_t     _empty = 0;
+
+        if (rxdp_ok != xdp_socket_statistics(&(_xdp->socket), &_lost, &_empty))
+            return;
+
+        source->statistics->ring_drops   += (_lost  - _xdp->drops);
+        source->statistics->ring_freezes += (_empty - _xdp->empty);
+
+        _xdp->drops = _lost;
+        _xdp->empty = _empty;
+        return;
+    }
+
+    if (NULL_IS(source->ring.map) || NULL_IS(source->statistics))
+        return;
+
+    if (rsocket_ok != socket_packet_statistics(pollable_socket(_source_pollable(source)), &_drops, &_freezes))
+        return;
+
+    source->statistics->ring_drops   += _drops;
+    source->statistics->ring_freezes += _freezes;
+}
+
+rsource
+source_start (
+    BTH ssource*                        source
+) { 
+    if (rsource_ok == source_state(source))
+        return rsource_ok;
+
+    LOG(verbose, "starting source %p", source);
+
+    socket_t _socket = SOCKET_INVALID;
+
+    switch (source->type) {
+        case esource_type_simple: {
+            struct sockaddr_in _binding;
+            _binding.sin_family      = AF_INET;
+            _binding.sin_port        = source->port;
+            _binding.sin_addr.s_addr = source->binding.address;
+
+            LOG(debug, IPV4_PRIADDR":%d", IPV4_DPRIADDR(source->binding.address), (int)ntohs(source->port));
+
+            //filter should be attached before binding, otherwise socket [lane] would receive foreign datagrams
+            _socket = socket_open(source->flg_socket, NULL, rtlink_listener_device_name(&(source->ss.runtime.device)));
+
+            if SOCKET_INVALID_IS(_socket)
+                break;
+
+            if ((1 < source->workers) && (esocket_steering_cpu == source->steering))
+                if (rsocket_ok != socket_reuseport_cpu_set(_socket, source->workers))
+                    goto _failed_socket;
+
+            if (rsource_ok != _source_filter_attach(source, _socket))
+                goto _failed_socket;
+
+            if (rsocket_ok != socket_bind(_socket, (struct sockaddr*)&_binding))
+                goto _failed_socket;
+
+            break;
+        }
+
+        case esource_type_raw: {
+            //program is attached & socket is mapped when everything else is ready [see KIM: af-xdp source]
+            if (0 < source->xdp_frames) {
+                _socket = _source_xdp_open(source);
+                break;
+            }
+
+            if (0 < source->ring_blocks) {
+                //ring gets nothing until bound, so filter is attached first [see KIM: af-packet ring]
+                _socket = socket_packet(source->ring_blocks, source->ring_block_size, SOURCE_RING_RETIRE, &(source->ring));
+
+                if SOCKET_INVALID_IS(_socket)
+                    break;
+
+                if (rsource_ok != _source_filter_attach(source, _socket))
+                    goto _failed_socket;
+
+                if (rsocket_ok != socket_packet_bind(_socket, rtlink_listener_index(&(source->ss.runtime.device))))
+                    goto _failed_socket;
+
+                break;
+            }
+
+            _socket = socket_raw(source->flg_socket, rtlink_listener_device_name(&(source->ss.runtime.device)));
+
+            if SOCKET_INVALID_IS(_socket)
+                break;
+
+            if (rsource_ok != _source_filter_attach(source, _socket))
+                goto _failed_socket;
+
+            break;
+        }
+    }
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(verbose, "source socket restarting failed"); 
+        return rsource_failed;
+    }
+
+    for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; _mgroup = _mgroup->next) 
+        if (rsocket_ok != socket_mgroup_join(_socket, _mgroup->group, source->binding.address, rtlink_listener_index(&(source->ss.runtime.device)))) {
+            LOG(verbose, "can't join multicast group");
+            _source_socket_close(source, _socket);
+            return rsource_failed;
+        }
+
+    pollable_socket_set(_source_pollable(source), _socket);
+
+    if (rpoll_ok != poll_attach(_source_pollable(source))) {
+        LOG(verbose, "can't add source to poll");
+
+        _source_socket_close(source, _socket);
+        pollable_socket_set(_source_pollable(source), SOCKET_INVALID);
+        return rsource_failed;
+    }
+
+    LOG(verbose, "source %p alive", source);
+
+    return rsource_ok;
+
+    _failed_socket:
+        LOG(verbose, "source socket restarting failed");
+
+        _source_socket_close(source, _socket);
+        return rsource_failed;
+}
+
+rsource
+source_stop (
+    BTH ssource*                        source
+) {
+    if (rsource_ok != source_state(source))
+        return rsource_ok;
+
+    LOG(verbose, "stoping source %p", source);
+
+    if (rpoll_ok != poll_detach(_source_pollable(source)))
+        return rsource_failed;
+
+    //drops are kept, counters go with socket
+    _source_ring_statistics(source);
+    _source_socket_close(source, pollable_socket(_source_pollable(source)));
+
+    pollable_socket_set(_source_pollable(source), SOCKET_INVALID);
+    return rsource_ok;
+}
+
+rsource
+source_state (
+    BTH ssource*                source
+) {
+    if SOCKET_INVALID_IS(pollable_socket(_source_pollable(source)))
+        return rsource_failed;
+
+    return rsource_ok;
+}
+
+static size_t
+_source_sinks_count (
+    IN  ssource*                        source
+) {
+    size_t _count = 0;
+
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _count++;
+
+    return _count;
+}
+
+//statistics are cache line aligned types, malloc doesn't guarantee it
+static void*
+_statistics_allocate (
+        size_t                          size
+) {
+    void* _block = NULL;
+
+    if (0 != posix_memalign(&_block, CACHE_LINE_SIZE, size))
+        return NULL;
+
+    memset(_block, 0, size);
+    return _block;
+}
+
+static rsource
+_source_statistics_allocate (
+    BTH ssource*                        source
+) {
+    size_t _sinks = _source_sinks_count(source);
+
+    //one block per lane: source's counters, then sinks' ones, each on own cache lines
+    size_t _size = sizeof(ssource_statistics) + (_sinks * sizeof(ssink_statistics));
+
+    if NULL_IS(source->statistics = (ssource_statistics*)_statistics_allocate(_size)) {
+        LOG(critical, "out of memory: statistics [%lu]", (unsigned long)_size);
+        return rsource_failed;
+    }
+
+    ssink_statistics* _sink_statistics = (ssink_statistics*)(source->statistics + 1);
 
-    if RTLINK_LISTENER_ATTACHED(&(source->ss.runtime.device)) {
-        if (rsource_ok != _source_proceed_listener_addresses(source, packet, passthrou, &(source->ss.runtime.device)))
-            return rsource_failed;
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _sink->statistics = _sink_statistics++;
 
-        LOG(verbose, "source: rejected martian");
+    return rsource_ok;
+}
+
+static rsource
+_source_latency_allocate (
+    BTH ssource*                        source
+) {
+    if (esource_latency_none == source->latency)
         return rsource_ok;
+
+    //same layout as statistics: lane's histograms, then sinks' ones
+    size_t _size = sizeof(ssource_latency) + (_source_sinks_count(source) * sizeof(ssink_latency));
+
+    if NULL_IS(source->timing = (ssource_latency*)_statistics_allocate(_size)) {
+        LOG(critical, "out of memory: latency histograms [%lu]", (unsigned long)_size);
+        return rsource_failed;
     }
 
-    if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(source->binding)))
-        for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
-            switch (_sink->type) {
-                case esink_type_simple:
-                    //if sink is simple, use its target itself as allow
+    ssink_latency* _sink_timing = (ssink_latency*)(source->timing + 1);
 
-                    LOG(debug, "sink "IPV4_PRIADDR"/"IPV4_PRIADDR, IPV4_DPRIADDR(_sink->ts.simple.target.address), IPV4_DPRIADDR(_sink->ts.simple.target.mask));
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _sink->cold->timing = _sink_timing++;
 
-                    if (ripv4_ok == ipv4_address_in_network(packet->from.sin_addr.s_addr, &(_sink->ts.simple.target))) {
-                        LOG(debug, "... from network");
+    return rsource_ok;
+}
 
-                        if (packet->destination.address == ipv4_network_broadcast(&(_sink->ts.simple.target))) {
-                            LOG(debug, "... to broadcast");
-                            return _source_relay(source, packet, passthrou);
-                        }
-                    }
+static void
+_source_latency_free (
+    BTH ssource*                        source
+) {
+    free(source->timing);
+    source->timing = NULL;
 
-                    break;
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _sink->cold->timing = NULL;
+}
 
-                case esink_type_join:
-                    LOG(debug, "join, checking addresses");
+static void
+_sinks_cleanup (
+    BTH ssource*                        source,
+    BTH ssink*                          until
+) {
+    for (ssink* _sink = source->sinks; _sink != until; _sink = _sink->next) {
+        if (rsource_ok != _sink_stop(_sink))
+            LOG(error, "can't stop sink while cleanup");
 
-                    if (rsource_ok != _source_proceed_listener_addresses(source, packet, passthrou, &(_sink->ts.join.runtime.device)))
-                        return rsource_failed;
+        switch (_sink->type) {
+            case esink_type_simple:
+                if (rnetlink_ok != rtlink_listener_detach(&(_sink->cold->ts.simple.device.runtime)))
+                    LOG(error, "can't detach listener while cleaning up");
 
-                    break;
-            }
+                break;
 
-    LOG(verbose, "source: rejected by sinks");
-    return rsource_ok;
+            case esink_type_join:
+                if (rnetlink_ok != rtlink_listener_detach(&(_sink->cold->ts.join.runtime.device)))
+                    LOG(error, "can't detach listener while cleaning up");
+
+                break;
+        }
+    }
 }
 
-static rpoll_handler
-_source_poll_handler_simple (
+static rsource
+_source_bootup (
     BTH ssource*                        source,
-    BTH spollable*                      pollable,
-    BTH spoll_passthrou*                passthrou
+    BTH srtlink*                        rtlink,
+    BTH spoll*                          poll,
+        size_t                          buffer_size
 ) {
-    LOG(debug, "source simple %p", source);
+    LOG(verbose, "bootup source %p", source);
 
-    for (size_t _current_packet_per_tick = SOURCE_MAX_PACKETS_PER_TICK; _current_packet_per_tick--; ) {
-        _ssource_udp_packet _packet;
+    source->rx         = NULL;
+    source->flows      = NULL;
+    source->statistics = NULL;
+    source->timing     = NULL;
 
-        char                _control[SOURCE_SIMPLE_CONTROL_LENGTH];
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _sink->cold->timing = NULL;
 
-        struct iovec        _iov = {passthrou->buffer, passthrou->length};
-        struct msghdr       _msg = { &(_packet.from), sizeof(_packet.from), &_iov, 1, _control, sizeof(_control), 0};
+    if NULL_IS(source->tx = _source_tx_allocate(SOURCE_TX_QUEUE_LENGTH))
+        return rsource_failed;
 
-        int _length = recvmsg(pollable_socket(pollable), &_msg, (MSG_DONTWAIT | MSG_TRUNC | MSG_CTRUNC));
+    if (rsource_ok != _source_statistics_allocate(source))
+        goto _failed;
 
-        if (0  > _length) {
-            if EINTR_IS      (errno) continue;
+    if (rsource_ok != _source_latency_allocate(source))
+        goto _failed;
 
-            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
-            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+    if NULL_IS(source->flows = (ssource_flows*)calloc(1, sizeof(ssource_flows))) {
+        LOG(critical, "out of memory: source flows [%lu]", (unsigned long)sizeof(ssource_flows));
+        goto _failed;
+    }
 
-            LOG(error, "recvmsg failed, cuz' %d [%s]", errno, strerror(errno));
-            return rpoll_handler_failed;
-        }
+    if (1 < source->batch) {
+        size_t _control = (esource_type_simple == source->type)?SOURCE_SIMPLE_CONTROL_LENGTH:SOURCE_RAW_CONTROL_LENGTH;
 
-        if (0 != _msg.msg_flags) {
-            if (0 != (_msg.msg_flags & MSG_CTRUNC)) {
-                LOG(error, "control truncated, please check SOURCE_SIMPLE_CONTROL_LENGTH constant!");
-            }
+        if NULL_IS(source->rx = _source_batch_allocate(source->batch, buffer_size, _control))
+            goto _failed;
 
-            if (0 != (_msg.msg_flags & MSG_TRUNC)) {
-                LOG(warning, "message truncated! increase buffer size to %d [at least]", _length);
-                continue;
+        LOG(verbose, "source %p receives in batches of %lu [%lu bytes]", source, (unsigned long)source->batch, (unsigned long)(source->batch * (buffer_size + _control)));
+    }
+
+    if (rnetlink_ok != rtlink_listener_attach(&(source->ss.runtime.device), rtlink, source->ss.configuration.device, _source_rtlink_handler))
+        goto _failed;
+
+    pollable_initialize(_source_pollable(source), poll, _source_poll_handler, SOCKET_INVALID, FPOLLABLE_IN);
+
+    //bootup sinks
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        memset(&(_sink->template), 0, sizeof(_sink->template));
+        memset(&(_sink->cold->options),  0, sizeof(_sink->cold->options));
+        memset(&(_sink->cold->packet),   0, sizeof(_sink->cold->packet));
+
+        _sink->cold->packet.socket     = SOCKET_INVALID;
+        _sink->cold->packet.xsk.socket = SOCKET_INVALID;
+
+        switch (_sink->type) {
+            case esink_type_simple:
+                if (rnetlink_ok != rtlink_listener_attach(&(_sink->cold->ts.simple.device.runtime), rtlink, _sink->cold->ts.simple.device.configuration, _sink_rtlink_handler_simple)) {
+                    _sinks_cleanup(source, _sink);
+                    goto _failed_listener;
+                }
+
+                break;
+
+            case esink_type_join: {
+                if (rnetlink_ok != rtlink_listener_attach(&(_sink->cold->ts.join.runtime.device), rtlink, _sink->cold->ts.join.configuration.device, _sink_rtlink_handler_join)) {
+                    _sinks_cleanup(source, _sink);
+                    goto _failed_listener;
+                }
+
+                break;
             }
         }
+    }
+
+    return rsource_ok;
+
+    _failed_listener:
+        rtlink_listener_detach(&(source->ss.runtime.device));
+        pollable_clear(_source_pollable(source));
+
+    _failed:
+        free(source->flows);
+        source->flows = NULL;
+
+        free(source->statistics);
+        source->statistics = NULL;
+
+        _source_latency_free(source);
+
+        _source_batch_free(source->rx);
+        source->rx = NULL;
+
+        _source_tx_free(source->tx);
+        source->tx = NULL;
+
+        return rsource_failed;
+}
+
+static rsource
+_source_cleanup (
+    BTH ssource*                        source
+) {
+    LOG(verbose, "cleanup source %p", source);
+
+    rtlink_listener_detach(&(source->ss.runtime.device));
+    pollable_clear(_source_pollable(source));
+    _sinks_cleanup(source, NULL);
+
+    free(source->flows);
+    source->flows = NULL;
+
+    free(source->statistics);
+    source->statistics = NULL;
+
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
+        _sink->statistics = NULL;
+
+    _source_latency_free(source);
+
+    _source_batch_free(source->rx);
+    source->rx = NULL;
+
+    _source_tx_free(source->tx);
+    source->tx = NULL;
+
+    return rsource_ok;
+}
 
-        if (rsource_ok != _control_information(&_msg, &_packet)) {
-            LOG(error, "message ignored, cuz' unable to resolve required control information");
+static inline ssource*
+_source_lane (
+    BTH ssource*                        source,
+        size_t                          lane
+) { return (0 == lane)?source:&(source->lanes[lane - 1]); }
+
+//sums lanes' counters, sinks are optional [one per sink, lanes' sinks are clones in the same order]
+static void
+_source_statistics_sum (
+    IN  ssource*                        source,
+    OUT ssource_statistics*             sum,
+    OUT ssink_statistics*               sinks
+) {
+    memset(sum, 0, sizeof(*sum));
+
+    #define __ADD(_sum, _lane, _field)     (_sum)->_field += (_lane)->_field
+
+    for (size_t _i = 0; _i < source->workers; ++_i) {
+        ssource*                  _lane       = _source_lane(source, _i);
+        const ssource_statistics* _statistics = _lane->statistics;
+
+        _source_ring_statistics(_lane);
+
+        __ADD(sum, _statistics, received);
+        __ADD(sum, _statistics, malformed);
+        __ADD(sum, _statistics, relayed);
+        __ADD(sum, _statistics, rejected_portrange);
+        __ADD(sum, _statistics, rejected_allow);
+        __ADD(sum, _statistics, rejected_ratelimit);
+        __ADD(sum, _statistics, flow_hit);
+        __ADD(sum, _statistics, flow_miss);
+        __ADD(sum, _statistics, coalesced);
+        __ADD(sum, _statistics, ring_drops);
+        __ADD(sum, _statistics, ring_freezes);
+
+        if NULL_IS(sinks)
             continue;
+
+        ssink_statistics* _sum = sinks;
+
+        for (ssink* _sink = _lane->sinks; NULL != _sink; _sink = _sink->next, ++_sum) {
+            const ssink_statistics* _sink_statistics = _sink->statistics;
+
+            if (0 == _i)
+                memset(_sum, 0, sizeof(*_sum));
+
+            __ADD(_sum, _sink_statistics, relayed);
+            __ADD(_sum, _sink_statistics, fragmented);
+            __ADD(_sum, _sink_statistics, rejected_portrange);
+            __ADD(_sum, _sink_statistics, rejected_allow);
+            __ADD(_sum, _sink_statistics, rejected_loop);
+            __ADD(_sum, _sink_statistics, rejected_ttl);
+            __ADD(_sum, _sink_statistics, rejected_mtu);
+            __ADD(_sum, _sink_statistics, sent);
+            __ADD(_sum, _sink_statistics, partial);
+            __ADD(_sum, _sink_statistics, failed);
+            __ADD(_sum, _sink_statistics, segmented);
+            __ADD(_sum, _sink_statistics, framed);
+            __ADD(_sum, _sink_statistics, posted);
+        }
+    }
+
+    #undef __ADD
+}
+
+//merges lanes' histograms, sinks as in _source_statistics_sum
+static void
+_source_latency_sum (
+    IN  ssource*                        source,
+    OUT ssource_latency*                sum,
+    OUT ssink_latency*                  sinks
+) {
+    memset(sum,   0, sizeof(*sum));
+    memset(sinks, 0, _source_sinks_count(source) * sizeof(*sinks));
+
+    for (size_t _i = 0; _i < source->workers; ++_i) {
+        ssource* _lane = _source_lane(source, _i);
+
+        histogram_merge(&(sum->queue),   &(_lane->timing->queue));
+        histogram_merge(&(sum->process), &(_lane->timing->process));
+
+        ssink_latency* _sum = sinks;
+
+        for (ssink* _sink = _lane->sinks; NULL != _sink; _sink = _sink->next, ++_sum) {
+            histogram_merge(&(_sum->queue), &(_sink->cold->timing->queue));
+            histogram_merge(&(_sum->send),  &(_sink->cold->timing->send));
         }
+    }
+}
+
+#define __LATENCY_FORMAT        "p50 %"PRIu64", p99 %"PRIu64", max %"PRIu64" ns"
+#define __LATENCY(_histogram)   histogram_percentile(_histogram, 50.0), histogram_percentile(_histogram, 99.0), (_histogram)->max
+
+static void
+_source_latency (
+    IN  ssource*                        source
+) {
+    if NULL_IS(source->timing)
+        return;
+
+    ssource_latency* _source = (ssource_latency*)_statistics_allocate(sizeof(ssource_latency) + (_source_sinks_count(source) * sizeof(ssink_latency)));
+
+    if NULL_IS(_source) {
+        LOG(critical, "out of memory: latency histograms");
+        return;
+    }
+
+    ssink_latency* _sinks = (ssink_latency*)(_source + 1);
+
+    _source_latency_sum(source, _source, _sinks);
 
-        LOG(verbose, "simple: %p received %d bytes, from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16
-            , source, _length, IPV4_DPRIADDR(_packet.from.sin_addr.s_addr), ntohs(_packet.from.sin_port)
-            , IPV4_DPRIADDR(_packet.destination.address), ntohs(_packet.destination.port)
+    if (esource_latency_kernel == source->latency)
+        LOG(information, "source: %p latency, socket queue "__LATENCY_FORMAT", processing "__LATENCY_FORMAT
+            , source, __LATENCY(&(_source->queue)), __LATENCY(&(_source->process))
         );
+    else
+        LOG(information, "source: %p latency, processing "__LATENCY_FORMAT, source, __LATENCY(&(_source->process)));
 
-        _packet.id              = 0;
-        _packet.buffer          = passthrou->buffer;
-        _packet.length          = (unsigned)_length;
+    const ssink_latency* _sink = _sinks;
 
-        if (rsource_ok != _source_proceed(source, &_packet, passthrou))
-            return rpoll_handler_failed;
+    for (ssink* _c_sink = source->sinks; NULL != _c_sink; _c_sink = _c_sink->next, ++_sink)
+        LOG(information, "  sink: %p latency, tx queue "__LATENCY_FORMAT", sending "__LATENCY_FORMAT
+            , _c_sink, __LATENCY(&(_sink->queue)), __LATENCY(&(_sink->send))
+        );
+
+    free(_source);
+}
+
+#undef __LATENCY
+#undef __LATENCY_FORMAT
+
+static void
+_source_statistics (
+    IN  ssource*                        source
+) {
+    if NULL_IS(source->statistics)
+        return;
+
+    ssource_statistics _source;
+    ssink_statistics*  _sinks = (ssink_statistics*)_statistics_allocate((_source_sinks_count(source) + 1) * sizeof(ssink_statistics));
+
+    _source_statistics_sum(source, &_source, _sinks);
+
+    LOG(information, "source: %p received %"PRIu64" [%"PRIu64" malformed], relayed %"PRIu64", rejected by port-range %"PRIu64", allow %"PRIu64", rate-limit %"PRIu64", flow cache %"PRIu64" hits, %"PRIu64" misses, %"PRIu64" coalesced, ring drops %"PRIu64" [%"PRIu64" freezes]"
+        , source, _source.received, _source.malformed, _source.relayed
+        , _source.rejected_portrange, _source.rejected_allow, _source.rejected_ratelimit
+        , _source.flow_hit, _source.flow_miss, _source.coalesced, _source.ring_drops, _source.ring_freezes
+    );
+
+    if NULL_IS(_sinks) {
+        LOG(critical, "out of memory: sinks statistics");
+        return;
     }
 
-    LOG(verbose, "simple: %p packet per tick limit exceeded", source);
-    return rpoll_handler_ok;
+    const ssink_statistics* _sink = _sinks;
+
+    for (ssink* _c_sink = source->sinks; NULL != _c_sink; _c_sink = _c_sink->next, ++_sink)
+        LOG(information, "  sink: %p relayed %"PRIu64" [%"PRIu64" fragmented], rejected by port-range %"PRIu64", allow %"PRIu64", loop %"PRIu64", ttl %"PRIu64", mtu %"PRIu64", sent %"PRIu64" datagrams [%"PRIu64" segmented, %"PRIu64" framed, %"PRIu64" posted], %"PRIu64" failed, %"PRIu64" partial sends"
+            , _c_sink, _sink->relayed, _sink->fragmented
+            , _sink->rejected_portrange, _sink->rejected_allow, _sink->rejected_loop, _sink->rejected_ttl, _sink->rejected_mtu
+            , _sink->sent, _sink->segmented, _sink->framed, _sink->posted, _sink->failed, _sink->partial
+        );
+
+    free(_sinks);
+
+    _source_latency(source);
 }
 
-static rpoll_handler
-_source_poll_handler_raw (
-    BTH ssource*                        source,
-    BTH spollable*                      pollable,
-    BTH spoll_passthrou*                passthrou
+static void
+_source_lanes_free (
+    BTH ssource*                        source
 ) {
-    for (size_t _current_packet_per_tick = SOURCE_MAX_PACKETS_PER_TICK; _current_packet_per_tick--; ) {
-        _ssource_udp_packet _packet;
+    if (NULL != source->lanes) {
+        //lane's sinks are one block, cold parts included
+        for (size_t _i = 1; _i < source->workers; ++_i)
+            free(_source_lane(source, _i)->sinks);
 
-        struct iovec        _iov = {passthrou->buffer, passthrou->length};
-        struct msghdr       _msg = { &(_packet.from), sizeof(_packet.from), &_iov, 1, NULL, 0, 0};
+        free(source->lanes);
+        source->lanes = NULL;
+    }
 
-        int _length = recvmsg(pollable_socket(pollable), &_msg, (MSG_DONTWAIT | MSG_TRUNC));
+    if (NULL != source->ratelimit_guard) {
+        pthread_mutex_destroy(source->ratelimit_guard);
+        free(source->ratelimit_guard);
 
-        if (0  > _length) {
-            if EINTR_IS      (errno) continue;
-            if EWOULDBLOCK_IS(errno) return rpoll_handler_ok;
-            if EAGAIN_IS     (errno) return rpoll_handler_ok;
+        source->ratelimit_guard = NULL;
+    }
 
-            LOG(error, "recvmsg failed, cuz' %d [%s]", errno, strerror(errno));
-            return rpoll_handler_failed;
+    if (NULL != source->xdp_program) {
+        xdp_program_detach(source->xdp_program);
+        free(source->xdp_program);
+
+        source->xdp_program = NULL;
+    }
+}
+
+/** KIM: lanes
+        source with "workers N" is cloned N - 1 times before bootup, while it's
+        still in configuration state. every lane owns socket, pollable, queues
+        and sinks [with template, options cache & ip id counter], so lanes never
+        share hot data, only configuration [allow, port-range, m-groups] which is
+        read-only, and rate-limit which is guarded. lane's sinks are cloned into
+        one cache aligned block: hot parts array, then cold ones, like source's
+        ones in its arena.
+
+        ip ids are interleaved: lane k uses k + 1, k + 1 + N, ...
+**/
+static rsource
+_source_lanes_create (
+    BTH ssource*                        source
+) {
+    source->lane            = 0;
+    source->lanes           = NULL;
+    source->ratelimit_guard = NULL;
+    source->xdp             = NULL;
+    source->xdp_program     = NULL;
+
+    //lanes are device's queues, one program redirects to all of them
+    if (0 < source->xdp_frames) {
+        if NULL_IS(source->xdp_program = (sxdp_program*)malloc(sizeof(sxdp_program))) {
+            LOG(critical, "out of memory: xdp program [%lu]", (unsigned long)sizeof(sxdp_program));
+            return rsource_failed;
         }
 
-        if (0 != _msg.msg_flags)
-            if (0 != (_msg.msg_flags & MSG_TRUNC)) {
-                LOG(warning, "message truncated! increase buffer size to %d [at least]", _length);
-                continue;
-            }
+        xdp_program_initialize(source->xdp_program);
+    }
 
-        //this is little paranoic, cuz' system must not send packet to userspace if it broken
-        // but it add so small overhead, so i don't remove it
-        if (20 > _length) {
-            LOG(error, "data too small to be packet");
-            continue;
-        }
+    if (1 == source->workers)
+        return rsource_ok;
 
-        struct iphdr* _iphdr = (struct iphdr*)passthrou->buffer;
+    if NULL_IS(source->lanes = (ssource*)calloc(source->workers - 1, sizeof(ssource))) {
+        LOG(critical, "out of memory: source lanes [%lu]", (unsigned long)((source->workers - 1) * sizeof(ssource)));
+        return rsource_failed;
+    }
 
-        if (unaligned_htons(&(_iphdr->tot_len)) != _length) {
-            LOG(error, "wrong packet size");
-            continue;
+    if (NULL != source->ratelimit) {
+        if NULL_IS(source->ratelimit_guard = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t))) {
+            LOG(critical, "out of memory: rate-limit guard");
+            goto _failed;
         }
 
-        if (5 > _iphdr->ihl) {
-            LOG(error, "wrong ihl value %u", (unsigned int)_iphdr->ihl);
-            continue;
+        if (0 != pthread_mutex_init(source->ratelimit_guard, NULL)) {
+            LOG(error, "can't initialize rate-limit guard");
+
+            free(source->ratelimit_guard);
+            source->ratelimit_guard = NULL;
+            goto _failed;
         }
+    }
 
-        _packet.options         = NULL;
-        _packet.options_length  = 0;
+    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+        _sink->last_ip_id = 1;
+        _sink->ip_id_step = (uint16_t)source->workers;
+    }
 
-        if (5 < _iphdr->ihl)
-            if (0 != (source->flg_socket & FSOCKET_RECVOPTIONS)) {
-                _packet.options         = (passthrou->buffer + sizeof(struct iphdr));
-                _packet.options_length  = (_iphdr->ihl - 5) * 4;
-            }
+    size_t _sinks = _source_sinks_count(source);
 
-        /*ubyte_t _ip_options_test[] = {0x09, 0x02, 0x09, 0x02, 0x09, 0x02, 0x09, 0x02, 0x09, 0x20, 0x09, 0x02};
-        _packet.options         = _ip_options_test;
-        _packet.options_length  = sizeof(_ip_options_test);
-        */
+    for (size_t _i = 1; _i < source->workers; ++_i) {
+        ssource* _lane = _source_lane(source, _i);
 
-        size_t _shift = (_iphdr->ihl * 4);
+        memcpy(_lane, source, sizeof(ssource));
 
-        if ((unsigned)_length < (_shift + sizeof(struct udphdr))) {
-            LOG(error, "udp header doesn't fit to buffer");
+        _lane->lane  = _i;
+        _lane->lanes = NULL;
+        _lane->sinks = NULL;
+        _lane->next  = NULL;
+
+        if (0 == _sinks)
             continue;
+
+        size_t _size   = _sinks * (sizeof(ssink) + sizeof(ssink_cold));
+        ssink* _clones = (ssink*)_statistics_allocate(_size);
+
+        if NULL_IS(_clones) {
+            LOG(critical, "out of memory: sink lane [%lu]", (unsigned long)_size);
+            goto _failed;
         }
 
-        struct udphdr* _udphdr = (struct udphdr*)(passthrou->buffer + _shift);
+        ssink_cold* _colds = (ssink_cold*)(_clones + _sinks);
+        ssink**     _tail  = &(_lane->sinks);
 
-        uint16_t _udphdr_length = unaligned_htons(&(_udphdr->len));
+        for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next) {
+            ssink*      _clone = _clones++;
+            ssink_cold* _cold  = _colds++;
 
-        if (sizeof(struct udphdr) > _udphdr_length) {
-            LOG(error, "wrong udp length");
-            continue;
-        }
+            memcpy(_clone, _sink, sizeof(ssink));
+            memcpy(_cold,  _sink->cold, sizeof(ssink_cold));
 
-        if ((unsigned)_length < (_shift + _udphdr_length - sizeof(struct udphdr))) {
-            LOG(error, "udp data doesn't fit to buffer");
-            continue;
+            _clone->cold = _cold;
+            _cold->sink  = _clone;
+
+            _clone->last_ip_id = (uint16_t)(_i + 1);
+            _clone->next       = NULL;
+
+            (*_tail) = _clone;
+            _tail    = &(_clone->next);
         }
+    }
 
-        _shift += sizeof(struct udphdr);
+    LOG(verbose, "source %p receives by %lu lanes", source, (unsigned long)source->workers);
+    return rsource_ok;
 
-        _packet.buffer = passthrou->buffer + _shift;
-        _packet.length = _length - _shift;
+    _failed:
+        _source_lanes_free(source);
+        return rsource_failed;
+}
 
-        _packet.id     = unaligned_u16(&(_iphdr->id));
+//stops lanes and frees their runtime, lanes themselves are kept
+static void
+_source_lanes_retire (
+    BTH ssource*                        source
+) {
+    _source_statistics(source);
 
-        _packet.tos    = _iphdr->tos;
-        if (0 == (source->flg_socket & FSOCKET_RECVTOS))
-            _packet.tos = 0x00;
+    for (size_t _i = 0; _i < source->workers; ++_i) {
+        ssource* _lane = _source_lane(source, _i);
 
-        _packet.ttl    = _iphdr->ttl;
-        if (0 == (source->flg_socket & FSOCKET_RECVTTL))
-            if (rsysctl_ok != ipv4_default_ttl(&(_packet.ttl))) {
-                LOG(error, "receiving of ttl disabled, but default ttl resolving failed");
-                continue;
-            }
+        if (rsource_ok != source_stop(_lane)) {
+            LOG(critical, "source stop failed, ignored");
+        }
 
-        _packet.destination.address = unaligned_u32(&(_iphdr->daddr));
-        _packet.destination.port    = unaligned_u16(&(_udphdr->dest));
+        if (rsource_ok != _source_cleanup(_lane)) {
+            LOG(critical, "source cleanup failed, ignored");
+        }
+    }
+}
 
-        //this is strange, but we should fix it
-        if (0 == _packet.from.sin_addr.s_addr)
-            _packet.from.sin_addr.s_addr = unaligned_u32(&(_iphdr->saddr));
+static void
+_source_lanes_cleanup (
+    BTH ssource*                        source
+) {
+    _source_lanes_retire(source);
+    _source_lanes_free(source);
+}
 
-        if (0 == _packet.from.sin_port)
-            _packet.from.sin_port = unaligned_u16(&(_udphdr->source));
+static rsource
+_source_lanes_bootup (
+    BTH ssource*                        source,
+    BTH srtlink*                        rtlink,
+    BTH spoll**                         polls,
+        size_t                          polls_count,
+    BTH size_t*                         poll,
+        size_t                          buffer_size
+) {
+    if (rsource_ok != _source_lanes_create(source))
+        return rsource_failed;
 
-        if (AF_INET != _packet.from.sin_family)
-            _packet.from.sin_family = AF_INET;
+    //lanes are spread among polls [worker threads] round-robin
+    for (size_t _i = 0; _i < source->workers; ++_i)
+        if (rsource_ok != _source_bootup(_source_lane(source, _i), rtlink, polls[((*poll)++) % polls_count], buffer_size)) {
+            while (_i--)
+                _source_cleanup(_source_lane(source, _i));
 
-        LOG(verbose, "raw: %p received %d bytes, from "IPV4_PRIADDR":%"PRIu16" to "IPV4_PRIADDR":%"PRIu16
-            , source, _length, IPV4_DPRIADDR(_packet.from.sin_addr.s_addr), ntohs(_packet.from.sin_port)
-            , IPV4_DPRIADDR(_packet.destination.address), ntohs(_packet.destination.port)
-        );
+            _source_lanes_free(source);
+            return rsource_failed;
+        }
 
-        if (rsource_ok != _source_proceed(source, &_packet, passthrou))
-            return rpoll_handler_failed;
-    }
+    return rsource_ok;
+}
 
-    LOG(verbose, "raw: %p packet per tick limit exceeded", source);
-    return rpoll_handler_ok;
+void
+sources_statistics (
+    IN  ssource*                        source
+) {
+    for (ssource* _current = source; NULL != _current; _current = _current->next)
+        _source_statistics(_current);
 }
 
-static rpoll_handler
-_source_poll_handler (
-    BTH spollable*                      pollable,
-        uint32_t                        flags,
-    BTH spoll_passthrou*                passthrou
+typedef
+struct __source_metric {
+    const char*                         name;
+    const char*                         help;
+    size_t                              offset;
+} _ssource_metric;
+
+#define __METRIC(_type, _name, _field, _help)   { _name, _help, offsetof(_type, _field) }
+
+static const _ssource_metric _gsource_metrics[] = {
+        __METRIC(ssource_statistics,    "bproxy_source_received_total",             received,           "Datagrams received by source")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_malformed_total",            malformed,          "Received datagrams which can't be parsed")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_relayed_total",              relayed,            "Datagrams passed source's checks and rate-limit")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_rejected_portrange_total",   rejected_portrange, "Datagrams rejected by source's port-range")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_rejected_allow_total",       rejected_allow,     "Datagrams rejected by source's allow, m-groups or as martians")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_rejected_ratelimit_total",   rejected_ratelimit, "Datagrams rejected by source's rate-limit")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_flow_hits_total",            flow_hit,           "Datagrams relayed by cached flow decision")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_flow_misses_total",          flow_miss,          "Datagrams which required full decision")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_coalesced_total",            coalesced,          "Datagrams received coalesced by UDP_GRO")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_ring_drops_total",           ring_drops,         "Datagrams dropped, cuz' af-packet [or af-xdp] ring was full")
+    ,   __METRIC(ssource_statistics,    "bproxy_source_ring_freezes_total",         ring_freezes,       "Times af-packet ring queue was frozen [or af-xdp fill ring was empty]")
+};
+
+static const _ssource_metric _gsink_metrics[] = {
+        __METRIC(ssink_statistics,      "bproxy_sink_relayed_total",                relayed,            "Datagrams queued by sink [per target]")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_fragmented_total",             fragmented,         "Queued datagrams which required fragmentation")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_rejected_portrange_total",     rejected_portrange, "Datagrams rejected by sink's port-range")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_rejected_allow_total",         rejected_allow,     "Datagrams rejected by sink's allow")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_rejected_loop_total",          rejected_loop,      "Datagrams not relayed back to their network")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_rejected_ttl_total",           rejected_ttl,       "Datagrams rejected due to low ttl")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_rejected_mtu_total",           rejected_mtu,       "Datagrams rejected, cuz' fragmentation is disabled")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_sent_total",                   sent,               "IP datagrams [fragments] accepted by kernel")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_failed_total",                 failed,             "IP datagrams dropped by send errors")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_partial_total",                partial,            "Send calls which sent less than queued")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_segmented_total",              segmented,          "Datagrams sent coalesced by UDP_SEGMENT")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_framed_total",                 framed,             "Datagrams sent as frames by af-packet tx ring [or af-xdp]")
+    ,   __METRIC(ssink_statistics,      "bproxy_sink_posted_total",                 posted,             "Datagrams sent in place from af-xdp umem")
+};
+
+#undef __METRIC
+
+static inline uint64_t
+_source_metric_value (
+    IN  const void*                     statistics,
+    IN  const _ssource_metric*          metric
+) { return *((const uint64_t*)((const ubyte_t*)statistics + metric->offset)); }
+
+//histograms are merged per source [they're too large to be snapshotted at once]
+static void
+_sources_metrics_latency (
+    IN  ssource*                        source,
+    BTH smetrics*                       metrics
 ) {
-    ssource* _source = CONTAINEROF(pollable, ssource, ss.runtime.pollable);
+    size_t _sinks = 0;
+    int    _any   = 0;
 
-    if (0 != (flags & (FPOLLABLE_ERR | FPOLLABLE_HUP))) {
-        LOG(verbose, "source %p failed", _source);
-        source_stop(_source);
-        return rpoll_handler_ok;
+    for (ssource* _current = source; NULL != _current; _current = _current->next) {
+        if (_sinks < _source_sinks_count(_current))
+            _sinks = _source_sinks_count(_current);
+
+        if (esource_latency_none != _current->latency)
+            _any = 1;
     }
 
-    switch (_source->type) {
-        case esource_type_simple:
-            return _source_poll_handler_simple(_source, pollable, passthrou);
+    if (0 == _any)
+        return;
 
-        case esource_type_raw:
-            return _source_poll_handler_raw(_source, pollable, passthrou);
+    ssource_latency* _source = (ssource_latency*)_statistics_allocate(sizeof(ssource_latency) + (_sinks * sizeof(ssink_latency)));
+
+    if NULL_IS(_source) {
+        LOG(critical, "out of memory: latency histograms");
+
+        metrics->failed = 1;
+        return;
     }
 
-    return rpoll_handler_failed;
-}
+    ssink_latency* _sink = (ssink_latency*)(_source + 1);
+    char           _labels[64];
 
-rsource
-source_start (
-    BTH ssource*                        source
-) { 
-    if (rsource_ok == source_state(source))
-        return rsource_ok;
+    //series of family must be grouped, so sources are merged once per family
+    for (size_t _f = 0; _f < 4; ++_f) {
+        static const char* _names[] = {"bproxy_source_queue_seconds", "bproxy_source_process_seconds", "bproxy_sink_queue_seconds", "bproxy_sink_send_seconds"};
+        static const char* _helps[] = {
+                "Time datagrams spent in source's socket queue [kernel timestamps]"
+            ,   "Time from receive until datagram was sent to all sinks"
+            ,   "Time datagrams waited in tx queue for sink's send"
+            ,   "Time of sink's send calls"
+        };
 
-    LOG(verbose, "starting source %p", source);
+        metrics_family(metrics, _names[_f], "histogram", _helps[_f]);
 
-    socket_t _socket = SOCKET_INVALID;
+        size_t _i = 0;
 
-    switch (source->type) {
-        case esource_type_simple: {
-            struct sockaddr_in _binding;
-            _binding.sin_family      = AF_INET;
-            _binding.sin_port        = source->port;
-            _binding.sin_addr.s_addr = source->binding.address;
+        for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i) {
+            if NULL_IS(_current->timing)
+                continue;
 
-            LOG(debug, IPV4_PRIADDR":%d", IPV4_DPRIADDR(source->binding.address), (int)ntohs(source->port));
+            if ((0 == _f) && (esource_latency_kernel != _current->latency))
+                continue;
 
-            _socket = socket_open (
-                    source->flg_socket
-                ,   (struct sockaddr*)&_binding
-                ,   rtlink_listener_device_name(&(source->ss.runtime.device))
-            );
+            _source_latency_sum(_current, _source, _sink);
 
-            break;
-        }
+            if (2 > _f) {
+                snprintf(_labels, sizeof(_labels), "source=\"%lu\",port=\"%u\"", (unsigned long)_i, (unsigned int)ntohs(_current->port));
+                histogram_metrics((0 == _f)?&(_source->queue):&(_source->process), metrics, _names[_f], _labels);
+                continue;
+            }
 
-        case esource_type_raw: {
-            _socket = socket_raw(source->flg_socket, rtlink_listener_device_name(&(source->ss.runtime.device)));
-            break;
+            for (size_t _j = 0; _j < _source_sinks_count(_current); ++_j) {
+                snprintf(_labels, sizeof(_labels), "source=\"%lu\",sink=\"%lu\"", (unsigned long)_i, (unsigned long)_j);
+                histogram_metrics((2 == _f)?&(_sink[_j].queue):&(_sink[_j].send), metrics, _names[_f], _labels);
+            }
         }
     }
 
-    if SOCKET_INVALID_IS(_socket) {
-        LOG(verbose, "source socket restarting failed"); 
-        return rsource_failed;
+    free(_source);
+}
+
+/** KIM: metrics
+        lanes are summed into snapshot first, so families are printed from it
+        without touching sources again. sources and sinks are labeled by index
+        in configuration, sources by port too
+**/
+void
+sources_metrics (
+    IN  ssource*                        source,
+    BTH smetrics*                       metrics
+) {
+    size_t _sources = 0;
+    size_t _sinks   = 0;
+
+    for (ssource* _current = source; NULL != _current; _current = _current->next) {
+        _sources++;
+        _sinks += _source_sinks_count(_current);
     }
 
-    for (smgroup* _mgroup = source->mgroups; NULL != _mgroup; _mgroup = _mgroup->next) 
-        if (rsocket_ok != socket_mgroup_join(_socket, _mgroup->group, source->binding.address, rtlink_listener_index(&(source->ss.runtime.device)))) {
-            LOG(verbose, "can't join multicast group");
-            socket_close(_socket);
-            return rsource_failed;
+    ssource_statistics* _source_snapshot = (ssource_statistics*)_statistics_allocate((_sources + 1) * sizeof(ssource_statistics));
+    ssink_statistics*   _sink_snapshot   = (ssink_statistics*)  _statistics_allocate((_sinks   + 1) * sizeof(ssink_statistics));
+
+    if (NULL_IS(_source_snapshot) || NULL_IS(_sink_snapshot)) {
+        LOG(critical, "out of memory: metrics snapshot");
+
+        metrics->failed = 1;
+        goto _cleanup;
+    }
+
+    size_t _sink = 0;
+    size_t _i    = 0;
+
+    for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i) {
+        if NULL_IS(_current->statistics) {
+            memset(&(_source_snapshot[_i]), 0, sizeof(ssource_statistics));
+            memset(&(_sink_snapshot[_sink]), 0, _source_sinks_count(_current) * sizeof(ssink_statistics));
+
+        } else {
+            _source_statistics_sum(_current, &(_source_snapshot[_i]), &(_sink_snapshot[_sink]));
         }
 
-    pollable_socket_set(_source_pollable(source), _socket);
+        _sink += _source_sinks_count(_current);
+    }
 
-    if (rpoll_ok != poll_attach(_source_pollable(source))) {
-        LOG(verbose, "can't add source to poll");
+    metrics_family(metrics, "bproxy_source_up", "gauge", "Source's socket is alive");
 
-        socket_close(_socket);
-        pollable_socket_set(_source_pollable(source), SOCKET_INVALID);
-        return rsource_failed;
+    _i = 0;
+    for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i)
+        metrics_printf(metrics, "bproxy_source_up{source=\"%lu\",port=\"%u\"} %d\n"
+            , (unsigned long)_i, (unsigned int)ntohs(_current->port), (rsource_ok == source_state(_current))?1:0
+        );
+
+    metrics_family(metrics, "bproxy_source_lanes", "gauge", "Source's receiving lanes [workers]");
+
+    _i = 0;
+    for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i)
+        metrics_printf(metrics, "bproxy_source_lanes{source=\"%lu\",port=\"%u\"} %lu\n"
+            , (unsigned long)_i, (unsigned int)ntohs(_current->port), (unsigned long)_current->workers
+        );
+
+    for (size_t _m = 0; _m < (sizeof(_gsource_metrics) / sizeof(_gsource_metrics[0])); ++_m) {
+        const _ssource_metric* _metric = &(_gsource_metrics[_m]);
+
+        metrics_family(metrics, _metric->name, "counter", _metric->help);
+
+        _i = 0;
+        for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i)
+            metrics_printf(metrics, "%s{source=\"%lu\",port=\"%u\"} %"PRIu64"\n"
+                , _metric->name, (unsigned long)_i, (unsigned int)ntohs(_current->port), _source_metric_value(&(_source_snapshot[_i]), _metric)
+            );
     }
 
-    LOG(verbose, "source %p alive", source);
+    for (size_t _m = 0; _m < (sizeof(_gsink_metrics) / sizeof(_gsink_metrics[0])); ++_m) {
+        const _ssource_metric* _metric = &(_gsink_metrics[_m]);
 
-    return rsource_ok;
-}
+        metrics_family(metrics, _metric->name, "counter", _metric->help);
 
-rsource
-source_stop (
-    BTH ssource*                        source
-) {
-    if (rsource_ok != source_state(source))
-        return rsource_ok;
+        _i    = 0;
+        _sink = 0;
 
-    LOG(verbose, "stoping source %p", source);
+        for (ssource* _current = source; NULL != _current; _current = _current->next, ++_i) {
+            size_t _j = 0;
 
-    if (rpoll_ok != poll_detach(_source_pollable(source)))
-        return rsource_failed;
+            for (ssink* _c_sink = _current->sinks; NULL != _c_sink; _c_sink = _c_sink->next, ++_j, ++_sink)
+                metrics_printf(metrics, "%s{source=\"%lu\",sink=\"%lu\"} %"PRIu64"\n"
+                    , _metric->name, (unsigned long)_i, (unsigned long)_j, _source_metric_value(&(_sink_snapshot[_sink]), _metric)
+                );
+        }
+    }
 
-    socket_close(pollable_socket(_source_pollable(source)));
+    _sources_metrics_latency(source, metrics);
 
-    pollable_socket_set(_source_pollable(source), SOCKET_INVALID);
-    return rsource_ok;
+    _cleanup:
+        free(_source_snapshot);
+        free(_sink_snapshot);
 }
 
 rsource
-source_state (
-    BTH ssource*                source
+sources_cleanup (
+    BTH ssource*                        source,
+        ssource*                        until
 ) {
-    if SOCKET_INVALID_IS(pollable_socket(_source_pollable(source)))
-        return rsource_failed;
+    for (ssource* _current = source; until != _current; _current = _current->next)
+        _source_lanes_cleanup(_current);
 
     return rsource_ok;
 }
 
-static void
-_sinks_cleanup (
-    BTH ssource*                        source,
-    BTH ssink*                          until
+static int
+_source_same (
+    IN  const ssource*                  a,
+    IN  const ssource*                  b
 ) {
-    for (ssink* _sink = source->sinks; _sink != until; _sink = _sink->next) {
-        if (rsource_ok != _sink_stop(_sink))
-            LOG(error, "can't stop sink while cleanup");
+    if (NULL_IS(a->signature) || NULL_IS(b->signature))
+        return 0;
 
-        switch (_sink->type) {
-            case esink_type_simple:
-                if (rnetlink_ok != rtlink_listener_detach(&(_sink->ts.simple.device.runtime)))
-                    LOG(error, "can't detach listener while cleaning up");
+    if (a->signature_length != b->signature_length)
+        return 0;
 
-                break;
+    return (0 == memcmp(a->signature, b->signature, a->signature_length));
+}
 
-            case esink_type_join:
-                if (rnetlink_ok != rtlink_listener_detach(&(_sink->ts.join.runtime.device)))
-                    LOG(error, "can't detach listener while cleaning up");
+//running source which was matched to some of first count next ones
+static int
+_source_reused (
+    IN  ssource**                       reused,
+        size_t                          count,
+    IN  const ssource*                  source
+) {
+    for (size_t _i = 0; _i < count; ++_i)
+        if (source == reused[_i])
+            return 1;
 
-                break;
-        }
-    }
+    return 0;
 }
 
-static rsource
-_source_bootup (
-    BTH ssource*                        source,
+rsource
+sources_reload (
+    BTH ssource**                       current,
+    BTH ssource**                       next,
     BTH srtlink*                        rtlink,
-    BTH spoll*                          poll
+    BTH spoll**                         polls,
+        size_t                          polls_count,
+        size_t                          buffer_size
 ) {
-    LOG(verbose, "bootup source %p", source);
+    size_t _count = 0;
 
-    if (rnetlink_ok != rtlink_listener_attach(&(source->ss.runtime.device), rtlink, source->ss.configuration.device, _source_rtlink_handler))
-        return rsource_failed;
-
-    pollable_initialize(_source_pollable(source), poll, _source_poll_handler, SOCKET_INVALID, FPOLLABLE_IN);
+    for (ssource* _next = *next; NULL != _next; _next = _next->next)
+        _count++;
 
-    //bootup sinks
-    for (ssink* _sink = source->sinks; NULL != _sink; _sink = _sink->next)
-        switch (_sink->type) {
-            case esink_type_simple:
-                if (rnetlink_ok != rtlink_listener_attach(&(_sink->ts.simple.device.runtime), rtlink, _sink->ts.simple.device.configuration, _sink_rtlink_handler_simple)) {
-                    _sinks_cleanup(source, _sink);
-                    return rsource_failed;
-                }
+    //running source which replaces next one at the same position, NULL - next one is new
+    ssource** _reused = (ssource**)calloc(_count + 1, sizeof(ssource*));
 
-                break;
+    if NULL_IS(_reused) {
+        LOG(critical, "out of memory: reload [%lu]", (unsigned long)((_count + 1) * sizeof(ssource*)));
+        return rsource_failed;
+    }
 
-            case esink_type_join: {
-                if (rnetlink_ok != rtlink_listener_attach(&(_sink->ts.join.runtime.device), rtlink, _sink->ts.join.configuration.device, _sink_rtlink_handler_join)) {
-                    _sinks_cleanup(source, _sink);
-                    return rsource_failed;
-                }
+    size_t _i = 0;
 
+    for (ssource* _next = *next; NULL != _next; _next = _next->next, ++_i)
+        for (ssource* _current = *current; NULL != _current; _current = _current->next)
+            if (_source_same(_current, _next) && (0 == _source_reused(_reused, _i, _current))) {
+                _reused[_i] = _current;
                 break;
             }
-        }
 
-    return rsource_ok;
-}
+    //new sources are booted up first, so failure changes nothing
+    size_t _poll = 0;
 
-static rsource
-_source_cleanup (
-    BTH ssource*                        source
-) {
-    LOG(verbose, "cleanup source %p", source);
+    _i = 0;
+    for (ssource* _next = *next; NULL != _next; _next = _next->next, ++_i) {
+        if (NULL != _reused[_i])
+            continue;
 
-    rtlink_listener_detach(&(source->ss.runtime.device));
-    pollable_clear(_source_pollable(source));
-    _sinks_cleanup(source, NULL);
+        if (rsource_ok != _source_lanes_bootup(_next, rtlink, polls, polls_count, &_poll, buffer_size)) {
+            LOG(error, "can't bootup new source, reload rolled back");
 
-    return rsource_ok;
-}
+            size_t _j = 0;
 
-rsource
-sources_cleanup (
-    BTH ssource*                        source,
-        ssource*                        until
-) {
-    for (ssource* _current = source; until != _current; _current = _current->next) {
-        if (rsource_ok != source_stop(_current)) {
-            LOG(critical, "source stop failed, ignored");
+            for (ssource* _booted = *next; _next != _booted; _booted = _booted->next, ++_j)
+                if NULL_IS(_reused[_j])
+                    _source_lanes_cleanup(_booted);
+
+            free(_reused);
+            return rsource_failed;
         }
+    }
 
-        if (rsource_ok != _source_cleanup(_current)) {
-            LOG(critical, "source cleanup failed, ignored");
+    //running sources take places of their duplicates, which are released with retired ones
+    ssource*  _parsed  = NULL;
+    ssource** _link    = next;
+    size_t    _kept    = 0;
+    size_t    _retired = 0;
+    size_t    _started = 0;
+
+    _i = 0;
+    while (NULL != (*_link)) {
+        ssource* _next    = (*_link);
+        ssource* _current = _reused[_i++];
+
+        if NULL_IS(_current) {
+            _link = &(_next->next);
+            continue;
         }
+
+        for (ssource** _c_link = current; NULL != (*_c_link); _c_link = &((*_c_link)->next))
+            if (_current == (*_c_link)) {
+                (*_c_link) = _current->next;
+                break;
+            }
+
+        _current->next = _next->next;
+        (*_link)       = _current;
+        _link          = &(_current->next);
+
+        _next->next = _parsed;
+        _parsed     = _next;
+
+        _kept++;
+    }
+
+    //retired are stopped before new ones start, changed source may bind the same port
+    for (ssource* _current = *current; NULL != _current; _current = _current->next, ++_retired)
+        _source_lanes_retire(_current);
+
+    _i = 0;
+    for (ssource* _next = *next; NULL != _next; _next = _next->next, ++_i) {
+        if (NULL != _reused[_i])
+            continue;
+
+        for (size_t _lane = 0; _lane < _next->workers; ++_lane)
+            if (rsource_ok != source_start(_source_lane(_next, _lane)))
+                LOG(verbose, "source start failed, restore timer will retry");
+
+        _started++;
     }
 
+    ssource** _tail = current;
+
+    while (NULL != (*_tail))
+        _tail = &((*_tail)->next);
+
+    (*_tail) = _parsed;
+
+    free(_reused);
+    _sources_generation_bump();
+
+    LOG(information, "reload: %lu sources kept, %lu started, %lu retired", (unsigned long)_kept, (unsigned long)_started, (unsigned long)_retired);
     return rsource_ok;
 }
 
+void
+sources_release (
+    BTH ssource*                        source
+) {
+    for (ssource* _current = source; NULL != _current; _current = _current->next)
+        _source_lanes_free(_current);
+}
+
 rsource
 sources_restart (
     BTH ssource*                source
@@ -1248,9 +4650,10 @@ sources_restart (
     LOG(debug, "restarting sources");
 
     for (ssource* _current = source; NULL != _current; _current = _current->next)
-        if (rsource_ok != source_restart(_current)) {
-            LOG(verbose, "source restart failed, ignored");
-        }
+        for (size_t _i = 0; _i < _current->workers; ++_i)
+            if (rsource_ok != source_restart(_source_lane(_current, _i))) {
+                LOG(verbose, "source restart failed, ignored");
+            }
 
     return rsource_ok;
 }
@@ -1260,9 +4663,10 @@ sources_start (
     BTH ssource*                source
 ) {
     for (ssource* _current = source; NULL != _current; _current = _current->next)
-        if (rsource_ok != source_start(_current)) {
-            LOG(verbose, "source start failed, ignored");
-        }
+        for (size_t _i = 0; _i < _current->workers; ++_i)
+            if (rsource_ok != source_start(_source_lane(_current, _i))) {
+                LOG(verbose, "source start failed, ignored");
+            }
 
     return rsource_ok;
 }
@@ -1271,10 +4675,14 @@ rsource
 sources_bootup (
     BTH ssource*                        source,
     BTH srtlink*                        rtlink,
-    BTH spoll*                          poll
+    BTH spoll**                         polls,
+        size_t                          polls_count,
+        size_t                          buffer_size
 ) {
+    size_t _poll = 0;
+
     for (ssource* _current = source; NULL != _current; _current = _current->next)
-        if (rsource_ok != _source_bootup(_current, rtlink, poll)) {
+        if (rsource_ok != _source_lanes_bootup(_current, rtlink, polls, polls_count, &_poll, buffer_size)) {
             LOG(error, "can't bootup all sources, rollback");
             sources_cleanup(source, _current);
             return rsource_failed;
@@ -1282,4 +4690,3 @@ sources_bootup (
 
     return rsource_ok;
 }
-
@@ -10,8 +10,16 @@
 #include "ipv4.h"
 #include "socket.h"
 #include "poll.h"
+#include "timer.h"
 #include "rtlink.h"
 #include "ratelimit.h"
+#include "metrics.h"
+#include "histogram.h"
+#include "xdp.h"
+
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <pthread.h>
 
 typedef
 struct _source          ssource;
@@ -19,6 +27,9 @@ struct _source          ssource;
 typedef
 struct _sink            ssink;
 
+typedef
+struct _sink_cold       ssink_cold;
+
 typedef
 enum {
         esource_type_simple     = 0
@@ -28,6 +39,93 @@ enum {
 typedef
 struct _mgroup          smgroup;
 
+typedef
+struct _source_batch    ssource_batch;
+
+typedef
+struct _source_tx       ssource_tx;
+
+typedef
+struct _source_flows    ssource_flows;
+
+typedef
+struct _source_xdp      ssource_xdp;
+
+typedef
+struct _source_statistics   ssource_statistics;
+
+typedef
+struct _sink_statistics     ssink_statistics;
+
+typedef
+struct _source_latency      ssource_latency;
+
+typedef
+struct _sink_latency        ssink_latency;
+
+typedef
+enum {
+        esource_latency_none    = 0
+    ,   esource_latency_process         //processing & sending only
+    ,   esource_latency_kernel          //... and socket queueing by kernel receive timestamps
+} esource_latency;
+
+/** KIM: statistics
+        counters are written by lane's worker only, so they are plain [non
+        atomic] and every lane's block is cache line aligned. control plane
+        reads them while workers are locked [see poll guard]
+**/
+struct _source_statistics {
+    uint64_t                    received;           //datagrams
+    uint64_t                    malformed;
+    uint64_t                    relayed;            //accepted by checks & rate-limit
+    uint64_t                    rejected_portrange;
+    uint64_t                    rejected_allow;     //allow, m-groups, martians
+    uint64_t                    rejected_ratelimit;
+    uint64_t                    flow_hit;
+    uint64_t                    flow_miss;
+    uint64_t                    coalesced;          //received datagrams, which came coalesced by UDP_GRO
+    uint64_t                    ring_drops;         //af-packet ring was full [PACKET_STATISTICS], af-xdp rx one too [XDP_STATISTICS]
+    uint64_t                    ring_freezes;       //... and kernel froze its queue [af-xdp fill ring was empty]
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+struct _sink_statistics {
+    uint64_t                    relayed;            //datagrams queued to targets
+    uint64_t                    fragmented;         //... which required fragmentation
+    uint64_t                    rejected_portrange;
+    uint64_t                    rejected_allow;
+    uint64_t                    rejected_loop;
+    uint64_t                    rejected_ttl;
+    uint64_t                    rejected_mtu;       //fragmentation required, but disabled
+
+    uint64_t                    sent;               //ip datagrams [fragments] accepted by kernel
+    uint64_t                    partial;            //sendmmsg calls which sent less than queued
+    uint64_t                    failed;             //ip datagrams dropped by send errors
+    uint64_t                    segmented;          //... sent ones, which were coalesced into UDP_SEGMENT sends
+    uint64_t                    framed;             //... sent ones, which were written into af-packet tx ring [or posted]
+    uint64_t                    posted;             //... framed ones, which were sent in place from af-xdp umem
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** KIM: latency
+        processing starts when receive syscall returns [CLOCK_MONOTONIC_RAW, one
+        stamp per syscall, so batch shares it], socket queueing is measured from
+        kernel receive timestamp [SO_TIMESTAMPNS, realtime] to the same moment.
+        sink's queueing is the time datagrams waited in tx queue for its
+        sendmmsg, sending is the sendmmsg itself
+**/
+struct _source_latency {
+    uint64_t                    begin;      //processing start, monotonic raw ns
+    uint64_t                    begin_real; //... realtime ns, for kernel timestamps
+
+    shistogram                  queue;      //socket queue
+    shistogram                  process;    //until last datagram sent
+};
+
+struct _sink_latency {
+    shistogram                  queue;      //tx queue
+    shistogram                  send;
+};
+
 struct _mgroup {
     ipv4_t                      group;
 
@@ -53,15 +151,45 @@ struct _source {
 
     } ss;   //state specific
 
+    size_t                      batch;      //datagrams per recvmmsg, 1 - plain recvmsg
+    ssource_batch*              rx;         //runtime, allocated at bootup if batch > 1
+
+    size_t                      ring_blocks;        //raw source: af-packet rx ring, 0 - raw socket [see KIM: af-packet ring]
+    size_t                      ring_block_size;
+    ssocket_ring                ring;               //runtime, mapped while started
+    size_t                      xdp_frames;         //raw source: af-xdp umem frames [per lane], 0 - no af-xdp [see KIM: af-xdp source]
+    ssource_xdp*                xdp;                //runtime, lane's umem & socket while started
+    sxdp_program*               xdp_program;        //runtime, device's program, shared by lanes
+    stimer                      xdp_timer;          //runtime, reclaims frames held by sinks while rx is idle
+    ssource_tx*                 tx;         //runtime, transmit queue [sendmmsg]
+    ssource_flows*              flows;      //runtime, decision cache
+    ssource_statistics*         statistics; //runtime, lane's block: source's counters, then sinks' ones
+
+    esource_latency             latency;
+    ssource_latency*            timing;     //runtime, lane's histograms, then sinks' ones, NULL - disabled
+
+    size_t                      workers;    //lanes: reuseport sockets bound identically, 1 - single socket
+    esocket_steering            steering;
+    size_t                      lane;       //runtime, index of this lane
+    ssource*                    lanes;      //runtime, workers - 1 clones of source with own socket & sinks
+
     sratelimit*                 ratelimit;
+    pthread_mutex_t*            ratelimit_guard;    //runtime, rate-limit is shared among lanes
 
     sipv4_allow*                allow;
+    sipv4_classifier*           classifier; //compiled allow, NULL - walk list
     sipv4_portrange*            portrange;
+    sipv4_ports*                ports;      //compiled portrange
 
     smgroup*                    mgroups;
 
     ssink*                      sinks;
 
+    void*                       arena;      //sinks, rate-limit, allow, m-groups & port-ranges, NULL - nodes are allocated one by one
+
+    char*                       signature;  //source's & sinks' options as parsed, reload keeps source if it's the same
+    size_t                      signature_length;
+
     ssource*                    next;
 };
 
@@ -100,7 +228,9 @@ rsource
 sources_bootup (
     BTH ssource*                source,
     BTH srtlink*                rtlink,
-    BTH spoll*                  poll
+    BTH spoll**                 polls,
+        size_t                  polls_count,
+        size_t                  buffer_size
 );
 
 rsource 
@@ -113,6 +243,51 @@ sources_start (
     BTH ssource*                source
 );
 
+//logs counters of sources and sinks, lanes are summed
+void
+sources_statistics (
+    IN  ssource*                source
+);
+
+//appends counters of sources and sinks in prometheus text format, lanes are summed
+void
+sources_metrics (
+    IN  ssource*                source,
+    BTH smetrics*               metrics
+);
+
+//drops cached flow decisions of all sources, call on configuration changes
+void
+sources_invalidate (
+);
+
+/** KIM: reload
+        sources of next configuration which have the same signature as running
+        ones are replaced by them [with sockets, lanes, listeners & counters],
+        so they don't miss a packet. other next sources are booted up, then
+        running sources which weren't reused are stopped and started ones are
+        started [changed source on the same port is rebound].
+
+        failure leaves both lists untouched. on success current holds retired
+        sources: stopped, but not freed - worker may hold stale event of their
+        pollable right now, so they must be released on next reload [or exit]
+**/
+rsource
+sources_reload (
+    BTH ssource**               current,
+    BTH ssource**               next,
+    BTH srtlink*                rtlink,
+    BTH spoll**                 polls,
+        size_t                  polls_count,
+        size_t                  buffer_size
+);
+
+//frees runtime of retired [by sources_reload] sources, configuration is freed by owner
+void
+sources_release (
+    BTH ssource*                source
+);
+
 rsource
 sources_cleanup (
     BTH ssource*                source,
@@ -142,6 +317,43 @@ enum {
 #define FSINK_REWRITE_SECURITY                  (1 << 20)
 #define FSINK_REWRITE_SECURITY_DROP             (1 << 21)
 
+#define FSINK_REWRITE_TRANSPORT_UDP             (1 << 24)   //udp socket bound to "from", kernel builds headers
+#define FSINK_REWRITE_TRANSPORT_PACKET          (1 << 25)   //broadcasts are framed into af-packet tx ring
+
+//which template fields are patched per packet, others are prebuilt
+#define FSINK_TEMPLATE_SADDR                    (1 <<  0)
+#define FSINK_TEMPLATE_SPORT                    (1 <<  1)
+#define FSINK_TEMPLATE_DADDR                    (1 <<  2)   //original destination
+#define FSINK_TEMPLATE_TOS                      (1 <<  3)
+#define FSINK_TEMPLATE_TTL                      (1 <<  4)   //decremented packet's ttl
+#define FSINK_TEMPLATE_ID                       (1 <<  5)   //packet's id, otherwise sink's counter
+
+typedef
+struct _sink_target     ssink_target;
+
+struct _sink_target {
+    sipv4_network               network;    //target network, used for loop detection
+    struct sockaddr_in          address;    //port patched per packet
+
+    struct iphdr                iphdr;      //without options
+    struct udphdr               udphdr;
+};
+
+typedef
+struct _sink_options    ssink_options;
+
+struct _sink_options {
+    uint32_t                    hash;       //of received options
+    uint8_t                     valid;
+
+    uint8_t                     key_length;
+    uint8_t                     length;     //rewritten options length
+    uint8_t                     fragments;  //options length for non-first fragments
+
+    ubyte_t                     key[IPV4_MAX_OPTIONS_LENGTH];
+    ubyte_t                     options[IPV4_MAX_OPTIONS_LENGTH];
+};
+
 typedef
 struct _ipv4_option sipv4_option;
 
@@ -151,13 +363,16 @@ struct _ipv4_option {
     ubyte_t             data[];
 };
 
-struct _sink {
-    esink_type          type;
-    uint32_t            flg_socket;
-
-    socket_t            socket;
+/** KIM: sink
+        hot part is what relay touches for every datagram, it's one cache line
+        and sinks of source [or lane] are array of them [see arena]. cold part
+        keeps configuration, listeners, allow list, ip options cache and is
+        reached only by rtlink changes, allow walks and datagrams with options
+**/
+struct _sink_cold {
+    ssink*                      sink;       //hot part, for listeners' handlers
 
-    uint16_t            last_ip_id;
+    uint32_t                    flg_socket;
 
     union {
         struct {
@@ -183,10 +398,7 @@ struct _sink {
 
     } ts;   //type specific
 
-    uint32_t                    rewrite;    //FSINK_REWRITE_xxx
-
     sipv4_destination           from;       //from address & port rewrite
-    uint16_t                    port;       //destination port
 
     ttl_t                       ttl;
     tos_t                       tos;
@@ -199,9 +411,49 @@ struct _sink {
     sipv4_option*               option;
 
     sipv4_allow*                allow;
+    sipv4_classifier*           classifier; //compiled allow, NULL - walk list
     sipv4_portrange*            portrange;
 
-    ssink*                      next;
+    ssink_latency*              timing;     //runtime, in source's histograms block, NULL - disabled
+
+    struct {
+        socket_t                    socket;     //SOCKET_INVALID - no ring, broadcasts are routed
+        ssocket_ring                ring;
+        device_index_t              index;
+        device_mtu_t                mtu;        //device's, longer datagrams are routed
+        ubyte_t                     ethernet[ETHER_HDR_LEN];    //broadcast, device's address & ip type
+
+        ssource_xdp*                xdp;        //source's [lane's] umem, NULL - source has no af-xdp
+        sxdp_socket                 xsk;        //... sharing it, SOCKET_INVALID - frames are copied
+        size_t                      posted;     //descriptors submitted since last kick
+    } packet;   //runtime, packet transport [see KIM: packet transport]
+
+    ssink_options               options[SINK_OPTIONS_CACHE_SIZE];   //runtime, rewritten ip options by received ones
 };
 
+struct _sink {
+    ssink*                      next;
+    ssink_cold*                 cold;
+
+    socket_t                    socket;
+    uint32_t                    rewrite;    //FSINK_REWRITE_xxx
+
+    struct {
+        ssink_target*               targets;    //simple - single target, join - one per device address
+        device_mtu_t                mtu;
+        uint16_t                    patch;      //FSINK_TEMPLATE_xxx
+        uint16_t                    count;
+    } template; //runtime, rebuilt on start and rtlink changes
+
+    sipv4_ports*                ports;      //compiled portrange
+    ssink_statistics*           statistics; //runtime, in source's block
+
+    uint16_t                    port;       //destination port
+    uint16_t                    last_ip_id;
+    uint16_t                    ip_id_step; //lanes interleave ip ids
+
+    uint8_t                     type;       //esink_type
+    uint8_t                     filtered;   //cold part has allow list
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
 #endif
@@ -3,7 +3,7 @@
     Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
 **/
 
-#if !defined(BRPOXY_TIMER)
+#if !defined(BPROXY_TIMER)
 #define BPROXY_TIMER
 
 #include "bproxy.h"
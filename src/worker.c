@@ -0,0 +1,268 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "worker.h"
+#include "log.h"
+#include "errno.h"
+
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+LOG_MODULE("worker");
+
+static void
+_worker_lock (
+        void*               context
+) { pthread_mutex_lock(&(((sworker*)context)->mutex)); }
+
+static void
+_worker_unlock (
+        void*               context
+) { pthread_mutex_unlock(&(((sworker*)context)->mutex)); }
+
+static rpoll_handler
+_worker_wakeup_handler (
+    BTH spollable*          pollable,
+        uint32_t            flags,
+    BTH spoll_passthrou*    passthrou
+) {
+    (void)flags;
+    (void)passthrou;
+
+    uint64_t _value;
+
+    FOREVER {
+        if (0 < read(pollable_socket(pollable), &_value, sizeof(_value)))
+            return rpoll_handler_ok;
+
+        if EINTR_IS(errno) continue;
+
+        return rpoll_handler_ok; //EAGAIN, someone else already drained it
+    }
+}
+
+static void*
+_worker_routine (
+        void*               context
+) {
+    sworker* _worker = (sworker*)context;
+
+    LOG(verbose, "worker %lu started", (unsigned long)_worker->index);
+
+    while (0 != __atomic_load_n(&(_worker->working), __ATOMIC_ACQUIRE)) switch (poll_wait(&(_worker->poll), &(_worker->poll_thread), -1)) {
+        case rpoll_ok:
+        case rpoll_timeout:
+        case rpoll_interrupted:
+            break;
+
+        case rpoll_failed:
+            //same as single threaded mode: handler failure stops whole process
+            LOG(error, "worker %lu: poll wait failed, stopping", (unsigned long)_worker->index);
+
+            __atomic_store_n(&(_worker->working), 0, __ATOMIC_RELEASE);
+            kill(getpid(), SIGTERM);
+            break;
+    }
+
+    LOG(verbose, "worker %lu stopped", (unsigned long)_worker->index);
+    return NULL;
+}
+
+static void
+_worker_cleanup (
+    BTH sworker*            worker
+) {
+    poll_detach(&(worker->wakeup));
+    close(pollable_socket(&(worker->wakeup)));
+    pollable_clear(&(worker->wakeup));
+
+    poll_thread_detach(&(worker->poll_thread), &(worker->poll));
+    poll_destroy(&(worker->poll));
+
+    pthread_mutex_destroy(&(worker->mutex));
+}
+
+static rworker
+_worker_create (
+    OUT sworker*            worker,
+        size_t              index,
+        size_t              buffer_size,
+        size_t              events_size
+) {
+    worker->index   = index;
+    worker->working = 0;
+    worker->started = 0;
+
+    if (0 != pthread_mutex_init(&(worker->mutex), NULL)) {
+        LOG(error, "worker %lu: can't initialize mutex", (unsigned long)index);
+        goto _failed;
+    }
+
+    if (rpoll_ok != poll_create(&(worker->poll)))
+        goto _failed_poll;
+
+    if (rpoll_ok != poll_thread_attach(&(worker->poll_thread), &(worker->poll), buffer_size, events_size))
+        goto _failed_poll_thread;
+
+    socket_t _wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if SOCKET_INVALID_IS(_wakeup) {
+        LOG(error, "worker %lu: can't create eventfd "PRIerrno, (unsigned long)index, DPRIerrno);
+        goto _failed_eventfd;
+    }
+
+    pollable_initialize(&(worker->wakeup), &(worker->poll), _worker_wakeup_handler, _wakeup, FPOLLABLE_IN);
+
+    if (rpoll_ok != poll_attach(&(worker->wakeup)))
+        goto _failed_wakeup;
+
+    poll_guard_set(&(worker->poll), _worker_lock, _worker_unlock, worker);
+    return rworker_ok;
+
+    _failed_wakeup:
+        close(_wakeup);
+        pollable_clear(&(worker->wakeup));
+
+    _failed_eventfd:
+        poll_thread_detach(&(worker->poll_thread), &(worker->poll));
+
+    _failed_poll_thread:
+        poll_destroy(&(worker->poll));
+
+    _failed_poll:
+        pthread_mutex_destroy(&(worker->mutex));
+
+    _failed:
+        return rworker_failed;
+}
+
+rworker
+workers_create (
+    OUT sworkers*           workers,
+        size_t              count,
+        size_t              buffer_size,
+        size_t              events_size
+) {
+    workers->count   = 0;
+    workers->workers = (sworker*)calloc(count, sizeof(sworker));
+
+    if NULL_IS(workers->workers) {
+        LOG(critical, "out of memory: workers [%lu]", (unsigned long)(count * sizeof(sworker)));
+        return rworker_failed;
+    }
+
+    for (size_t _i = 0; _i < count; ++_i) {
+        //wakeup eventfd takes one event slot
+        if (rworker_ok != _worker_create(&(workers->workers[_i]), _i, buffer_size, events_size + 1)) {
+            workers_destroy(workers);
+            return rworker_failed;
+        }
+
+        workers->count++;
+    }
+
+    return rworker_ok;
+}
+
+rworker
+workers_start (
+    BTH sworkers*           workers
+) {
+    //signals are handled by main thread only
+    sigset_t _all;
+    sigset_t _old;
+
+    sigfillset(&_all);
+    pthread_sigmask(SIG_BLOCK, &_all, &_old);
+
+    rworker _return = rworker_ok;
+
+    for (size_t _i = 0; _i < workers->count; ++_i) {
+        sworker* _worker = &(workers->workers[_i]);
+
+        __atomic_store_n(&(_worker->working), 1, __ATOMIC_RELEASE);
+
+        int _r = pthread_create(&(_worker->thread), NULL, _worker_routine, _worker);
+
+        if (0 != _r) {
+            LOG(error, "worker %lu: can't create thread, cuz' %d [%s]", (unsigned long)_i, _r, strerror(_r));
+
+            _worker->working = 0;
+            _return = rworker_failed;
+            break;
+        }
+
+        _worker->started = 1;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &_old, NULL);
+    return _return;
+}
+
+rworker
+workers_stop (
+    BTH sworkers*           workers
+) {
+    for (size_t _i = 0; _i < workers->count; ++_i) {
+        sworker* _worker = &(workers->workers[_i]);
+
+        if (0 == _worker->started)
+            continue;
+
+        __atomic_store_n(&(_worker->working), 0, __ATOMIC_RELEASE);
+
+        uint64_t _value = 1;
+
+        if (0 > write(pollable_socket(&(_worker->wakeup)), &_value, sizeof(_value)))
+            LOG(error, "worker %lu: can't wakeup "PRIerrno, (unsigned long)_i, DPRIerrno);
+    }
+
+    for (size_t _i = 0; _i < workers->count; ++_i) {
+        sworker* _worker = &(workers->workers[_i]);
+
+        if (0 == _worker->started)
+            continue;
+
+        pthread_join(_worker->thread, NULL);
+        _worker->started = 0;
+    }
+
+    return rworker_ok;
+}
+
+void
+workers_destroy (
+    BTH sworkers*           workers
+) {
+    for (size_t _i = 0; _i < workers->count; ++_i)
+        _worker_cleanup(&(workers->workers[_i]));
+
+    free(workers->workers);
+
+    workers->workers = NULL;
+    workers->count   = 0;
+}
+
+void
+workers_lock (
+        void*               workers
+) {
+    sworkers* _workers = (sworkers*)workers;
+
+    for (size_t _i = 0; _i < _workers->count; ++_i)
+        _worker_lock(&(_workers->workers[_i]));
+}
+
+void
+workers_unlock (
+        void*               workers
+) {
+    sworkers* _workers = (sworkers*)workers;
+
+    for (size_t _i = _workers->count; _i--; )
+        _worker_unlock(&(_workers->workers[_i]));
+}
@@ -0,0 +1,94 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_WORKER)
+#define BPROXY_WORKER
+
+#include "bproxy.h"
+#include "poll.h"
+
+#include <pthread.h>
+
+/** KIM: data plane threads
+        each worker owns its poll, sources [lanes] are spread among workers at
+        bootup, so lane's socket, sinks and ip id counters are touched by single
+        worker only, rate-limit shared by lanes is guarded.
+
+        control plane [rtlink, timers, signals] stays at main poll, it locks
+        all workers while dispatching, workers lock own mutex while dispatching
+**/
+
+typedef
+enum {
+        rworker_ok              = 0
+    ,   rworker_failed
+} rworker;
+
+typedef
+struct _worker          sworker;
+
+typedef
+struct _workers         sworkers;
+
+struct _worker {
+    pthread_t               thread;
+    pthread_mutex_t         mutex;
+
+    spoll                   poll;
+    spoll_thread            poll_thread;
+
+    spollable               wakeup;     //eventfd, used to stop worker
+
+    size_t                  index;
+    volatile int            working;
+    int                     started;
+};
+
+struct _workers {
+    size_t                  count;
+    sworker*                workers;
+};
+
+rworker
+workers_create (
+    OUT sworkers*           workers,
+        size_t              count,
+        size_t              buffer_size,
+        size_t              events_size
+);
+
+rworker
+workers_start (
+    BTH sworkers*           workers
+);
+
+rworker
+workers_stop (
+    BTH sworkers*           workers
+);
+
+void
+workers_destroy (
+    BTH sworkers*           workers
+);
+
+static inline spoll*
+workers_poll (
+    IN  sworkers*           workers,
+        size_t              index
+) { return &(workers->workers[index % workers->count].poll); }
+
+//guard hooks for control plane poll, context is sworkers*
+void
+workers_lock (
+        void*               workers
+);
+
+void
+workers_unlock (
+        void*               workers
+);
+
+#endif
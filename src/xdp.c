@@ -0,0 +1,923 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#include "xdp.h"
+
+#include "utils.h"
+#include "log.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include <linux/if_ether.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+
+LOG_MODULE("xdp");
+
+#define XDP_PROGRAM_MAXIMUM     (8 * FILTER_MAXIMUM)    //translated instructions
+#define XDP_LOG_SIZE            (64 * 1024)
+
+#define XDP_LABEL_PASS          (FILTER_MAXIMUM)        //after classic instructions
+#define XDP_LABEL_ACCEPT        (FILTER_MAXIMUM + 1)
+#define XDP_LABELS              (FILTER_MAXIMUM + 2)
+
+#define XDP_LABEL_NONE          (-1)
+
+static long
+_xdp_bpf (
+        int                     command,
+    BTH union bpf_attr*         attr
+) { return syscall(__NR_bpf, command, attr, sizeof(*attr)); }
+
+rxdp
+xdp_umem_create (
+        size_t                  frames,
+        size_t                  frame_size,
+    OUT sxdp_umem*              umem
+) {
+    memset(umem, 0, sizeof(*umem));
+
+    umem->size = (frames * frame_size);
+    umem->area = (ubyte_t*)mmap(NULL, umem->size, (PROT_READ | PROT_WRITE), (MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE), -1, 0);
+
+    if (MAP_FAILED == umem->area) {
+        LOG(error, "can't allocate umem [%lu bytes], cuz' %d [%s]", (unsigned long)umem->size, errno, strerror(errno));
+
+        umem->area = NULL;
+        return rxdp_failed;
+    }
+
+    umem->frames     = frames;
+    umem->frame_size = frame_size;
+
+    return rxdp_ok;
+}
+
+void
+xdp_umem_destroy (
+    BTH sxdp_umem*              umem
+) {
+    if NULL_IS(umem->area)
+        return;
+
+    munmap(umem->area, umem->size);
+    umem->area = NULL;
+}
+
+static rxdp
+_xdp_ring_map (
+        socket_t                socket,
+    IN  const struct xdp_ring_offset*   offset,
+        size_t                  entries,
+        size_t                  entry_size,
+        off_t                   page_offset,
+    OUT sxdp_ring*              ring
+) {
+    ring->size = (offset->desc + (entries * entry_size));
+    ring->map  = mmap(NULL, ring->size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), socket, page_offset);
+
+    if (MAP_FAILED == ring->map) {
+        LOG(error, "can't map xdp ring [%lu bytes], cuz' %d [%s]", (unsigned long)ring->size, errno, strerror(errno));
+
+        ring->map = NULL;
+        return rxdp_failed;
+    }
+
+    ring->producer = (uint32_t*)((ubyte_t*)ring->map + offset->producer);
+    ring->consumer = (uint32_t*)((ubyte_t*)ring->map + offset->consumer);
+    ring->entries  = (ubyte_t*)ring->map + offset->desc;
+    ring->mask     = (uint32_t)(entries - 1);
+    ring->head     = 0;
+
+    return rxdp_ok;
+}
+
+static void
+_xdp_ring_unmap (
+    BTH sxdp_ring*              ring
+) {
+    if NOT_NULL_IS(ring->map)
+        munmap(ring->map, ring->size);
+
+    memset(ring, 0, sizeof(*ring));
+}
+
+#define _XDP_SOCKOPT(x, y, z, l)                                                                    \
+    do { if (0 > setsockopt(_socket, x, y, &z, sizeof(z))) {                                        \
+        LOG(error, "can't set socket option [" #x ", " #y "], cuz' %d [%s]", errno, strerror(errno)); \
+        goto l;                                                                                     \
+    } } while (0)
+
+rxdp
+xdp_socket_open (
+    OUT sxdp_socket*            xsk,
+    IN  const sxdp_umem*        umem,
+    IN  const sxdp_socket*      shared,
+        device_index_t          index,
+        uint32_t                queue,
+        size_t                  entries
+) {
+    memset(xsk, 0, sizeof(*xsk));
+    xsk->socket = SOCKET_INVALID;
+
+    socket_t _socket = socket(AF_XDP, SOCK_RAW, 0);
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(error, "can't open xdp socket, cuz' %d [%s]", errno, strerror(errno));
+        return rxdp_failed;
+    }
+
+    xsk->socket = _socket;
+
+    if NULL_IS(shared) {
+        struct xdp_umem_reg _umem;
+
+        memset(&_umem, 0, sizeof(_umem));
+
+        _umem.addr       = (uintptr_t)umem->area;
+        _umem.len        = umem->size;
+        _umem.chunk_size = (uint32_t)umem->frame_size;
+        _umem.headroom   = 0;
+
+        _XDP_SOCKOPT(SOL_XDP, XDP_UMEM_REG, _umem, _failed);
+    }
+
+    //socket sharing umem of other device [queue] needs own fill & completion rings
+    int _entries = (int)entries;
+
+    _XDP_SOCKOPT(SOL_XDP, XDP_UMEM_FILL_RING,       _entries, _failed);
+    _XDP_SOCKOPT(SOL_XDP, XDP_UMEM_COMPLETION_RING, _entries, _failed);
+    _XDP_SOCKOPT(SOL_XDP, NULL_IS(shared)?XDP_RX_RING:XDP_TX_RING, _entries, _failed);
+
+    struct xdp_mmap_offsets _offsets;
+    socklen_t               _length = sizeof(_offsets);
+
+    if (0 > getsockopt(_socket, SOL_XDP, XDP_MMAP_OFFSETS, &_offsets, &_length)) {
+        LOG(error, "can't get xdp ring offsets, cuz' %d [%s]", errno, strerror(errno));
+        goto _failed;
+    }
+
+    if (rxdp_ok != _xdp_ring_map(_socket, &(_offsets.fr), entries, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING, &(xsk->fill)))
+        goto _failed;
+
+    if (rxdp_ok != _xdp_ring_map(_socket, &(_offsets.cr), entries, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING, &(xsk->completion)))
+        goto _failed;
+
+    if NULL_IS(shared) {
+        if (rxdp_ok != _xdp_ring_map(_socket, &(_offsets.rx), entries, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING, &(xsk->rx)))
+            goto _failed;
+
+    } else {
+        if (rxdp_ok != _xdp_ring_map(_socket, &(_offsets.tx), entries, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING, &(xsk->tx)))
+            goto _failed;
+    }
+
+    struct sockaddr_xdp _binding;
+
+    memset(&_binding, 0, sizeof(_binding));
+
+    _binding.sxdp_family   = AF_XDP;
+    _binding.sxdp_ifindex  = (uint32_t)index;
+    _binding.sxdp_queue_id = queue;
+
+    //shared socket inherits mode of umem's owner
+    if NOT_NULL_IS(shared) {
+        _binding.sxdp_flags         = XDP_SHARED_UMEM;
+        _binding.sxdp_shared_umem_fd = (uint32_t)shared->socket;
+
+        if (0 > bind(_socket, (struct sockaddr*)&_binding, sizeof(_binding))) {
+            LOG(error, "can't bind xdp socket to device %d queue %"PRIu32" sharing umem, cuz' %d [%s]", index, queue, errno, strerror(errno));
+            goto _failed;
+        }
+
+        xsk->mode = shared->mode;
+        return rxdp_ok;
+    }
+
+    _binding.sxdp_flags = XDP_ZEROCOPY;
+
+    if (0 > bind(_socket, (struct sockaddr*)&_binding, sizeof(_binding))) {
+        LOG(verbose, "device %d queue %"PRIu32" can't do xdp zero copy, cuz' %d [%s], copy mode is used", index, queue, errno, strerror(errno));
+
+        _binding.sxdp_flags = XDP_COPY;
+
+        if (0 > bind(_socket, (struct sockaddr*)&_binding, sizeof(_binding))) {
+            LOG(error, "can't bind xdp socket to device %d queue %"PRIu32", cuz' %d [%s]", index, queue, errno, strerror(errno));
+            goto _failed;
+        }
+    }
+
+    xsk->mode = _binding.sxdp_flags;
+    return rxdp_ok;
+
+    _failed:
+        xdp_socket_close(xsk);
+        return rxdp_failed;
+}
+
+void
+xdp_socket_close (
+    BTH sxdp_socket*            xsk
+) {
+    _xdp_ring_unmap(&(xsk->fill));
+    _xdp_ring_unmap(&(xsk->completion));
+    _xdp_ring_unmap(&(xsk->rx));
+    _xdp_ring_unmap(&(xsk->tx));
+
+    if (! SOCKET_INVALID_IS(xsk->socket))
+        close(xsk->socket);
+
+    xsk->socket = SOCKET_INVALID;
+}
+
+rxdp
+xdp_socket_kick (
+    BTH sxdp_socket*            xsk
+) {
+    uint32_t _pending = xdp_ring_pending(&(xsk->tx));
+
+    while (0 < _pending) {
+        if (0 > sendto(xsk->socket, NULL, 0, MSG_DONTWAIT, NULL, 0)) {
+            switch (errno) {
+                case EINTR:
+                    continue;
+
+                //device is busy [or batch limit is hit], the rest is picked up later
+                case EAGAIN:
+                case EBUSY:
+                case ENOBUFS:
+                    break;
+
+                default:
+                    LOG(error, "xdp socket kick failed, cuz' %d [%s]", errno, strerror(errno));
+                    return rxdp_failed;
+            }
+        }
+
+        uint32_t _left = xdp_ring_pending(&(xsk->tx));
+
+        //no progress, zero copy device sends them asynchronously
+        if (_left >= _pending)
+            break;
+
+        _pending = _left;
+    }
+
+    return rxdp_ok;
+}
+
+rxdp
+xdp_socket_statistics (
+    IN  const sxdp_socket*      xsk,
+    OUT uint64_t*               drops,
+    OUT uint64_t*               empty
+) {
+    struct xdp_statistics _statistics;
+    socklen_t             _length = sizeof(_statistics);
+
+    memset(&_statistics, 0, sizeof(_statistics));
+
+    //older kernels return drops & invalid descriptors only
+    if (0 > getsockopt(xsk->socket, SOL_XDP, XDP_STATISTICS, &_statistics, &_length)) {
+        LOG(verbose, "can't get xdp statistics, cuz' %d [%s]", errno, strerror(errno));
+        return rxdp_failed;
+    }
+
+    (*drops) = (_statistics.rx_dropped + _statistics.rx_ring_full);
+    (*empty) = _statistics.rx_fill_ring_empty_descs;
+
+    return rxdp_ok;
+}
+
+rxdp
+xdp_device_queues (
+    IN  const char*             device,
+    OUT size_t*                 queues
+) {
+    struct ethtool_channels _channels;
+    struct ifreq            _request;
+
+    memset(&_channels, 0, sizeof(_channels));
+    memset(&_request,  0, sizeof(_request));
+
+    _channels.cmd = ETHTOOL_GCHANNELS;
+
+    strcpy_l(_request.ifr_name, device, IFNAMSIZ);
+    _request.ifr_data = (char*)&_channels;
+
+    socket_t _socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if SOCKET_INVALID_IS(_socket) {
+        LOG(error, "can't open ethtool socket, cuz' %d [%s]", errno, strerror(errno));
+        return rxdp_failed;
+    }
+
+    int _r = ioctl(_socket, SIOCETHTOOL, &_request);
+    int _e = errno;
+
+    close(_socket);
+
+    if (0 > _r) {
+        LOG(verbose, "can't get channels of device [%s], cuz' %d [%s]", device, _e, strerror(_e));
+        return rxdp_failed;
+    }
+
+    //rx only channels have own queues as well as combined ones
+    (*queues) = (size_t)(_channels.combined_count + _channels.rx_count);
+
+    if (0 == (*queues))
+        (*queues) = 1;
+
+    return rxdp_ok;
+}
+
+/** KIM: xdp program
+        classic filter is translated instruction by instruction: A is r0, X is
+        r9, scratch memory is stack, packet loads are relative to network
+        header [r7] with bounds check against data end [r8], which passes frame
+        to kernel stack when fails. prologue checks ethernet type, udp & no
+        fragmentation [like filter_packet], accepted frame is redirected to
+        socket of its queue [or passed if there's none]. ancillary loads are
+        unsupported, so lane & packet filters aren't translated
+**/
+
+typedef
+struct __xdp_builder {
+    struct bpf_insn*        code;
+    int32_t*                target;     //label of jump, XDP_LABEL_NONE - isn't jump to label
+    size_t                  length;
+
+    int32_t                 label[XDP_LABELS];  //label -> instruction, XDP_LABEL_NONE - unbound
+    uint8_t                 reachable[FILTER_MAXIMUM];  //classic instructions, verifier refuses dead code
+
+    int                     failed;
+} _sxdp_builder;
+
+static void
+_xdp_emit (
+    BTH _sxdp_builder*          builder,
+        uint8_t                 code,
+        uint8_t                 dst,
+        uint8_t                 src,
+        int16_t                 off,
+        int32_t                 imm
+) {
+    if (XDP_PROGRAM_MAXIMUM <= builder->length) {
+        builder->failed = 1;
+        return;
+    }
+
+    struct bpf_insn* _instruction = &(builder->code[builder->length]);
+
+    _instruction->code    = code;
+    _instruction->dst_reg = dst;
+    _instruction->src_reg = src;
+    _instruction->off     = off;
+    _instruction->imm     = imm;
+
+    builder->target[builder->length++] = XDP_LABEL_NONE;
+}
+
+static void
+_xdp_emit_jump (
+    BTH _sxdp_builder*          builder,
+        uint8_t                 code,
+        uint8_t                 dst,
+        uint8_t                 src,
+        int32_t                 imm,
+        int32_t                 label
+) {
+    _xdp_emit(builder, code, dst, src, 0, imm);
+
+    if (0 == builder->failed)
+        builder->target[builder->length - 1] = label;
+}
+
+#define _R_A        (BPF_REG_0)
+#define _R_X        (BPF_REG_9)
+#define _R_CTX      (BPF_REG_6)
+#define _R_NET      (BPF_REG_7)
+#define _R_END      (BPF_REG_8)
+#define _R_FP       (BPF_REG_10)
+
+//packet load of classic filter, k is relative to network header
+static void
+_xdp_load (
+    BTH _sxdp_builder*          builder,
+        uint8_t                 size,
+        uint8_t                 destination,
+        uint32_t                k,
+        int                     indirect
+) {
+    int32_t _offset = (int32_t)k;
+
+    if ((SKF_NET_OFF <= _offset) && (SKF_AD_OFF > _offset))
+        _offset -= SKF_NET_OFF;
+
+    if ((0 > _offset) || (UINT16_MAX < _offset)) {
+        LOG(verbose, "xdp: unsupported load at %"PRId32, (int32_t)k);
+
+        builder->failed = 1;
+        return;
+    }
+
+    int32_t _bytes = (BPF_B == size)?1:((BPF_H == size)?2:4);
+
+    _xdp_emit(builder, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, _R_NET, 0, 0);
+
+    if (indirect)
+        _xdp_emit(builder, BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_1, _R_X, 0, 0);
+
+    _xdp_emit(builder, BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_1, 0, 0, _offset);
+    _xdp_emit(builder, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_1, 0, 0);
+    _xdp_emit(builder, BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, _bytes);
+    _xdp_emit_jump(builder, BPF_JMP | BPF_JGT | BPF_X, BPF_REG_2, _R_END, 0, XDP_LABEL_PASS);
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | size, destination, BPF_REG_1, 0, 0);
+
+    if (1 < _bytes)
+        _xdp_emit(builder, BPF_ALU | BPF_END | BPF_TO_BE, destination, 0, 0, (_bytes * 8));
+}
+
+//classic jumps are forward only, so one pass marks everything reachable
+static void
+_xdp_reachable (
+    BTH _sxdp_builder*          builder,
+    IN  const sfilter*          filter
+) {
+    memset(builder->reachable, 0, sizeof(builder->reachable));
+
+    if (0 < filter->length)
+        builder->reachable[0] = 1;
+
+    for (size_t _i = 0; _i < filter->length; ++_i) {
+        const struct sock_filter* _instruction = &(filter->code[_i]);
+
+        if (0 == builder->reachable[_i])
+            continue;
+
+        size_t _next[2] = {_i + 1, _i + 1};
+
+        switch (BPF_CLASS(_instruction->code)) {
+            case BPF_RET:
+                continue;
+
+            case BPF_JMP:
+                if (BPF_JA == BPF_OP(_instruction->code)) {
+                    _next[0] = _next[1] = (_i + 1 + _instruction->k);
+                    break;
+                }
+
+                _next[0] += _instruction->jt;
+                _next[1] += _instruction->jf;
+                break;
+        }
+
+        for (size_t _j = 0; _j < 2; ++_j)
+            if (_next[_j] < filter->length)
+                builder->reachable[_next[_j]] = 1;
+    }
+}
+
+static void
+_xdp_translate (
+    BTH _sxdp_builder*          builder,
+    IN  const sfilter*          filter
+) {
+    _xdp_reachable(builder, filter);
+
+    for (size_t _i = 0; (_i < filter->length) && (0 == builder->failed); ++_i) {
+        const struct sock_filter* _instruction = &(filter->code[_i]);
+
+        uint16_t _code = _instruction->code;
+        uint32_t _k    = _instruction->k;
+        int16_t  _slot = (int16_t)(-4 * (int32_t)((_k % BPF_MEMWORDS) + 1));
+
+        builder->label[_i] = (int32_t)builder->length;
+
+        if (0 == builder->reachable[_i])
+            continue;
+
+        switch (BPF_CLASS(_code)) {
+            case BPF_LD:
+                switch (BPF_MODE(_code)) {
+                    case BPF_ABS:
+                    case BPF_IND:
+                        _xdp_load(builder, BPF_SIZE(_code), _R_A, _k, (BPF_IND == BPF_MODE(_code)));
+                        continue;
+
+                    case BPF_IMM:
+                        _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_K, _R_A, 0, 0, (int32_t)_k);
+                        continue;
+
+                    case BPF_MEM:
+                        _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_W, _R_A, _R_FP, _slot, 0);
+                        continue;
+                }
+                break;
+
+            case BPF_LDX:
+                switch (BPF_MODE(_code)) {
+                    case BPF_MSH:
+                        _xdp_load(builder, BPF_B, _R_X, _k, 0);
+                        _xdp_emit(builder, BPF_ALU | BPF_AND | BPF_K, _R_X, 0, 0, 0x0F);
+                        _xdp_emit(builder, BPF_ALU | BPF_LSH | BPF_K, _R_X, 0, 0, 2);
+                        continue;
+
+                    case BPF_IMM:
+                        _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_K, _R_X, 0, 0, (int32_t)_k);
+                        continue;
+
+                    case BPF_MEM:
+                        _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_W, _R_X, _R_FP, _slot, 0);
+                        continue;
+                }
+                break;
+
+            case BPF_ST:
+                _xdp_emit(builder, BPF_STX | BPF_MEM | BPF_W, _R_FP, _R_A, _slot, 0);
+                continue;
+
+            case BPF_STX:
+                _xdp_emit(builder, BPF_STX | BPF_MEM | BPF_W, _R_FP, _R_X, _slot, 0);
+                continue;
+
+            case BPF_ALU:
+                //classic division by zero drops, ebpf's one yields zero
+                if ((BPF_NEG == BPF_OP(_code)) || (BPF_X == BPF_SRC(_code)) || (0 != _k) || ((BPF_DIV != BPF_OP(_code)) && (BPF_MOD != BPF_OP(_code)))) {
+                    _xdp_emit(builder, _code, _R_A, (BPF_X == BPF_SRC(_code))?_R_X:0, 0, (int32_t)_k);
+                    continue;
+                }
+                break;
+
+            case BPF_MISC:
+                if (BPF_TAX == BPF_MISCOP(_code)) {
+                    _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_X, _R_X, _R_A, 0, 0);
+                    continue;
+                }
+
+                _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_X, _R_A, _R_X, 0, 0);
+                continue;
+
+            case BPF_RET:
+                if (BPF_K != BPF_RVAL(_code))
+                    break;
+
+                _xdp_emit_jump(builder, BPF_JMP | BPF_JA, 0, 0, 0, (0 != _k)?XDP_LABEL_ACCEPT:XDP_LABEL_PASS);
+                continue;
+
+            case BPF_JMP:
+                if (BPF_JA == BPF_OP(_code)) {
+                    _xdp_emit_jump(builder, BPF_JMP | BPF_JA, 0, 0, 0, (int32_t)(_i + 1 + _k));
+                    continue;
+                }
+
+                switch (BPF_OP(_code)) {
+                    case BPF_JEQ:
+                    case BPF_JGT:
+                    case BPF_JGE:
+                    case BPF_JSET:
+                        _xdp_emit_jump(builder, BPF_JMP32 | BPF_OP(_code) | BPF_SRC(_code), _R_A, (BPF_X == BPF_SRC(_code))?_R_X:0, (int32_t)_k, (int32_t)(_i + 1 + _instruction->jt));
+
+                        if (0 != _instruction->jf)
+                            _xdp_emit_jump(builder, BPF_JMP | BPF_JA, 0, 0, 0, (int32_t)(_i + 1 + _instruction->jf));
+
+                        continue;
+                }
+                break;
+        }
+
+        LOG(verbose, "xdp: unsupported classic instruction %u [%04x]", (unsigned int)_i, (unsigned int)_code);
+        builder->failed = 1;
+    }
+}
+
+static rxdp
+_xdp_build (
+    BTH _sxdp_builder*          builder,
+    IN  const sfilter*          filter,
+        int                     map
+) {
+    for (size_t _i = 0; _i < XDP_LABELS; ++_i)
+        builder->label[_i] = XDP_LABEL_NONE;
+
+    //registers & scratch memory start zeroed, like classic ones
+    _xdp_emit(builder, BPF_ALU64 | BPF_MOV | BPF_X, _R_CTX, BPF_REG_1, 0, 0);
+    _xdp_emit(builder, BPF_ALU   | BPF_MOV | BPF_K, _R_A,   0, 0, 0);
+    _xdp_emit(builder, BPF_ALU   | BPF_MOV | BPF_K, _R_X,   0, 0, 0);
+
+    for (int16_t _i = 1; _i <= BPF_MEMWORDS; ++_i)
+        _xdp_emit(builder, BPF_ST | BPF_MEM | BPF_W, _R_FP, 0, (int16_t)(-4 * _i), 0);
+
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_W, _R_NET, _R_CTX, offsetof(struct xdp_md, data),     0);
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_W, _R_END, _R_CTX, offsetof(struct xdp_md, data_end), 0);
+
+    //ethernet & ip headers without options
+    _xdp_emit(builder, BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, _R_NET, 0, 0);
+    _xdp_emit(builder, BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, ETH_HLEN + 20);
+    _xdp_emit_jump(builder, BPF_JMP | BPF_JGT | BPF_X, BPF_REG_2, _R_END, 0, XDP_LABEL_PASS);
+
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_H, _R_A, _R_NET, 12, 0);
+    _xdp_emit_jump(builder, BPF_JMP32 | BPF_JNE | BPF_K, _R_A, 0, htons(ETH_P_IP), XDP_LABEL_PASS);
+
+    _xdp_emit(builder, BPF_ALU64 | BPF_ADD | BPF_K, _R_NET, 0, 0, ETH_HLEN);
+
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_B, _R_A, _R_NET, 9, 0);
+    _xdp_emit_jump(builder, BPF_JMP32 | BPF_JNE | BPF_K, _R_A, 0, IPPROTO_UDP, XDP_LABEL_PASS);
+
+    //fragments are never reassembled, kernel does it
+    _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_H, _R_A, _R_NET, 6, 0);
+    _xdp_emit(builder, BPF_ALU | BPF_END | BPF_TO_BE, _R_A, 0, 0, 16);
+    _xdp_emit_jump(builder, BPF_JMP32 | BPF_JSET | BPF_K, _R_A, 0, 0x3FFF, XDP_LABEL_PASS);
+
+    _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_K, _R_A, 0, 0, 0);
+
+    if NULL_IS(filter)
+        _xdp_emit_jump(builder, BPF_JMP | BPF_JA, 0, 0, 0, XDP_LABEL_ACCEPT);
+    else
+        _xdp_translate(builder, filter);
+
+    builder->label[XDP_LABEL_PASS] = (int32_t)builder->length;
+
+    _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+    _xdp_emit(builder, BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    //socket of frame's queue, kernel stack if there's none [unless filter drops everything]
+    for (size_t _i = 0; _i < builder->length; ++_i)
+        if (XDP_LABEL_ACCEPT == builder->target[_i]) {
+            builder->label[XDP_LABEL_ACCEPT] = (int32_t)builder->length;
+
+            _xdp_emit(builder, BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, _R_CTX, offsetof(struct xdp_md, rx_queue_index), 0);
+            _xdp_emit(builder, BPF_LD  | BPF_DW  | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map);
+            _xdp_emit(builder, 0, 0, 0, 0, 0);
+            _xdp_emit(builder, BPF_ALU | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+            _xdp_emit(builder, BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+            _xdp_emit(builder, BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+            break;
+        }
+
+    if (0 != builder->failed)
+        return rxdp_failed;
+
+    for (size_t _i = 0; _i < builder->length; ++_i) {
+        int32_t _label = builder->target[_i];
+
+        if (XDP_LABEL_NONE == _label)
+            continue;
+
+        if ((XDP_LABELS <= _label) || (XDP_LABEL_NONE == builder->label[_label])) {
+            LOG(verbose, "xdp: jump to unbound label %"PRId32, _label);
+            return rxdp_failed;
+        }
+
+        int32_t _offset = builder->label[_label] - (int32_t)(_i + 1);
+
+        if ((0 > _offset) || (INT16_MAX < _offset)) {
+            LOG(verbose, "xdp: jump out of range [%"PRId32"]", _offset);
+            return rxdp_failed;
+        }
+
+        builder->code[_i].off = (int16_t)_offset;
+    }
+
+    return rxdp_ok;
+}
+
+static int
+_xdp_program_load (
+    IN  const sfilter*          filter,
+        int                     map
+) {
+    _sxdp_builder* _builder = (_sxdp_builder*)calloc(1, sizeof(_sxdp_builder));
+
+    if NULL_IS(_builder) {
+        LOG(critical, "out of memory: xdp program builder [%lu]", (unsigned long)sizeof(_sxdp_builder));
+        return -1;
+    }
+
+    int _program = -1;
+
+    _builder->code   = (struct bpf_insn*)calloc(XDP_PROGRAM_MAXIMUM, sizeof(struct bpf_insn));
+    _builder->target = (int32_t*)calloc(XDP_PROGRAM_MAXIMUM, sizeof(int32_t));
+
+    if (NULL_IS(_builder->code) || NULL_IS(_builder->target)) {
+        LOG(critical, "out of memory: xdp program of %u instructions", (unsigned int)XDP_PROGRAM_MAXIMUM);
+        goto _done;
+    }
+
+    if (rxdp_ok != _xdp_build(_builder, filter, map))
+        goto _done;
+
+    static const char _license[] = "GPL";
+
+    union bpf_attr _attr;
+
+    memset(&_attr, 0, sizeof(_attr));
+
+    _attr.prog_type = BPF_PROG_TYPE_XDP;
+    _attr.insns     = (uintptr_t)_builder->code;
+    _attr.insn_cnt  = (uint32_t)_builder->length;
+    _attr.license   = (uintptr_t)_license;
+
+    if (0 <= (_program = (int)_xdp_bpf(BPF_PROG_LOAD, &_attr))) {
+        LOG(debug, "xdp: program loaded [%lu instructions]", (unsigned long)_builder->length);
+        goto _done;
+    }
+
+    LOG(error, "can't load xdp program, cuz' %d [%s]", errno, strerror(errno));
+
+    //verifier's reason
+    if (LOG_ENABLED(verbose)) {
+        char* _log = (char*)calloc(1, XDP_LOG_SIZE);
+
+        if NOT_NULL_IS(_log) {
+            _attr.log_buf   = (uintptr_t)_log;
+            _attr.log_size  = XDP_LOG_SIZE;
+            _attr.log_level = 1;
+
+            if (0 <= (_program = (int)_xdp_bpf(BPF_PROG_LOAD, &_attr))) {
+                close(_program);
+                _program = -1;
+            }
+
+            LOG(verbose, "xdp: verifier says %s", _log);
+            free(_log);
+        }
+    }
+
+    _done:
+        free(_builder->code);
+        free(_builder->target);
+        free(_builder);
+
+        return _program;
+}
+
+void
+xdp_program_initialize (
+    OUT sxdp_program*           program
+) {
+    program->map     = -1;
+    program->program = -1;
+    program->link    = -1;
+    program->index   = 0;
+    program->queues  = 0;
+    program->users   = 0;
+}
+
+rxdp
+xdp_program_attach (
+    BTH sxdp_program*           program,
+    IN  const sfilter*          filter,
+        device_index_t          index,
+        size_t                  queues
+) {
+    union bpf_attr _attr;
+
+    //device changed its index, old link went with old device
+    if ((0 <= program->link) && (program->index != index)) {
+        close(program->link);
+        program->link = -1;
+    }
+
+    if (0 > program->map) {
+        memset(&_attr, 0, sizeof(_attr));
+
+        _attr.map_type    = BPF_MAP_TYPE_XSKMAP;
+        _attr.key_size    = sizeof(uint32_t);
+        _attr.value_size  = sizeof(uint32_t);
+        _attr.max_entries = (uint32_t)queues;
+
+        if (0 > (program->map = (int)_xdp_bpf(BPF_MAP_CREATE, &_attr))) {
+            LOG(error, "can't create xskmap of %lu queues, cuz' %d [%s]", (unsigned long)queues, errno, strerror(errno));
+            return rxdp_failed;
+        }
+
+        program->queues = queues;
+    }
+
+    int _program = _xdp_program_load(filter, program->map);
+
+    //any udp datagram goes to userspace, which decides anyway
+    if ((0 > _program) && NOT_NULL_IS(filter)) {
+        LOG(verbose, "xdp: can't translate filter, datagrams are filtered in userspace only");
+        _program = _xdp_program_load(NULL, program->map);
+    }
+
+    if (0 > _program)
+        return rxdp_failed;
+
+    memset(&_attr, 0, sizeof(_attr));
+
+    if (0 <= program->link) {
+        _attr.link_update.link_fd     = (uint32_t)program->link;
+        _attr.link_update.new_prog_fd = (uint32_t)_program;
+
+        if (0 > _xdp_bpf(BPF_LINK_UPDATE, &_attr)) {
+            LOG(error, "can't replace xdp program of device %d, cuz' %d [%s]", index, errno, strerror(errno));
+
+            close(_program);
+            return rxdp_failed;
+        }
+
+    } else {
+        _attr.link_create.prog_fd        = (uint32_t)_program;
+        _attr.link_create.target_ifindex = (uint32_t)index;
+        _attr.link_create.attach_type    = BPF_XDP;
+
+        if (0 > (program->link = (int)_xdp_bpf(BPF_LINK_CREATE, &_attr))) {
+            LOG(error, "can't attach xdp program to device %d, cuz' %d [%s]", index, errno, strerror(errno));
+
+            if (EBUSY == errno)
+                LOG(warning, "... device has other xdp program attached");
+
+            close(_program);
+            return rxdp_failed;
+        }
+
+        program->index = index;
+    }
+
+    if (0 <= program->program)
+        close(program->program);
+
+    program->program = _program;
+    return rxdp_ok;
+}
+
+rxdp
+xdp_program_insert (
+    BTH sxdp_program*           program,
+        uint32_t                queue,
+    IN  const sxdp_socket*      xsk
+) {
+    if (program->queues <= queue) {
+        LOG(error, "xdp queue %"PRIu32" is out of xskmap [%lu]", queue, (unsigned long)program->queues);
+        return rxdp_failed;
+    }
+
+    uint32_t       _socket = (uint32_t)xsk->socket;
+    union bpf_attr _attr;
+
+    memset(&_attr, 0, sizeof(_attr));
+
+    _attr.map_fd = (uint32_t)program->map;
+    _attr.key    = (uintptr_t)&queue;
+    _attr.value  = (uintptr_t)&_socket;
+    _attr.flags  = BPF_ANY;
+
+    if (0 > _xdp_bpf(BPF_MAP_UPDATE_ELEM, &_attr)) {
+        LOG(error, "can't insert xdp socket of queue %"PRIu32", cuz' %d [%s]", queue, errno, strerror(errno));
+        return rxdp_failed;
+    }
+
+    program->users++;
+    return rxdp_ok;
+}
+
+void
+xdp_program_remove (
+    BTH sxdp_program*           program,
+        uint32_t                queue
+) {
+    union bpf_attr _attr;
+
+    memset(&_attr, 0, sizeof(_attr));
+
+    _attr.map_fd = (uint32_t)program->map;
+    _attr.key    = (uintptr_t)&queue;
+
+    if (0 > _xdp_bpf(BPF_MAP_DELETE_ELEM, &_attr))
+        LOG(verbose, "can't remove xdp socket of queue %"PRIu32", cuz' %d [%s]", queue, errno, strerror(errno));
+
+    if (0 < program->users)
+        program->users--;
+
+    if (0 == program->users)
+        xdp_program_detach(program);
+}
+
+void
+xdp_program_detach (
+    BTH sxdp_program*           program
+) {
+    //link is the only reference of device to program, closing it detaches
+    if (0 <= program->link)
+        close(program->link);
+
+    if (0 <= program->program)
+        close(program->program);
+
+    if (0 <= program->map)
+        close(program->map);
+
+    xdp_program_initialize(program);
+}
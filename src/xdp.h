@@ -0,0 +1,219 @@
+/**
+    Broadcast Proxy
+    Alexander Belyaev <iybego@ocihs.spb.ru>, 2016
+**/
+
+#if !defined(BPROXY_XDP)
+#define BPROXY_XDP
+
+#include "bproxy.h"
+#include "socket.h"
+#include "filter.h"
+
+#include <linux/if_xdp.h>
+#include <linux/bpf.h>
+
+/** KIM: af-xdp
+        umem is one area of fixed frames registered by receiving socket, frames
+        are passed between kernel and userspace by four rings: fill [free ones
+        for receiving], rx [received], tx [to send] and completion [sent]. each
+        ring has single producer & single consumer, indices are free running.
+
+        xdp program of device redirects datagrams it accepts to socket of their
+        rx queue [by xskmap], everything else goes to kernel stack as usual.
+        program is translated from classic socket filter [see KIM: classic bpf
+        socket filter builder], so allow & port-range are checked before frame
+        is copied to umem [or in place, in zero copy mode].
+
+        socket of other device may share umem [it has own fill & completion
+        rings], so frame received by one socket is sent by another without
+        copying. zero copy needs driver support, copy mode is the fallback
+**/
+
+typedef
+enum {
+        rxdp_ok             = 0
+    ,   rxdp_failed
+} rxdp;
+
+typedef
+struct _xdp_ring        sxdp_ring;
+
+struct _xdp_ring {
+    uint32_t*               producer;
+    uint32_t*               consumer;
+    void*                   entries;    //addresses [fill, completion] or descriptors [rx, tx]
+
+    uint32_t                mask;
+    uint32_t                head;       //own index: producer's or consumer's
+
+    void*                   map;        //NULL - not mapped
+    size_t                  size;
+};
+
+typedef
+struct _xdp_umem        sxdp_umem;
+
+struct _xdp_umem {
+    ubyte_t*                area;       //NULL - not allocated
+    size_t                  size;
+
+    size_t                  frames;
+    size_t                  frame_size; //power of 2, frames never cross page
+};
+
+typedef
+struct _xdp_socket      sxdp_socket;
+
+struct _xdp_socket {
+    socket_t                socket;     //SOCKET_INVALID - closed
+    uint16_t                mode;       //XDP_ZEROCOPY or XDP_COPY, as bound
+
+    sxdp_ring               fill;
+    sxdp_ring               completion;
+    sxdp_ring               rx;         //not mapped for sending socket
+    sxdp_ring               tx;         //... and for receiving one
+};
+
+typedef
+struct _xdp_program     sxdp_program;
+
+struct _xdp_program {
+    int                     map;        //xskmap, -1 - not created
+    int                     program;    //-1 - not loaded
+    int                     link;       //-1 - not attached
+
+    device_index_t          index;
+    size_t                  queues;
+    size_t                  users;      //sockets in map
+};
+
+//free slots of producer's ring [fill, tx]
+static inline uint32_t
+xdp_ring_free (
+    IN  const sxdp_ring*        ring
+) { return ((ring->mask + 1) - (ring->head - __atomic_load_n(ring->consumer, __ATOMIC_ACQUIRE))); }
+
+//submitted slots of producer's ring, which kernel hasn't consumed yet
+static inline uint32_t
+xdp_ring_pending (
+    IN  const sxdp_ring*        ring
+) { return (ring->head - __atomic_load_n(ring->consumer, __ATOMIC_ACQUIRE)); }
+
+//filled slots of consumer's ring [rx, completion]
+static inline uint32_t
+xdp_ring_ready (
+    IN  const sxdp_ring*        ring
+) { return (__atomic_load_n(ring->producer, __ATOMIC_ACQUIRE) - ring->head); }
+
+//producer publishes entries written upto head
+static inline void
+xdp_ring_submit (
+    BTH sxdp_ring*              ring
+) { __atomic_store_n(ring->producer, ring->head, __ATOMIC_RELEASE); }
+
+//consumer returns entries read upto head
+static inline void
+xdp_ring_release (
+    BTH sxdp_ring*              ring
+) { __atomic_store_n(ring->consumer, ring->head, __ATOMIC_RELEASE); }
+
+static inline uint64_t*
+xdp_ring_address (
+    BTH sxdp_ring*              ring,
+        uint32_t                index
+) { return &(((uint64_t*)ring->entries)[index & ring->mask]); }
+
+static inline struct xdp_desc*
+xdp_ring_descriptor (
+    BTH sxdp_ring*              ring,
+        uint32_t                index
+) { return &(((struct xdp_desc*)ring->entries)[index & ring->mask]); }
+
+//frames are page aligned, frame_size divides page
+rxdp
+xdp_umem_create (
+        size_t                  frames,
+        size_t                  frame_size,
+    OUT sxdp_umem*              umem
+);
+
+void
+xdp_umem_destroy (
+    BTH sxdp_umem*              umem
+);
+
+/*  shared NULL - receiving socket, it registers umem and has fill, rx &
+    completion rings, otherwise sending one: it shares umem of receiving one
+    and has tx & completion rings [fill one is empty]. ring sizes are powers of 2 */
+rxdp
+xdp_socket_open (
+    OUT sxdp_socket*            xsk,
+    IN  const sxdp_umem*        umem,
+    IN  const sxdp_socket*      shared,
+        device_index_t          index,
+        uint32_t                queue,
+        size_t                  entries
+);
+
+void
+xdp_socket_close (
+    BTH sxdp_socket*            xsk
+);
+
+//sends submitted tx descriptors while kernel takes them [copy mode sends a batch per call]
+rxdp
+xdp_socket_kick (
+    BTH sxdp_socket*            xsk
+);
+
+//drops since open [XDP_STATISTICS aren't reset]
+rxdp
+xdp_socket_statistics (
+    IN  const sxdp_socket*      xsk,
+    OUT uint64_t*               drops,
+    OUT uint64_t*               empty       //fill ring was empty
+);
+
+//rx queues of device [ETHTOOL_GCHANNELS], every one gets datagrams spread by nic
+rxdp
+xdp_device_queues (
+    IN  const char*             device,
+    OUT size_t*                 queues
+);
+
+void
+xdp_program_initialize (
+    OUT sxdp_program*           program
+);
+
+/*  loads program translated from finalized filter [NULL - any udp datagram],
+    attaches it to device or replaces attached one */
+rxdp
+xdp_program_attach (
+    BTH sxdp_program*           program,
+    IN  const sfilter*          filter,
+        device_index_t          index,
+        size_t                  queues
+);
+
+rxdp
+xdp_program_insert (
+    BTH sxdp_program*           program,
+        uint32_t                queue,
+    IN  const sxdp_socket*      xsk
+);
+
+//detaches program when last socket is removed
+void
+xdp_program_remove (
+    BTH sxdp_program*           program,
+        uint32_t                queue
+);
+
+void
+xdp_program_detach (
+    BTH sxdp_program*           program
+);
+
+#endif